@@ -0,0 +1,296 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Event memory and graph frame time with events read through trace_event_t
+//  vs. the TraceEvents ts, flags, pid, and duration columns.
+//
+//   bench_events [events] [rows] [visible events per frame]
+//
+// Events are spread over comm rows like a trace with many busy threads. A
+//  frame walks the visible event range of every row the way
+//  graph_render_row_events() does, with sched_switch events hidden and a
+//  pid filter on, then draws the row's sched_switch bars. The default of
+//  50M events needs about 8GB.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "gpuvis_macros.h"
+#include "trace-cmd/trace-read.h"
+
+struct columns_t
+{
+    std::vector< int64_t > ts;
+    std::vector< uint32_t > flags;
+    std::vector< int > pid;
+    std::vector< int64_t > duration;
+};
+
+struct frame_t
+{
+    uint32_t eventstart;
+    uint32_t eventend;
+    int64_t ts0;
+    double tsdxrcp;
+    // Graph only the event list's filtered events
+    bool only_filtered;
+};
+
+static double now_ms()
+{
+    using namespace std::chrono;
+    return duration< double, std::milli >( steady_clock::now().time_since_epoch() ).count();
+}
+
+// Group events closer than a pixel with the same color, like event_renderer_t
+struct renderer_t
+{
+    float x1 = -2.0f;
+    uint32_t color = 0;
+    uint64_t rects = 0;
+
+    void add_event( float x, uint32_t event_color )
+    {
+        if ( ( x - x1 > 1.0f ) || ( color != event_color ) )
+        {
+            rects++;
+            color = event_color;
+        }
+        x1 = x;
+    }
+};
+
+static uint64_t render_events( const std::vector< trace_event_t > &events,
+                               const std::vector< std::vector< uint32_t > > &rows,
+                               const std::unordered_set< int > &pids, const frame_t &frame )
+{
+    uint64_t hash = 0;
+
+    for ( const std::vector< uint32_t > &locs : rows )
+    {
+        renderer_t renderer;
+
+        for ( auto it = std::lower_bound( locs.begin(), locs.end(), frame.eventstart ); it != locs.end(); ++it )
+        {
+            const trace_event_t &event = events[ *it ];
+
+            if ( *it > frame.eventend )
+                break;
+            else if ( frame.only_filtered && event.is_filtered_out )
+                continue;
+            else if ( event.is_sched_switch() )
+                continue;
+            else if ( pids.find( event.pid ) == pids.end() )
+                continue;
+
+            renderer.add_event( ( event.ts - frame.ts0 ) * frame.tsdxrcp, event.color );
+        }
+
+        for ( auto it = std::lower_bound( locs.begin(), locs.end(), frame.eventstart ); it != locs.end(); ++it )
+        {
+            const trace_event_t &sched_switch = events[ *it ];
+
+            if ( *it > frame.eventend )
+                break;
+            else if ( sched_switch.is_sched_switch() && sched_switch.has_duration() )
+            {
+                float x0 = ( sched_switch.ts - sched_switch.duration - frame.ts0 ) * frame.tsdxrcp;
+                int running = !!( sched_switch.flags & TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING );
+
+                hash += ( uint64_t )x0 + running;
+            }
+        }
+
+        hash = hash * 31 + renderer.rects;
+    }
+
+    return hash;
+}
+
+static uint64_t render_columns( const std::vector< trace_event_t > &events, const columns_t &cols,
+                                const std::vector< std::vector< uint32_t > > &rows,
+                                const std::unordered_set< int > &pids, const frame_t &frame )
+{
+    uint64_t hash = 0;
+
+    for ( const std::vector< uint32_t > &locs : rows )
+    {
+        renderer_t renderer;
+
+        for ( auto it = std::lower_bound( locs.begin(), locs.end(), frame.eventstart ); it != locs.end(); ++it )
+        {
+            uint32_t id = *it;
+
+            if ( id > frame.eventend )
+                break;
+            else if ( cols.flags[ id ] & TRACE_FLAG_SCHED_SWITCH )
+                continue;
+            else if ( pids.find( cols.pid[ id ] ) == pids.end() )
+                continue;
+
+            const trace_event_t &event = events[ id ];
+
+            if ( frame.only_filtered && event.is_filtered_out )
+                continue;
+
+            renderer.add_event( ( cols.ts[ id ] - frame.ts0 ) * frame.tsdxrcp, event.color );
+        }
+
+        for ( auto it = std::lower_bound( locs.begin(), locs.end(), frame.eventstart ); it != locs.end(); ++it )
+        {
+            uint32_t id = *it;
+
+            if ( id > frame.eventend )
+                break;
+            else if ( ( cols.flags[ id ] & TRACE_FLAG_SCHED_SWITCH ) && ( cols.duration[ id ] != INT64_MAX ) )
+            {
+                float x0 = ( cols.ts[ id ] - cols.duration[ id ] - frame.ts0 ) * frame.tsdxrcp;
+                int running = !!( cols.flags[ id ] & TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING );
+
+                hash += ( uint64_t )x0 + running;
+            }
+        }
+
+        hash = hash * 31 + renderer.rects;
+    }
+
+    return hash;
+}
+
+int main( int argc, char **argv )
+{
+    size_t count = ( argc > 1 ) ? strtoul( argv[ 1 ], NULL, 0 ) : 50000000;
+    size_t nrows = ( argc > 2 ) ? strtoul( argv[ 2 ], NULL, 0 ) : 64;
+    size_t visible = ( argc > 3 ) ? strtoul( argv[ 3 ], NULL, 0 ) : 2000000;
+    const int npids = 2000;
+    std::vector< trace_event_t > events( count );
+    std::vector< std::vector< uint32_t > > rows( nrows );
+    std::unordered_set< int > pids;
+    columns_t cols;
+    std::mt19937_64 rng( 1 );
+    int64_t ts = 0;
+
+    visible = std::min( visible, count );
+
+    // Busy threads get most of the events. One in five is a sched_switch.
+    for ( size_t i = 0; i < count; i++ )
+    {
+        trace_event_t &event = events[ i ];
+        uint64_t r = rng();
+
+        ts += r % 2000;
+
+        event.id = i;
+        event.ts = ts;
+        event.pid = ( r >> 16 ) % 8 ? ( r >> 24 ) % 64 : ( r >> 24 ) % npids;
+        event.color = ( ( r >> 40 ) % 4 ) ? 0 : 0xff0000ff;
+
+        if ( !( ( r >> 48 ) % 5 ) )
+        {
+            event.flags = TRACE_FLAG_SCHED_SWITCH;
+            if ( ( r >> 52 ) % 2 )
+                event.flags |= TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING;
+            event.duration = ( r >> 32 ) % 100000;
+        }
+
+        if ( ( size_t )event.pid < nrows )
+            rows[ event.pid ].push_back( i );
+    }
+
+    // Show three quarters of the pids
+    for ( int pid = 0; pid < npids; pid++ )
+    {
+        if ( pid % 4 )
+            pids.insert( pid );
+    }
+
+    double t0 = now_ms();
+
+    cols.ts.resize( count );
+    cols.flags.resize( count );
+    cols.pid.resize( count );
+    cols.duration.resize( count );
+    for ( size_t i = 0; i < count; i++ )
+    {
+        cols.ts[ i ] = events[ i ].ts;
+        cols.flags[ i ] = events[ i ].flags;
+        cols.pid[ i ] = events[ i ].pid;
+        cols.duration[ i ] = events[ i ].duration;
+    }
+
+    double tcols = now_ms() - t0;
+    size_t events_bytes = count * sizeof( trace_event_t );
+    size_t cols_bytes = count * ( sizeof( int64_t ) * 2 + sizeof( uint32_t ) + sizeof( int ) );
+
+    printf( "%zu events, %zu rows, %zu visible events per frame\n", count, nrows, visible );
+    printf( "  trace_event_t: %zu bytes, %.1fMB\n", sizeof( trace_event_t ), events_bytes / ( 1024.0 * 1024.0 ) );
+    printf( "  columns:       %zu bytes, %.1fMB (+%.1f%%), %.2fms to fill\n",
+            cols_bytes / std::max< size_t >( count, 1 ), cols_bytes / ( 1024.0 * 1024.0 ),
+            100.0 * cols_bytes / std::max< size_t >( events_bytes, 1 ), tcols );
+
+    // Frames pan across the trace so every frame misses the cache
+    const size_t frames = 32;
+    double tevents = 0.0;
+    double tcolumns = 0.0;
+
+    for ( size_t i = 0; i < frames; i++ )
+    {
+        frame_t frame;
+
+        frame.eventstart = ( uint32_t )( rng() % ( count - visible + 1 ) );
+        frame.eventend = frame.eventstart + visible - 1;
+        frame.ts0 = events[ frame.eventstart ].ts;
+        frame.tsdxrcp = 2000.0 / std::max< int64_t >( 1, events[ frame.eventend ].ts - frame.ts0 );
+        frame.only_filtered = false;
+
+        double t1 = now_ms();
+        uint64_t hash_events = render_events( events, rows, pids, frame );
+        double t2 = now_ms();
+        uint64_t hash_columns = render_columns( events, cols, rows, pids, frame );
+        double t3 = now_ms();
+
+        if ( hash_events != hash_columns )
+        {
+            printf( "  frame %zu mismatch!\n", i );
+            return 1;
+        }
+
+        tevents += t2 - t1;
+        tcolumns += t3 - t2;
+    }
+
+    printf( "  frame with trace_event_t: %8.2fms\n", tevents / frames );
+    printf( "  frame with columns:       %8.2fms\n", tcolumns / frames );
+
+    return 0;
+}
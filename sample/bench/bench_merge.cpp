@@ -0,0 +1,181 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Merging per-cpu record streams in timestamp order: the linear scan over
+//  every cpu that tracecmd_peek_next_data used to do vs. the ts_cursor_heap_t
+//  with lazily refreshed entries it uses now.
+//
+//   bench_merge [cpus] [instances] [records per cpu]
+//
+// Every instance (top buffer plus buffer instances) has its own set of cpus,
+//  so the merge sees cpus * instances cursors.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+// Same as trace-cmd/trace-read.cpp
+typedef std::pair< unsigned long long, size_t > ts_cursor_t;
+typedef std::priority_queue< ts_cursor_t, std::vector< ts_cursor_t >, std::greater< ts_cursor_t > > ts_cursor_heap_t;
+
+struct cursor_t
+{
+    const std::vector< unsigned long long > *ts;
+    size_t pos;
+
+    bool peek( unsigned long long &val ) const
+    {
+        if ( pos >= ts->size() )
+            return false;
+        val = ( *ts )[ pos ];
+        return true;
+    }
+};
+
+static double now_ms()
+{
+    using namespace std::chrono;
+    return duration< double, std::milli >( steady_clock::now().time_since_epoch() ).count();
+}
+
+// Peek every cursor for each record, lowest ts (then lowest index) wins
+static uint64_t merge_linear( std::vector< cursor_t > cursors )
+{
+    uint64_t hash = 0;
+
+    for ( ;; )
+    {
+        size_t next = ( size_t )-1;
+        unsigned long long next_ts = 0;
+
+        for ( size_t i = 0; i < cursors.size(); i++ )
+        {
+            unsigned long long ts;
+
+            if ( cursors[ i ].peek( ts ) && ( ( next == ( size_t )-1 ) || ( ts < next_ts ) ) )
+            {
+                next = i;
+                next_ts = ts;
+            }
+        }
+
+        if ( next == ( size_t )-1 )
+            break;
+
+        hash = hash * 31 + next;
+        cursors[ next ].pos++;
+    }
+
+    return hash;
+}
+
+// Stale top entries get re-peeked and pushed back, like tracecmd_peek_next_data
+static uint64_t merge_heap( std::vector< cursor_t > cursors )
+{
+    uint64_t hash = 0;
+    ts_cursor_heap_t heap;
+
+    for ( size_t i = 0; i < cursors.size(); i++ )
+    {
+        unsigned long long ts;
+
+        if ( cursors[ i ].peek( ts ) )
+            heap.push( { ts, i } );
+    }
+
+    while ( !heap.empty() )
+    {
+        ts_cursor_t top = heap.top();
+        unsigned long long ts;
+        bool valid = cursors[ top.second ].peek( ts );
+
+        if ( valid && ( ts == top.first ) )
+        {
+            hash = hash * 31 + top.second;
+            cursors[ top.second ].pos++;
+            continue;
+        }
+
+        heap.pop();
+        if ( valid )
+            heap.push( { ts, top.second } );
+    }
+
+    return hash;
+}
+
+int main( int argc, char **argv )
+{
+    size_t cpus = ( argc > 1 ) ? strtoul( argv[ 1 ], NULL, 0 ) : 128;
+    size_t instances = ( argc > 2 ) ? strtoul( argv[ 2 ], NULL, 0 ) : 4;
+    size_t records = ( argc > 3 ) ? strtoul( argv[ 3 ], NULL, 0 ) : 5000;
+    size_t count = cpus * instances;
+    std::vector< std::vector< unsigned long long > > streams( count );
+    std::vector< cursor_t > cursors( count );
+    std::mt19937_64 rng( 1 );
+
+    // Busy cpus get more records than idle ones, with some duplicate timestamps
+    for ( size_t i = 0; i < count; i++ )
+    {
+        unsigned long long ts = rng() % 1000;
+        size_t num = records / 2 + rng() % records;
+
+        streams[ i ].resize( num );
+        for ( size_t j = 0; j < num; j++ )
+        {
+            ts += rng() % 2000;
+            streams[ i ][ j ] = ts;
+        }
+
+        cursors[ i ] = { &streams[ i ], 0 };
+    }
+
+    size_t total = 0;
+    for ( const auto &stream : streams )
+        total += stream.size();
+
+    printf( "%zu cpus x %zu instances, %zu records\n", cpus, instances, total );
+
+    double t0 = now_ms();
+    uint64_t hash_linear = merge_linear( cursors );
+    double t1 = now_ms();
+    uint64_t hash_heap = merge_heap( cursors );
+    double t2 = now_ms();
+
+    printf( "  linear scan: %8.2fms (%6.1fns/record)\n", t1 - t0, ( t1 - t0 ) * 1e6 / total );
+    printf( "  heap:        %8.2fms (%6.1fns/record)\n", t2 - t1, ( t2 - t1 ) * 1e6 / total );
+
+    if ( hash_linear != hash_heap )
+    {
+        printf( "  merge order mismatch!\n" );
+        return 1;
+    }
+
+    return 0;
+}
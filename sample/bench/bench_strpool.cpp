@@ -0,0 +1,129 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// StrPool interning throughput with 1 to max threads, next to a single
+//  map behind a single lock (what StrPool was before it got sharded).
+//
+//   bench_strpool [max threads] [strings per thread]
+//
+// Strings look like what the trace loader interns: comm-pid names, small
+//  integers and kernel addresses. Most are repeats, like field values.
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "gpuvis_macros.h"
+
+// One map and one allocator behind one lock
+class LockedPool
+{
+public:
+    const char *getstr( const char *str, size_t len )
+    {
+        uint64_t hashval = hashstr64( str, len );
+        std::lock_guard< std::mutex > lock( m_lock );
+        const char **ret = m_pool.get_val( hashval );
+
+        if ( !ret )
+            ret = m_pool.get_val( hashval, m_alloc.dupestr( str, len ) );
+        return *ret;
+    }
+
+private:
+    std::mutex m_lock;
+    StrAlloc m_alloc;
+    util_umap< uint64_t, const char * > m_pool;
+};
+
+template < typename T >
+static double run( T &pool, const std::vector< std::string > &strs, size_t threads, size_t count )
+{
+    std::vector< std::thread > workers;
+    auto t0 = std::chrono::steady_clock::now();
+
+    for ( size_t t = 0; t < threads; t++ )
+    {
+        workers.emplace_back( [ &, t ]()
+        {
+            size_t idx = t * 7919;
+
+            for ( size_t i = 0; i < count; i++ )
+            {
+                const std::string &str = strs[ ( idx += 40503 ) % strs.size() ];
+
+                pool.getstr( str.c_str(), str.size() );
+            }
+        } );
+    }
+
+    for ( std::thread &worker : workers )
+        worker.join();
+
+    double secs = std::chrono::duration< double >( std::chrono::steady_clock::now() - t0 ).count();
+    return threads * count / secs / 1e6;
+}
+
+int main( int argc, char **argv )
+{
+    size_t max_threads = ( argc > 1 ) ? strtoul( argv[ 1 ], NULL, 0 ) : 32;
+    size_t count = ( argc > 2 ) ? strtoul( argv[ 2 ], NULL, 0 ) : 1000000;
+    std::vector< std::string > strs;
+    std::mt19937 rng( 1 );
+
+    for ( size_t i = 0; i < ( 1 << 16 ); i++ )
+    {
+        char buf[ 64 ];
+        uint32_t kind = rng() % 10;
+
+        if ( kind < 5 )
+            snprintf( buf, sizeof( buf ), "proc%u-%u", ( unsigned )( rng() % 40 ), ( unsigned )( 1000 + rng() % 4000 ) );
+        else if ( kind < 8 )
+            snprintf( buf, sizeof( buf ), "%u", ( unsigned )( rng() % 5000 ) );
+        else
+            snprintf( buf, sizeof( buf ), "0x%llx", 0xffffffff81000000ULL + ( rng() % 20000 ) * 16 );
+        strs.push_back( buf );
+    }
+
+    printf( "%u hardware threads, %zu strings per thread\n",
+            std::thread::hardware_concurrency(), count );
+    printf( "threads   locked Mstr/s   StrPool Mstr/s\n" );
+
+    for ( size_t threads = 1; threads <= max_threads; threads *= 2 )
+    {
+        LockedPool locked;
+        StrPool pool;
+        double mlocked = run( locked, strs, threads, count );
+        double mpool = run( pool, strs, threads, count );
+
+        printf( "%7zu %16.1f %16.1f\n", threads, mlocked, mpool );
+    }
+
+    return 0;
+}
@@ -28,6 +28,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <queue>
 #include <sys/stat.h>
 #define SDL_MAIN_HANDLED
 #include <SDL.h>
@@ -52,6 +53,7 @@
 #include "stlini.h"
 #include "gpuvis_utils.h"
 #include "gpuvis_etl.h"
+#include "gpuvis_cache.h"
 #include "gpuvis.h"
 
 #include "miniz.h"
@@ -149,23 +151,22 @@ uint32_t TraceLocationsRingCtxSeq::get_i915_ringno( const trace_event_t &event,
 
     if ( event.seqno )
     {
-        const char *ringstr = get_event_field_val( event, "ring", NULL );
+        static event_field_slot_t s_ring( "ring" );
+        static event_field_slot_t s_class( "class" );
+        static event_field_slot_t s_instance( "instance" );
 
-        if ( ringstr )
+        if ( s_ring.find( event ) >= 0 )
         {
             // Return old i915_gem_ event: ring=%u
-            return strtoul( ringstr, NULL, 10 );
+            return ( uint32_t )s_ring.get_int( event );
         }
         else
         {
             // Check new i915 event: engine=%u16:%u16 (class:instance)
-            const char *classstr = get_event_field_val( event, "class", NULL );
-            const char *instancestr = get_event_field_val( event, "instance", NULL );
-
-            if ( classstr && instancestr )
+            if ( ( s_class.find( event ) >= 0 ) && ( s_instance.find( event ) >= 0 ) )
             {
-                uint32_t classno = strtoul( classstr, NULL, 10 );
-                uint32_t instanceno = strtoul( instancestr, NULL, 10 );
+                uint32_t classno = ( uint32_t )s_class.get_int( event );
+                uint32_t instanceno = ( uint32_t )s_instance.get_int( event );
 
                 if ( is_class_instance )
                     *is_class_instance = true;
@@ -186,35 +187,27 @@ uint32_t TraceLocationsRingCtxSeq::get_i915_ringno( const trace_event_t &event,
 
 uint32_t TraceLocationsRingCtxSeq::get_i915_seqno( const trace_event_t &event )
 {
-    const char *seqno_str = get_event_field_val( event, "seqno", NULL );
-
-    if ( seqno_str )
-        return strtoul( seqno_str, NULL, 10 );
+    static event_field_slot_t s_seqno( "seqno" );
 
-    return ( uint32_t )-1;
+    return ( uint32_t )s_seqno.get_int( event, ( uint32_t )-1 );
 }
 
 uint32_t TraceLocationsRingCtxSeq::get_i915_hw_id( const trace_event_t &event)
 {
     if ( event.seqno )
     {
-        const char *hw_id_str = get_event_field_val( event, "hw_id", NULL );
+        static event_field_slot_t s_hw_id( "hw_id" );
 
-        if ( !hw_id_str )
-            return ( uint32_t )-1;
-
-        return strtoul( hw_id_str, NULL, 10 );
+        return ( uint32_t )s_hw_id.get_int( event, ( uint32_t )-1 );
     }
 
     return ( uint32_t )-1;
 }
 
-uint64_t TraceLocationsRingCtxSeq::db_key( uint32_t ringno, uint32_t seqno, const char *ctxstr )
+uint64_t TraceLocationsRingCtxSeq::db_key( uint32_t ringno, uint32_t seqno, uint64_t ctx )
 {
     if ( ringno != ( uint32_t )-1 )
     {
-        uint64_t ctx = strtoul( ctxstr, NULL, 10 );
-
         // Try to create unique 64-bit key from ring/seq/ctx.
         struct {
             uint64_t ctx;
@@ -236,15 +229,14 @@ uint64_t TraceLocationsRingCtxSeq::db_key( const trace_event_t &event )
 {
     if ( event.seqno )
     {
-        const char *ctxstr = get_event_field_val( event, "ctx", NULL );
-
-        // i915:intel_engine_notify has only ring & seqno, so default ctx to "0"
-        if ( !ctxstr && !strcmp( event.name, "intel_engine_notify" ) )
-            ctxstr = "0";
+        static event_field_slot_t s_ctx( "ctx" );
 
-        if ( ctxstr )
+        // i915:intel_engine_notify has only ring & seqno, so default ctx to 0
+        if ( ( s_ctx.find( event ) >= 0 ) || ( event.type == TRACE_EVENT_intel_engine_notify ) )
         {
-            return db_key( get_i915_ringno( event ), event.seqno, ctxstr );
+            uint64_t ctx = ( uint64_t )s_ctx.get_int( event );
+
+            return db_key( get_i915_ringno( event ), event.seqno, ctx );
         }
     }
 
@@ -273,9 +265,9 @@ std::vector< uint32_t > *TraceLocationsRingCtxSeq::get_locations( const trace_ev
     return m_locs.get_val( key );
 }
 
-std::vector< uint32_t > *TraceLocationsRingCtxSeq::get_locations( uint32_t ringno, uint32_t seqno, const char *ctxstr )
+std::vector< uint32_t > *TraceLocationsRingCtxSeq::get_locations( uint32_t ringno, uint32_t seqno, uint64_t ctx )
 {
-    uint64_t key = db_key( ringno, seqno, ctxstr );
+    uint64_t key = db_key( ringno, seqno, ctx );
 
     return m_locs.get_val( key );
 }
@@ -335,6 +327,9 @@ void Opts::init()
     init_opt( OPT_Scale, "Font Scale: %.1f", "scale", 2.0f, 0.25f, 6.0f, OPT_Float | OPT_Hidden );
     init_opt( OPT_Gamma, "Font Gamma: %.1f", "gamma", 1.4f, 1.0f, 4.0f, OPT_Float | OPT_Hidden );
     init_opt_bool( OPT_TrimTrace, "Trim Trace to align CPU buffers", "trim_trace_to_cpu_buffers", true, OPT_Hidden );
+    init_opt_bool( OPT_ParallelLoad, "Decode CPU buffers in parallel", "parallel_trace_load", true, OPT_Hidden );
+    init_opt_bool( OPT_LazyFieldFormat, "Format event fields on demand", "lazy_field_format", true, OPT_Hidden );
+    init_opt_bool( OPT_EventCache, "Cache loaded trace events", "event_cache", false );
     init_opt_bool( OPT_UseFreetype, "Use Freetype", "use_freetype", true, OPT_Hidden );
 
     for ( uint32_t i = OPT_RenderCrtc0; i <= OPT_RenderCrtc9; i++ )
@@ -576,7 +571,9 @@ void MainApp::cancel_load_file()
     SDL_AtomicCAS( &m_loading_info.state, State_Loading, State_CancelLoading );
 }
 
-static std::vector< std::string > extract_archive( const char *zipfile )
+// Decompress zip archive members into memory files (or temporary files where
+//  those aren't supported) and return the paths to load them from.
+static std::vector< std::string > extract_archive( const char *zipfile, MainApp::loading_info_t &loading_info )
 {
     mz_zip_archive zip_archive;
     std::vector< std::string > to_load;
@@ -598,16 +595,51 @@ static std::vector< std::string > extract_archive( const char *zipfile )
                 continue;
 
             // If no extension is present, default to dat. Otherwise, preserve extension.
+            const char *filename = util_basename( file_stat.m_filename );
+            const std::string name = string_format( "%s%s", filename,
+                    !strrchr( filename, '.' ) ? ".dat" : "" );
+
+            // Decompress straight into memory instead of writing the member
+            //  out to /tmp and reading it back.
+            std::string mem_path;
+            int fd = memfile_create( name.c_str(), mem_path );
+
+            if ( fd >= 0 )
+            {
+                FILE *file = fopen( mem_path.c_str(), "wb" );
+                bool extracted = file && mz_zip_reader_extract_to_cfile( &zip_archive, i, file, 0 );
+
+                if ( file && fclose( file ) )
+                    extracted = false;
+
+                if ( extracted )
+                {
+                    MainApp::loading_info_t::memfile_t &memfile = loading_info.memfiles[ mem_path ];
+
+                    memfile.name = name;
+                    memfile.fd = fd;
+                    to_load.push_back( mem_path );
+                }
+                else
+                {
+                    logf( "[Error] %s failed to extract from %s (src: %s).",
+                            __func__, zipfile, file_stat.m_filename );
+                    memfile_close( fd );
+                }
+                continue;
+            }
+
             // XXX: This usage of std::tmpnam may warn, but since we're using the temporary
             // string as a prefix along with other identifying data, this should be fine
             // in most reasonable scenarios.
-            const char *filename = util_basename( file_stat.m_filename );
-            const std::string dest_path = string_format( "%s_gpuvis_%s%s",
-                    std::tmpnam( NULL ), filename,
-                    !strrchr( filename, '.' ) ? ".dat" : "");
+            const std::string dest_path = string_format( "%s_gpuvis_%s",
+                    std::tmpnam( NULL ), name.c_str() );
 
             if ( mz_zip_reader_extract_to_file( &zip_archive, i, dest_path.c_str(), 0 ) )
-                to_load.push_back(dest_path);
+            {
+                to_load.push_back( dest_path );
+                loading_info.tmpfiles.insert( dest_path );
+            }
             else
                 logf( "[Error] %s failed to extract from %s (src: %s, dest: %s).",
                         __func__, zipfile, file_stat.m_filename, dest_path.c_str() );
@@ -622,59 +654,103 @@ static std::vector< std::string > extract_archive( const char *zipfile )
     return to_load;
 }
 
-bool MainApp::load_file( const char *filename, bool last )
+static MainApp::trace_type_t get_trace_type( const char *filename )
 {
-    GPUVIS_TRACE_BLOCKF( "%s: %s", __func__, filename );
-
-    if ( get_state() != State_Idle )
-    {
-        logf( "[Error] %s failed, currently loading %s.", __func__, m_loading_info.filename.c_str() );
-        return false;
-    }
-
     const char *ext = strrchr( filename, '.' );
+
     if ( ext && !strcmp( ext, ".etl" ) )
-    {
-        m_trace_type = trace_type_etl;
-    }
+        return MainApp::trace_type_etl;
     else if ( ext && ( !strcmp( ext, ".dat" ) || !strcmp( ext, ".trace" ) ) )
-    {
-        m_trace_type = trace_type_trace;
-    }
+        return MainApp::trace_type_trace;
     else if ( ext && ( !strcmp( ext, ".i915-dat" ) || !strcmp( ext, ".i915-trace" ) ) )
-    {
-        m_trace_win->m_trace_events.m_i915.is_xe = false;
-        m_trace_type = trace_type_i915_perf_trace;
-    }
+        return MainApp::trace_type_i915_perf_trace;
     else if ( ext && ( !strcmp( ext, ".xe-dat" ) || !strcmp( ext, ".xe-trace" ) ) )
-    {
-        m_trace_win->m_trace_events.m_i915.is_xe = true;
-        m_trace_type = trace_type_xe_perf_trace;
-    }
+        return MainApp::trace_type_xe_perf_trace;
 #if defined( HAVE_RAPIDJSON )
     else if ( ext && !strcmp( ext, ".json" ) )
+        return MainApp::trace_type_perf;
+#endif
+
+    return MainApp::trace_type_invalid;
+}
+
+bool MainApp::load_files( const std::vector< std::string > &filenames )
+{
+    // Memory files are named after their zip archive member
+    auto get_name = [this]( const std::string &file )
     {
-        m_trace_type = trace_type_perf;
+        auto memfile = m_loading_info.memfiles.find( file );
+
+        return ( memfile != m_loading_info.memfiles.end() ) ? memfile->second.name.c_str() : file.c_str();
+    };
+
+    GPUVIS_TRACE_BLOCKF( "%s: %s", __func__, get_name( filenames[ 0 ] ) );
+
+    if ( get_state() != State_Idle )
+    {
+        logf( "[Error] %s failed, currently loading %s.", __func__, m_loading_info.filename.c_str() );
+        return false;
     }
-#endif
 
-    size_t filesize = get_file_size( filename );
-    if ( !filesize )
+    size_t filesize = 0;
+
+    m_loading_info.sources.clear();
+    for ( const std::string &file : filenames )
+    {
+        size_t size = get_file_size( file.c_str() );
+
+        // Skip sources we can't read, but keep loading the rest of the batch
+        if ( !size )
+        {
+            logf( "[Error] %s (%s) failed: %s", __func__, file.c_str(), strerror( errno ) );
+            continue;
+        }
+
+        m_loading_info.sources.emplace_back( new load_source_t );
+
+        load_source_t &source = *m_loading_info.sources.back();
+
+        source.filename = file;
+        source.type = get_trace_type( get_name( file ) );
+        source.is_tmpfile = !!m_loading_info.tmpfiles.count( file );
+        if ( m_loading_info.memfiles.count( file ) )
+            source.memfd = m_loading_info.memfiles[ file ].fd;
+        source.is_standalone = ( source.type == trace_type_i915_perf_trace ) ||
+                               ( source.type == trace_type_xe_perf_trace );
+        filesize += size;
+    }
+
+    if ( m_loading_info.sources.empty() )
     {
-        logf( "[Error] %s (%s) failed: %s", __func__, filename, strerror( errno ) );
+        logf( "[Error] %s failed: no readable trace files.", __func__ );
         return false;
     }
 
+    const char *filename = get_name( m_loading_info.sources[ 0 ]->filename );
+
     set_state( State_Loading, filename );
 
+    // Filter and tdopexpr jobs read m_events, which we're about to add to
+    if ( m_trace_win )
+    {
+        m_trace_win->filter_job_cancel();
+        m_trace_win->m_trace_events.tdopexpr_job_cancel();
+    }
+
     // delete m_trace_win;
     if ( !m_trace_win )
         m_trace_win = new TraceWin( filename, filesize );
 
+    for ( const auto &source : m_loading_info.sources )
+    {
+        if ( source->type == trace_type_i915_perf_trace )
+            m_trace_win->m_trace_events.m_i915.is_xe = false;
+        else if ( source->type == trace_type_xe_perf_trace )
+            m_trace_win->m_trace_events.m_i915.is_xe = true;
+    }
+
     m_loading_info.win = m_trace_win;
-    m_loading_info.type = m_trace_type;
     m_loading_info.thread = SDL_CreateThread( thread_func, "eventloader", &m_loading_info );
-    m_loading_info.last = last;
     if ( !m_loading_info.thread )
     {
         logf( "[Error] %s: SDL_CreateThread failed.", __func__ );
@@ -682,6 +758,7 @@ bool MainApp::load_file( const char *filename, bool last )
         delete m_trace_win;
         m_trace_win = NULL;
 
+        m_loading_info.sources.clear();
         set_state( State_Idle );
         return false;
     }
@@ -695,32 +772,31 @@ static bool is_amd_timeline_event( const trace_event_t &event )
     if ( !event.seqno )
         return false;
 
-    const char *context = get_event_field_val( event, "context", NULL );
-    const char *timeline = get_event_field_val( event, "timeline", NULL );
+    static event_field_slot_t s_context( "context" );
+    static event_field_slot_t s_timeline( "timeline" );
 
-    if ( !context || !timeline )
+    if ( ( s_context.find( event ) < 0 ) || ( s_timeline.find( event ) < 0 ) )
         return false;
 
     return ( event.is_fence_signaled() ||
-             !strcmp( event.name, "amdgpu_cs_ioctl" ) ||
-             !strcmp( event.name, "amdgpu_sched_run_job" ) );
+             ( event.type == TRACE_EVENT_amdgpu_cs_ioctl ) ||
+             ( event.type == TRACE_EVENT_amdgpu_sched_run_job ) );
 }
 
 static bool is_drm_sched_timeline_event( const trace_event_t &event )
 {
-    return ( !strcmp( event.name, "drm_sched_job" ) ||
-             !strcmp( event.name, "drm_run_job" ) ||
-             !strcmp( event.name, "drm_sched_process_job" ) );
+    return ( ( event.type >= TRACE_EVENT_drm_sched_job ) &&
+             ( event.type <= TRACE_EVENT_drm_sched_process_job ) );
 }
 
 static void add_sched_switch_pid_comm( trace_info_t &trace_info, const trace_event_t &event,
-                                       const char *pidstr, const char *commstr )
+                                       const event_field_slot_t &pidslot, const event_field_slot_t &commslot )
 {
-    int pid = atoi( get_event_field_val( event, pidstr ) );
+    int pid = ( int )pidslot.get_int( event );
 
     if ( pid )
     {
-        const char *comm = get_event_field_val( event, commstr );
+        const char *comm = commslot.get_val( event );
 
         // If this pid is not in our pid_comm map or it is a sched_switch
         //  pid we already added, then map the pid -> the latest comm value
@@ -736,22 +812,21 @@ static void add_sched_switch_pid_comm( trace_info_t &trace_info, const trace_eve
     }
 }
 
-static bool is_msm_timeline_event( const char *name )
+static bool is_msm_timeline_event( const trace_event_t &event )
 {
-    return ( !strcmp( name, "msm_gpu_submit" ) ||
-            !strcmp( name, "msm_gpu_submit_flush" ) ||
-            !strcmp( name, "msm_gpu_submit_retired" ) ||
-            !strcmp( name, "msm_gpu_preemption_trigger" ) ||
-            !strcmp( name, "msm_gpu_preemption_irq" ));
+    return ( ( event.type >= TRACE_EVENT_msm_gpu_submit ) &&
+             ( event.type <= TRACE_EVENT_msm_gpu_preemption_irq ) );
 }
 
-static bool is_msm_freq_event( const char *name )
+static bool is_msm_freq_event( const trace_event_t &event )
 {
-    return ( !strcmp( name, "msm_gpu_freq_change" ) );
+    return ( event.type == TRACE_EVENT_msm_gpu_freq_change );
 }
 
 TraceEvents::~TraceEvents()
 {
+    tdopexpr_job_cancel();
+
     for ( trace_event_t &event : m_events )
     {
         if ( event.fields )
@@ -763,15 +838,13 @@ TraceEvents::~TraceEvents()
     }
 }
 
-// Callback from trace_read.cpp. We mostly just store the events in our array
-//  and then init_new_event() does the real work of initializing them later.
-int TraceEvents::new_event_cb( const trace_event_t &event )
+// Callback from trace_read.cpp. We mostly just store the events in the array
+//  for the file being read and then init_new_event() does the real work of
+//  initializing them later. Files can be read on separate threads.
+int TraceEvents::new_event_cb( std::vector< trace_event_t > &events, const trace_event_t &event )
 {
-    // Add event to our m_events array
-    m_events.push_back( event );
-
-    // Record the maximum crtc value we've ever seen
-    m_crtc_max = std::max< int >( m_crtc_max, event.crtc );
+    // Add event to the file's events array
+    events.push_back( event );
 
     // 1+ means loading events
     SDL_AtomicAdd( &m_eventsloaded, 1 );
@@ -780,22 +853,46 @@ int TraceEvents::new_event_cb( const trace_event_t &event )
     return ( s_app().get_state() == MainApp::State_CancelLoading );
 }
 
-int MainApp::load_trace_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb )
+int MainApp::load_trace_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb, bool use_cache )
 {
-    return read_trace_file( loading_info->filename.c_str(), trace_events.m_strpool,
+    const char *filename = source.filename.c_str();
+
+    if ( use_cache &&
+         !read_trace_cache( filename, trace_events.m_strpool, trace_events.m_trace_info, trace_cb ) )
+    {
+        logf( "Read events from %s", trace_cache_filename( filename ).c_str() );
+        return 0;
+    }
+
+    int ret = read_trace_file( filename, trace_events.m_strpool,
         trace_events.m_trace_info, trace_cb );
+
+    // Don't cache partial loads
+    if ( use_cache && ( ret >= 0 ) && ( s_app().get_state() != State_CancelLoading ) &&
+         !trace_events.m_load_preview.is_stopped() )
+    {
+        GPUVIS_TRACE_BLOCK( "write_trace_cache" );
+
+        if ( write_trace_cache( filename, trace_events.m_trace_info,
+                                source.events, trace_events.m_strpool ) < 0 )
+        {
+            logf( "[Warning] Failed to write %s", trace_cache_filename( filename ).c_str() );
+        }
+    }
+
+    return ret;
 }
 
-int MainApp::load_etl_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb )
+int MainApp::load_etl_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb )
 {
-    return read_etl_file( loading_info->filename.c_str(), trace_events.m_strpool,
+    return read_etl_file( source.filename.c_str(), trace_events.m_strpool,
         trace_events.m_trace_info, trace_cb );
 }
 
-int MainApp::load_xe_perf_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb )
+int MainApp::load_xe_perf_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb )
 {
-    int ret = read_xe_perf_file( loading_info->filename.c_str(), trace_events.m_strpool,
-        trace_events.m_trace_info, &trace_events.xe_perf_reader, trace_cb );
+    int ret = read_xe_perf_file( source.filename.c_str(), trace_events.m_strpool,
+        source.trace_info, &trace_events.xe_perf_reader, trace_cb );
 
     if ( ret == 0 )
     {
@@ -806,10 +903,10 @@ int MainApp::load_xe_perf_file( loading_info_t *loading_info, TraceEvents &trace
     return ret;
 }
 
-int MainApp::load_i915_perf_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb )
+int MainApp::load_i915_perf_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb )
 {
-    int ret = read_i915_perf_file( loading_info->filename.c_str(), trace_events.m_strpool,
-        trace_events.m_trace_info, &trace_events.i915_perf_reader, trace_cb );
+    int ret = read_i915_perf_file( source.filename.c_str(), trace_events.m_strpool,
+        source.trace_info, &trace_events.i915_perf_reader, trace_cb );
 
     if ( ret == 0 )
     {
@@ -821,13 +918,13 @@ int MainApp::load_i915_perf_file( loading_info_t *loading_info, TraceEvents &tra
 }
 
 #if defined( HAVE_RAPIDJSON )
-int MainApp::load_perf_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb )
+int MainApp::load_perf_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb )
 {
     StrPool& strpool = trace_events.m_strpool;
 
-    FILE* file = fopen(loading_info->filename.c_str(), "rb");
+    FILE* file = fopen(source.filename.c_str(), "rb");
     if (!file) {
-        logf("Failed to open file: %s", loading_info->filename.c_str());
+        logf("Failed to open file: %s", source.filename.c_str());
         return -1;
     }
 
@@ -838,7 +935,7 @@ int MainApp::load_perf_file( loading_info_t *loading_info, TraceEvents &trace_ev
     rapidjson::ParseResult ok = document.ParseStream(uis);
     fclose(file);
     if (!ok) {
-        logf("JSON parse error in file %s: %s (%zu)", loading_info->filename.c_str(),
+        logf("JSON parse error in file %s: %s (%zu)", source.filename.c_str(),
                 rapidjson::GetParseError_En(ok.Code()), ok.Offset());
         return -1;
     }
@@ -909,13 +1006,17 @@ int MainApp::load_perf_file( loading_info_t *loading_info, TraceEvents &trace_ev
             trace_event.fields[ 0 ].value = (topStack.HasMember("dso") && topStack["dso"].IsString()) ?
                 strpool.getstr(topStack["dso"].GetString()) : "<unknown>";
 
+            trace_event.backtrace_id = trace_events.m_backtraces.size();
+            trace_events.m_backtraces.emplace_back();
+
+            std::vector< const char * > &backtrace = trace_events.m_backtraces.back();
             for (size_t i = 0; i < callchain.Size() && callchain[i].IsObject(); ++i)
             {
                 auto cc = callchain[i].GetObject();
                 if (!cc.HasMember("symbol") || !cc["symbol"].IsString())
                     // Symbol unresolved. Stop the backtrace here.
                     break;
-                trace_event.backtrace.push_back(strpool.getstr(cc["symbol"].GetString()));
+                backtrace.push_back(strpool.getstr(cc["symbol"].GetString()));
             }
 
             trace_cb(trace_event);
@@ -926,77 +1027,228 @@ int MainApp::load_perf_file( loading_info_t *loading_info, TraceEvents &trace_ev
 }
 #endif
 
-int SDLCALL MainApp::thread_func( void *data )
+// Read one input file into source.events
+void MainApp::load_source( load_source_t &source, TraceEvents &trace_events, bool use_cache )
 {
-    util_time_t t0 = util_get_time();
-    loading_info_t *loading_info = ( loading_info_t *)data;
-    TraceEvents &trace_events = loading_info->win->m_trace_events;
-    const char *filename = loading_info->filename.c_str();
+    const char *filename = source.filename.c_str();
 
-    {
-        GPUVIS_TRACE_BLOCKF( "read_trace_file: %s", filename );
+    GPUVIS_TRACE_BLOCKF( "read_trace_file: %s", filename );
 
-        logf( "Reading trace file %s...", filename );
+    logf( "Reading trace file %s...", filename );
 
-        EventCallback trace_cb = std::bind( &TraceEvents::new_event_cb, &trace_events, _1 );
-        trace_events.m_trace_info.trim_trace = s_opts().getb( OPT_TrimTrace );
-        trace_events.m_trace_info.m_tracestart = loading_info->tracestart;
-        trace_events.m_trace_info.m_tracelen = loading_info->tracelen;
-        loading_info->tracestart = 0;
-        loading_info->tracelen = 0;
+    EventCallback trace_cb = std::bind( &TraceEvents::new_event_cb, &trace_events, std::ref( source.events ), _1 );
 
-        int ret = 0;
-        switch ( loading_info->type )
-        {
-        case trace_type_trace:
-            ret = load_trace_file( loading_info, trace_events, trace_cb );
-            break;
-        case trace_type_etl:
-            ret = load_etl_file( loading_info, trace_events, trace_cb );
-            break;
-        case trace_type_xe_perf_trace:
-            ret = load_xe_perf_file( loading_info, trace_events, trace_cb );
-            break;
-        case trace_type_i915_perf_trace:
-            ret = load_i915_perf_file( loading_info, trace_events, trace_cb );
-            break;
+    switch ( source.type )
+    {
+    case trace_type_trace:
+        source.ret = load_trace_file( source, trace_events, trace_cb, use_cache );
+        break;
+    case trace_type_etl:
+        source.ret = load_etl_file( source, trace_events, trace_cb );
+        break;
+    case trace_type_xe_perf_trace:
+        source.ret = load_xe_perf_file( source, trace_events, trace_cb );
+        break;
+    case trace_type_i915_perf_trace:
+        source.ret = load_i915_perf_file( source, trace_events, trace_cb );
+        break;
 #if defined( HAVE_RAPIDJSON )
-        case trace_type_perf:
-            ret = load_perf_file( loading_info, trace_events, trace_cb );
-            break;
+    case trace_type_perf:
+        source.ret = load_perf_file( source, trace_events, trace_cb );
+        break;
 #endif
-        default:
-            ret = -1;
-            break;
-        }
+    default:
+        source.ret = -1;
+        break;
+    }
+
+    if ( source.is_tmpfile )
+        std::remove( filename );
+    if ( source.memfd >= 0 )
+        memfile_close( source.memfd );
+}
+
+// Standalone files were read without knowing where the trace starts. Drop
+//  perf timelines starting before the first trace event.
+static void finish_standalone_source( MainApp::load_source_t &source, TraceEvents &trace_events )
+{
+    std::unordered_set< uint32_t > trimmed;
+    int64_t min_file_ts = trace_events.m_trace_info.min_file_ts;
+
+    for ( const trace_event_t &event : source.events )
+    {
+        if ( event.has_duration() && ( event.ts < min_file_ts ) )
+            trimmed.insert( event.i915_perf_timeline );
+    }
+
+    if ( !trimmed.empty() )
+    {
+        auto it = std::remove_if( source.events.begin(), source.events.end(),
+                                  [&trimmed]( const trace_event_t &event )
+                                      { return !!trimmed.count( event.i915_perf_timeline ); } );
+
+        source.events.erase( it, source.events.end() );
+    }
+}
+
+// Each file reads its events in time order, so merge them instead of sorting
+//  everything. Events with the same timestamp stay in file order.
+static void merge_source_events( std::vector< trace_event_t > &events,
+                                 std::vector< std::vector< trace_event_t > * > &lists )
+{
+    // Keep events from earlier loads
+    std::vector< trace_event_t > prev_events;
+
+    if ( !events.empty() )
+    {
+        prev_events.swap( events );
+        lists.insert( lists.begin(), &prev_events );
+    }
 
-        if (loading_info->tmpfiles.count(loading_info->filename))
+    size_t count = 0;
+    for ( std::vector< trace_event_t > *list : lists )
+    {
+        // Shouldn't happen, but perf and etl files don't promise ordering
+        if ( !std::is_sorted( list->begin(), list->end(),
+                              []( const trace_event_t &lx, const trace_event_t &rx ) { return lx.ts < rx.ts; } ) )
         {
-            std::remove(filename);
-            loading_info->tmpfiles.erase(filename);
+            std::stable_sort( list->begin(), list->end(),
+                              []( const trace_event_t &lx, const trace_event_t &rx ) { return lx.ts < rx.ts; } );
         }
+        count += list->size();
+    }
 
-        if ( ret < 0 )
+    lists.erase( std::remove_if( lists.begin(), lists.end(),
+                                 []( const std::vector< trace_event_t > *list ) { return list->empty(); } ),
+                 lists.end() );
+
+    if ( lists.size() == 1 )
+    {
+        events.swap( *lists[ 0 ] );
+        return;
+    }
+
+    // Min heap of ( ts, list index ): ties go to the earlier list
+    typedef std::pair< int64_t, size_t > head_t;
+    std::priority_queue< head_t, std::vector< head_t >, std::greater< head_t > > heads;
+    std::vector< size_t > pos( lists.size(), 0 );
+
+    events.reserve( count );
+    for ( size_t i = 0; i < lists.size(); i++ )
+        heads.push( { ( *lists[ i ] )[ 0 ].ts, i } );
+
+    while ( !heads.empty() )
+    {
+        size_t i = heads.top().second;
+        std::vector< trace_event_t > &list = *lists[ i ];
+
+        heads.pop();
+        events.push_back( list[ pos[ i ] ] );
+
+        if ( ++pos[ i ] < list.size() )
+            heads.push( { list[ pos[ i ] ].ts, i } );
+    }
+
+    for ( std::vector< trace_event_t > *list : lists )
+    {
+        list->clear();
+        list->shrink_to_fit();
+    }
+}
+
+int SDLCALL MainApp::thread_func( void *data )
+{
+    util_time_t t0 = util_get_time();
+    loading_info_t *loading_info = ( loading_info_t *)data;
+    TraceEvents &trace_events = loading_info->win->m_trace_events;
+    std::vector< std::unique_ptr< load_source_t > > &sources = loading_info->sources;
+    std::vector< std::thread > threads;
+    int ret = 0;
+
+    trace_events.m_trace_info.trim_trace = s_opts().getb( OPT_TrimTrace );
+    trace_events.m_trace_info.parallel_load = s_opts().getb( OPT_ParallelLoad );
+    trace_events.m_trace_info.lazy_fields = s_opts().getb( OPT_LazyFieldFormat );
+    trace_events.m_trace_info.load_preview = &trace_events.m_load_preview;
+    trace_events.m_load_preview.m_label_files = std::count_if( sources.begin(), sources.end(),
+            []( const std::unique_ptr< load_source_t > &source ) { return !source->is_standalone; } ) > 1;
+    trace_events.m_trace_info.cancelled = []() { return s_app().get_state() == State_CancelLoading; };
+    trace_events.m_trace_info.m_tracestart = loading_info->tracestart;
+    trace_events.m_trace_info.m_tracelen = loading_info->tracelen;
+    loading_info->tracestart = 0;
+    loading_info->tracelen = 0;
+
+    // Only cache single trace.dat loads. Extracted zip files are temporary
+    // and events from multiple files get merged.
+    bool use_cache = s_opts().getb( OPT_EventCache ) &&
+            ( sources.size() == 1 ) && trace_events.m_events.empty() &&
+            !sources[ 0 ]->is_tmpfile && ( sources[ 0 ]->memfd < 0 );
+
+    // Read standalone files on their own threads while the trace files
+    //  (which share m_trace_info) get read on this one.
+    for ( std::unique_ptr< load_source_t > &source : sources )
+    {
+        if ( source->is_standalone )
         {
-            logf( "[Error] load_trace_file(%s) failed.", filename );
+            // Trimmed to the trace start in finish_standalone_source()
+            source->trace_info.min_file_ts = 0;
 
-            // -1 means loading error
-            SDL_AtomicSet( &trace_events.m_eventsloaded, -1 );
-            s_app().set_state( State_Idle );
-            return -1;
+            threads.emplace_back( load_source, std::ref( *source ), std::ref( trace_events ), false );
         }
     }
 
-    if (loading_info->last)
+    for ( std::unique_ptr< load_source_t > &source : sources )
+    {
+        if ( !source->is_standalone )
+            load_source( *source, trace_events, use_cache );
+    }
+
+    for ( std::thread &thread : threads )
+        thread.join();
+
+    for ( std::unique_ptr< load_source_t > &source : sources )
+    {
+        if ( source->is_tmpfile )
+            loading_info->tmpfiles.erase( source->filename );
+        if ( source->memfd >= 0 )
+            loading_info->memfiles.erase( source->filename );
+
+        if ( source->ret < 0 )
+        {
+            logf( "[Error] load_trace_file(%s) failed.", source->filename.c_str() );
+            ret = source->ret;
+        }
+    }
+
+    if ( ret < 0 )
+    {
+        // -1 means loading error
+        SDL_AtomicSet( &trace_events.m_eventsloaded, -1 );
+        sources.clear();
+        s_app().set_state( State_Idle );
+        return -1;
+    }
+
     {
         GPUVIS_TRACE_BLOCK( "trace_init" );
 
-        // Sort events (with multiple files, events are added out of order)
-        std::sort( trace_events.m_events.begin(), trace_events.m_events.end(),
-                   [=]( const trace_event_t& lx, const trace_event_t& rx )
-                       {
-                           return lx.ts < rx.ts;
-                       } );
+        static event_field_slot_t s_prev_pid( "prev_pid" );
+        static event_field_slot_t s_prev_comm( "prev_comm" );
+        static event_field_slot_t s_next_pid( "next_pid" );
+        static event_field_slot_t s_next_comm( "next_comm" );
+
+        std::vector< std::vector< trace_event_t > * > lists;
+
+        for ( std::unique_ptr< load_source_t > &source : sources )
+        {
+            if ( source->is_standalone )
+                finish_standalone_source( *source, trace_events );
+
+            lists.push_back( &source->events );
+        }
+
+        // Merge events from all our files (with multiple files, events are added out of order)
+        merge_source_events( trace_events.m_events, lists );
+        sources.clear();
 
         // Assign event ids
         for ( uint32_t i = 0; i < trace_events.m_events.size(); i++ ) {
@@ -1004,12 +1256,15 @@ int SDLCALL MainApp::thread_func( void *data )
 
             event.id = i;
 
+            // Record the maximum crtc value we've ever seen
+            trace_events.m_crtc_max = std::max< int >( trace_events.m_crtc_max, event.crtc );
+
             // If this is a sched_switch event, see if it has comm info we don't know about.
             // This is the reason we're initializing events in two passes to collect all this data.
             if ( event.is_sched_switch() )
             {
-                add_sched_switch_pid_comm( trace_events.m_trace_info, event, "prev_pid", "prev_comm" );
-                add_sched_switch_pid_comm( trace_events.m_trace_info, event, "next_pid", "next_comm" );
+                add_sched_switch_pid_comm( trace_events.m_trace_info, event, s_prev_pid, s_prev_comm );
+                add_sched_switch_pid_comm( trace_events.m_trace_info, event, s_next_pid, s_next_comm );
             }
             else if ( event.is_ftrace_print() || event.is_gpuvis_print() )
             {
@@ -1027,7 +1282,7 @@ int SDLCALL MainApp::thread_func( void *data )
         const std::string str = string_format(
                     "Events read: %lu (Load:%.2fms Init:%.2fms) (string chunks:%lu size:%lu)",
                     trace_events.m_events.size(), time_load, time_init,
-                    trace_events.m_strpool.m_alloc.m_chunks.size(), trace_events.m_strpool.m_alloc.m_totsize );
+                    trace_events.m_strpool.get_chunk_count(), trace_events.m_strpool.get_alloc_size() );
         logf( "%s", str.c_str() );
 
 #if !defined( GPUVIS_TRACE_UTILS_DISABLE )
@@ -1454,34 +1709,56 @@ void MainApp::render()
 
 void MainApp::update()
 {
-    while ( !m_loading_info.inputfiles.empty() && ( get_state() == State_Idle ) )
+    if ( !m_loading_info.inputfiles.empty() && ( get_state() == State_Idle ) )
     {
-        const auto &inputfile = m_loading_info.inputfiles[ 0 ];
-        const char *filename = inputfile.c_str();
-        const char *ext = strrchr( filename, '.' );
+        std::vector< std::string > filenames;
 
-        if ( ext && !strcmp( ext, ".zip" ) )
+        for ( size_t i = 0; i < m_loading_info.inputfiles.size(); i++ )
         {
-            // Extract archive into temporary files and add them to the
-            // list of files to load.
-            const auto to_load = extract_archive(filename);
-            m_loading_info.inputfiles.insert(m_loading_info.inputfiles.end(),
-                    to_load.begin(), to_load.end());
-            m_loading_info.tmpfiles.insert(to_load.begin(), to_load.end());
+            const char *filename = m_loading_info.inputfiles[ i ].c_str();
+            const char *ext = strrchr( filename, '.' );
+
+            if ( ext && !strcmp( ext, ".zip" ) )
+            {
+                // Extract archive into temporary files and add them to the
+                // list of files to load.
+                const auto to_load = extract_archive( filename, m_loading_info );
+
+                m_loading_info.inputfiles.insert( m_loading_info.inputfiles.end(),
+                        to_load.begin(), to_load.end() );
+            }
+            else
+            {
+                filenames.push_back( m_loading_info.inputfiles[ i ] );
+            }
         }
-        else if (!load_file( filename, m_loading_info.inputfiles.size() == 1 ) &&
-                m_loading_info.tmpfiles.count(inputfile))
+
+        m_loading_info.inputfiles.clear();
+
+        // Load all files together so they can be read concurrently and merged
+        if ( !filenames.empty() && !load_files( filenames ) )
         {
             // XXX: So long as this method is called from one thread at a time,
             // there is no need to lock around access to m_loading_info since
             // it is only ever accessed n this thread when state is State_Idle
             // and it is only ever accessed in the worker thread when state is
             // not State_Idle.
-            std::remove(filename);
-            m_loading_info.tmpfiles.erase(inputfile);
-        }
+            for ( const std::string &filename : filenames )
+            {
+                auto memfile = m_loading_info.memfiles.find( filename );
 
-        m_loading_info.inputfiles.erase( m_loading_info.inputfiles.begin() );
+                if ( memfile != m_loading_info.memfiles.end() )
+                {
+                    memfile_close( memfile->second.fd );
+                    m_loading_info.memfiles.erase( memfile );
+                }
+                else if ( m_loading_info.tmpfiles.count( filename ) )
+                {
+                    std::remove( filename.c_str() );
+                    m_loading_info.tmpfiles.erase( filename );
+                }
+            }
+        }
     }
 
     if ( ( m_font_main.m_changed || m_font_small.m_changed ) &&
@@ -1562,29 +1839,7 @@ void TraceWin::graph_marker_set( size_t index, int64_t ts, const char *str )
 
 uint32_t TraceWin::ts_to_eventid( int64_t ts )
 {
-    // When running a debug build w/ ASAN on, the lower_bound function is
-    //  horribly slow so we cache the timestamp to event ids.
-    uint32_t *peventid = m_ts_to_eventid_cache.get_val( ts );
-    if ( peventid )
-        return *peventid;
-
-    trace_event_t x;
-    const std::vector< trace_event_t > &events = m_trace_events.m_events;
-
-    x.ts = ts;
-
-    auto eventidx = std::lower_bound( events.begin(), events.end(), x,
-        []( const trace_event_t &f1, const trace_event_t &f2 ) {
-            return f1.ts < f2.ts;
-        } );
-
-    uint32_t id = eventidx - events.begin();
-
-    if ( id >= events.size() )
-        id = events.size() - 1;
-
-    m_ts_to_eventid_cache.set_val( ts, id );
-    return id;
+    return m_trace_events.ts_to_eventid( ts );
 }
 
 uint32_t TraceWin::timestr_to_eventid( const char *buf )
@@ -1594,60 +1849,73 @@ uint32_t TraceWin::timestr_to_eventid( const char *buf )
     return ts_to_eventid( ts );
 }
 
+// Builtin filter variables. filter_get_key_func() returns these pointers
+//  so filter_get_keyval_func() can match them without string compares.
+enum filter_var_t
+{
+    FILTER_VAR_name,
+    FILTER_VAR_comm,
+    FILTER_VAR_user_comm,
+    FILTER_VAR_id,
+    FILTER_VAR_pid,
+    FILTER_VAR_tgid,
+    FILTER_VAR_ts,
+    FILTER_VAR_cpu,
+    FILTER_VAR_duration,
+    FILTER_VAR_Max
+};
+static const char *s_filter_vars[ FILTER_VAR_Max ] =
+{
+    "name", "comm", "user_comm", "id", "pid", "tgid", "ts", "cpu", "duration"
+};
+
 const char *filter_get_key_func( StrPool *strpool, const char *name, size_t len )
 {
+    for ( size_t i = 0; i < FILTER_VAR_Max; i++ )
+    {
+        if ( !strncasecmp( name, s_filter_vars[ i ], len ) && !s_filter_vars[ i ][ len ] )
+            return s_filter_vars[ i ];
+    }
+
     return strpool->getstr( name, len );
 }
 
-const char *filter_get_keyval_func( trace_info_t *trace_info, const trace_event_t *event,
-                                    const char *name, char ( &buf )[ 64 ] )
+tdop_val_t filter_get_keyval_func( trace_info_t *trace_info, const trace_event_t *event, const char *name )
 {
-    if ( !strcasecmp( name, "name" ) )
-    {
-        return event->name;
-    }
-    else if ( !strcasecmp( name, "comm" ) )
-    {
-        return event->comm;
-    }
-    else if ( !strcasecmp( name, "user_comm" ) )
-    {
-        return event->user_comm;
-    }
-    else if ( !strcasecmp( name, "id" ) )
+    size_t var;
+
+    for ( var = 0; var < FILTER_VAR_Max; var++ )
     {
-        snprintf_safe( buf, "%u", event->id );
-        return buf;
+        if ( name == s_filter_vars[ var ] )
+            break;
     }
-    else if ( !strcasecmp( name, "pid" ) )
+
+    switch ( var )
     {
-        snprintf_safe( buf, "%d", event->pid );
-        return buf;
-    }
-    else if ( !strcasecmp( name, "tgid" ) )
+    case FILTER_VAR_name:
+        return tdop_val_str( event->name );
+    case FILTER_VAR_comm:
+        return tdop_val_str( event->comm );
+    case FILTER_VAR_user_comm:
+        return tdop_val_str( event->user_comm );
+    case FILTER_VAR_id:
+        return tdop_val_int( event->id );
+    case FILTER_VAR_pid:
+        return tdop_val_int( event->pid );
+    case FILTER_VAR_tgid:
     {
         int *tgid = trace_info->pid_tgid_map.get_val( event->pid );
 
-        snprintf_safe( buf, "%d", tgid ? *tgid : 0 );
-        return buf;
-    }
-    else if ( !strcasecmp( name, "ts" ) )
-    {
-        snprintf_safe( buf, "%.6f", event->ts * ( 1.0 / NSECS_PER_MSEC ) );
-        return buf;
+        return tdop_val_int( tgid ? *tgid : 0 );
     }
-    else if ( !strcasecmp( name, "cpu" ) )
-    {
-        snprintf_safe( buf, "%u", event->cpu );
-        return buf;
-    }
-    else if ( !strcasecmp( name, "duration" ) )
-    {
+    case FILTER_VAR_ts:
+        return tdop_val_float( event->ts * ( 1.0 / NSECS_PER_MSEC ) );
+    case FILTER_VAR_cpu:
+        return tdop_val_int( event->cpu );
+    case FILTER_VAR_duration:
         if ( !event->has_duration() )
-            buf[ 0 ] = 0;
-        else
-            snprintf_safe( buf, "%.6f", event->duration * ( 1.0 / NSECS_PER_MSEC ) );
-        return buf;
+            return tdop_val_str( "" );
+        return tdop_val_float( event->duration * ( 1.0 / NSECS_PER_MSEC ) );
     }
 
     for ( uint32_t i = 0; i < event->numfields; i++ )
@@ -1656,19 +1924,127 @@ const char *filter_get_keyval_func( trace_info_t *trace_info, const trace_event_
 
         // We can compare pointers since they're from same string pool
         if ( name == field.key )
-            return field.value;
+        {
+            int64_t val;
+
+            // Integer fields don't need to be rendered to compare them
+            if ( get_event_field_int( *event, i, val, true ) )
+                return tdop_val_int( val );
+
+            return tdop_val_str( event->get_field_val( i ) );
+        }
     }
 
-    return "";
+    return tdop_val_str( "" );
+}
+
+bool TraceEvents::tdopexpr_eval_chunks( class TdopExpr *tdop_expr, std::vector< std::vector< uint32_t > > &chunks,
+                                        SDL_atomic_t *eventsdone, SDL_atomic_t *cancel )
+{
+    // Events between progress updates and cancel checks
+    const size_t block_size = 16384;
+    size_t count = m_events.size();
+    size_t nchunks = std::max< size_t >( 1, 4 * std::thread::hardware_concurrency() );
+    size_t chunk_size = ( count + nchunks - 1 ) / nchunks;
+
+    chunks.clear();
+    chunks.resize( nchunks );
+
+    parallel_for( nchunks, [ & ]( size_t i )
+    {
+        size_t start = std::min( count, i * chunk_size );
+        size_t end = std::min( count, start + chunk_size );
+        const trace_event_t *pevent = NULL;
+        tdop_get_keyval_func get_keyval_func = [ & ]( const char *key )
+            { return filter_get_keyval_func( &m_trace_info, pevent, key ); };
+
+        for ( size_t block = start; block < end; block += block_size )
+        {
+            size_t block_end = std::min( end, block + block_size );
+
+            if ( cancel && SDL_AtomicGet( cancel ) )
+                return;
+
+            for ( size_t idx = block; idx < block_end; idx++ )
+            {
+                pevent = &m_events[ idx ];
+
+                if ( tdopexpr_exec( tdop_expr, get_keyval_func )[ 0 ] )
+                    chunks[ i ].push_back( pevent->id );
+            }
+
+            if ( eventsdone )
+                SDL_AtomicAdd( eventsdone, ( int )( block_end - block ) );
+        }
+    } );
+
+    return !cancel || !SDL_AtomicGet( cancel );
+}
+
+// Background evaluation of a tdop expression for get_tdopexpr_locs()
+struct tdopexpr_job_t
+{
+    TraceEvents *trace_events = nullptr;
+    class TdopExpr *tdop_expr = nullptr;
+    SDL_Thread *thread = nullptr;
+
+    // Count of events evaluated so far
+    SDL_atomic_t eventsdone = { 0 };
+    SDL_atomic_t cancel = { 0 };
+    SDL_atomic_t finished = { 0 };
+
+    // Ascending ids of matching events for each chunk of m_events
+    std::vector< std::vector< uint32_t > > chunks;
+};
+
+static int SDLCALL tdopexpr_thread_func( void *data )
+{
+    tdopexpr_job_t *job = ( tdopexpr_job_t * )data;
+
+    job->trace_events->tdopexpr_eval_chunks( job->tdop_expr, job->chunks, &job->eventsdone, &job->cancel );
+
+    SDL_AtomicSet( &job->finished, 1 );
+    return 0;
+}
+
+static void tdopexpr_job_delete( tdopexpr_job_t *job )
+{
+    if ( job->thread )
+        SDL_WaitThread( job->thread, NULL );
+
+    tdopexpr_delete( job->tdop_expr );
+    delete job;
 }
 
-const std::vector< uint32_t > *TraceEvents::get_tdopexpr_locs( const char *name, std::string *err )
+void TraceEvents::tdopexpr_job_cancel( const char *name )
 {
-    std::vector< uint32_t > *plocs;
+    uint64_t hashval = name ? hashstr64( name ) : 0;
+
+    for ( auto it = m_tdopexpr_jobs.m_map.begin(); it != m_tdopexpr_jobs.m_map.end(); )
+    {
+        if ( name && ( it->first != hashval ) )
+        {
+            it++;
+            continue;
+        }
+
+        SDL_AtomicSet( &it->second->cancel, 1 );
+        tdopexpr_job_delete( it->second );
+
+        it = m_tdopexpr_jobs.m_map.erase( it );
+    }
+}
+
+const IdList *TraceEvents::get_tdopexpr_locs( const char *name, std::string *err, float *progress )
+{
+    IdList *plocs;
     uint64_t hashval = hashstr64( name );
+    std::vector< std::vector< uint32_t > > chunks;
 
     if ( err )
         err->clear();
+    if ( progress )
+        *progress = 1.0f;
 
     // Try to find whatever our name hashed to. Name should be something like:
     //   $name=drm_vblank_event
@@ -1680,9 +2056,34 @@ const std::vector< uint32_t > *TraceEvents::get_tdopexpr_locs( const char *name,
     if ( m_failed_commands.find( hashval ) != m_failed_commands.end() )
         return NULL;
 
-    // If the name has a tdop expression variable prefix, try compiling it
-    if ( strchr( name, '$' ) )
+    tdopexpr_job_t **pjob = m_tdopexpr_jobs.get_val( hashval );
+
+    if ( pjob )
+    {
+        tdopexpr_job_t *job = *pjob;
+
+        // Still running: report how far along it is. Callers without
+        //  progress wait for it.
+        if ( progress && !SDL_AtomicGet( &job->finished ) )
+        {
+            float done = ( float )SDL_AtomicGet( &job->eventsdone ) / std::max< size_t >( 1, m_events.size() );
+
+            *progress = std::min< float >( done, 0.99f );
+            return NULL;
+        }
+
+        if ( job->thread )
+            SDL_WaitThread( job->thread, NULL );
+        job->thread = NULL;
+
+        chunks.swap( job->chunks );
+
+        tdopexpr_job_delete( job );
+        m_tdopexpr_jobs.m_map.erase( hashval );
+    }
+    else if ( strchr( name, '$' ) )
     {
+        // If the name has a tdop expression variable prefix, try compiling it
         std::string errstr;
         tdop_get_key_func get_key_func = std::bind( filter_get_key_func, &m_strpool, _1, _2 );
         class TdopExpr *tdop_expr = tdopexpr_compile( name, get_key_func, errstr );
@@ -1694,22 +2095,50 @@ const std::vector< uint32_t > *TraceEvents::get_tdopexpr_locs( const char *name,
             else
                 logf( "[Error] compiling '%s': %s", name, errstr.c_str() );
         }
-        else
+        else if ( progress )
         {
-            for ( trace_event_t &event : m_events )
+            tdopexpr_job_t *job = new tdopexpr_job_t;
+
+            job->trace_events = this;
+            job->tdop_expr = tdop_expr;
+            job->thread = SDL_CreateThread( tdopexpr_thread_func, "tdopexpr", job );
+            if ( !job->thread )
             {
-                const char *ret;
-                tdop_get_keyval_func get_keyval_func = std::bind( filter_get_keyval_func, &m_trace_info, &event, _1, _2 );
+                logf( "[Error] %s: SDL_CreateThread failed.", __func__ );
 
-                ret = tdopexpr_exec( tdop_expr, get_keyval_func );
-                if ( ret[ 0 ] )
-                    m_tdopexpr_locs.add_location_u64( hashval, event.id );
+                // Evaluate it on the next call then
+                tdopexpr_thread_func( job );
             }
 
+            m_tdopexpr_jobs.get_val( hashval, job );
+
+            *progress = 0.0f;
+            return NULL;
+        }
+        else
+        {
+            tdopexpr_eval_chunks( tdop_expr, chunks );
             tdopexpr_delete( tdop_expr );
         }
     }
 
+    size_t total = 0;
+    for ( const std::vector< uint32_t > &chunk : chunks )
+        total += chunk.size();
+
+    if ( total )
+    {
+        // Chunks are in ascending event id order, so we can just append them.
+        IdList &locs = *m_tdopexpr_locs.m_locs.get_val_create( hashval );
+
+        for ( const std::vector< uint32_t > &chunk : chunks )
+        {
+            for ( uint32_t id : chunk )
+                locs.push_back( id );
+        }
+        locs.shrink_to_fit();
+    }
+
     // Try to find this name/expression again and add to failed list if we miss again
     plocs = m_tdopexpr_locs.get_locations_u64( hashval );
     if ( !plocs )
@@ -1718,78 +2147,75 @@ const std::vector< uint32_t > *TraceEvents::get_tdopexpr_locs( const char *name,
     return plocs;
 }
 
-const std::vector< uint32_t > *TraceEvents::get_comm_locs( const char *name )
+const IdList *TraceEvents::get_comm_locs( const char *name )
 {
     return m_comm_locs.get_locations_str( name );
 }
 
-const std::vector< uint32_t > *TraceEvents::get_sched_switch_locs( int pid, switch_t switch_type )
+const IdList *TraceEvents::get_sched_switch_locs( int pid, switch_t switch_type )
 {
     return ( switch_type == SCHED_SWITCH_PREV ) ?
                 m_sched_switch_prev_locs.get_locations_u64( pid ) :
                 m_sched_switch_next_locs.get_locations_u64( pid );
 }
 
-const std::vector< uint32_t > *TraceEvents::get_timeline_locs( const char *name )
+const IdList *TraceEvents::get_timeline_locs( const char *name )
 {
     return m_amd_timeline_locs.get_locations_str( name );
 }
 
 // Pass a string like "gfx_249_91446"
-const std::vector< uint32_t > *TraceEvents::get_gfxcontext_locs( uint64_t gfxcontext_hash )
+const IdList *TraceEvents::get_gfxcontext_locs( uint64_t gfxcontext_hash )
 {
     return m_gfxcontext_locs.get_locations_u64( gfxcontext_hash );
 }
 
-uint32_t row_pos_t::get_row( int64_t min_ts, int64_t max_ts )
+void row_pos_t::calc_rows()
 {
-    uint32_t row = 0;
+    typedef std::pair< int64_t, uint32_t > row_end_t;
 
-    for ( ; row < m_row_pos.size(); row++ )
-    {
-        int64_t ts_end_prev = INT64_MIN;
-        int64_t ts_start_next = INT64_MAX;
+    // Rows still in use: min heap of ( max_ts, row )
+    std::priority_queue< row_end_t, std::vector< row_end_t >, std::greater< row_end_t > > busy;
+    // Rows free at current min_ts: min heap of row
+    std::priority_queue< uint32_t, std::vector< uint32_t >, std::greater< uint32_t > > free_rows;
 
-        // Find first element with start time >= min_ts
-        auto &rpos = m_row_pos[ row ];
-        auto idx = rpos.lower_bound( min_ts );
+    // Start order, longest block first for blocks starting at the same time
+    std::sort( m_blocks.begin(), m_blocks.end(),
+               []( const block_t &lval, const block_t &rval )
+    {
+        if ( lval.min_ts != rval.min_ts )
+            return ( lval.min_ts < rval.min_ts );
+        return ( lval.max_ts > rval.max_ts );
+    } );
 
-        if ( idx != rpos.end() )
+    m_rows = 0;
+    for ( block_t &block : m_blocks )
+    {
+        // Release rows which ended at or before we start
+        while ( !busy.empty() && ( busy.top().first <= block.min_ts ) )
         {
-            // Got item with start time >= our min_ts.
-            ts_start_next = idx->first;
+            free_rows.push( busy.top().second );
+            busy.pop();
+        }
 
-            if ( idx != rpos.begin() )
-            {
-                // Get previous item end time
-                --idx;
-                ts_end_prev = idx->second;
-            }
+        if ( !free_rows.empty() )
+        {
+            block.row = free_rows.top();
+            free_rows.pop();
+        }
+        else if ( m_rows < Opts::MAX_ROW_SIZE )
+        {
+            block.row = m_rows++;
         }
         else
         {
-            // No items start after us - grab last item in map
-            auto idx2 = rpos.rbegin();
-
-            // Get end of last item ever
-            if ( idx2 != rpos.rend() )
-                ts_end_prev = idx2->second;
+            // Out of rows - overlap on row 0
+            block.row = 0;
+            continue;
         }
 
-        // If start of next item is greater than our end
-        // And end of previous item is less than our start
-        if ( ( ts_start_next >= max_ts ) && ( ts_end_prev <= min_ts ) )
-            break;
+        busy.push( { block.max_ts, block.row } );
     }
-
-    if ( row >= m_row_pos.size() )
-        row = 0;
-
-    auto &rpos = m_row_pos[ row ];
-    rpos[ min_ts ] = max_ts;
-
-    m_rows = std::max< uint32_t >( m_rows, row + 1 );
-    return row;
 }
 
 void TraceEvents::update_fence_signaled_timeline_colors()
@@ -1799,7 +2225,7 @@ void TraceEvents::update_fence_signaled_timeline_colors()
 
     for ( auto &timeline_locs : m_amd_timeline_locs.m_locs.m_map )
     {
-        std::vector< uint32_t > &locs = timeline_locs.second;
+        const IdList &locs = timeline_locs.second;
 
         for ( uint32_t index : locs )
         {
@@ -1838,9 +2264,12 @@ void TraceEvents::update_tgid_colors()
         tgid_info.commstr = commstr;
     }
 
+    static event_field_slot_t s_prev_comm( "prev_comm" );
+    static event_field_slot_t s_prev_pid( "prev_pid" );
+
     for ( const auto &cpu_locs : m_sched_switch_cpu_locs.m_locs.m_map )
     {
-        const std::vector< uint32_t > &locs = cpu_locs.second;
+        const IdList &locs = cpu_locs.second;
 
         for ( uint32_t idx : locs )
         {
@@ -1848,8 +2277,8 @@ void TraceEvents::update_tgid_colors()
             float alpha = label_alpha;
             size_t len = ( size_t )-1;
             trace_event_t &sched_switch = m_events[ idx ];
-            const char *prev_comm = get_event_field_val( sched_switch, "prev_comm" );
-            const char *prev_pid = get_event_field_val( sched_switch, "prev_pid" );
+            const char *prev_comm = s_prev_comm.get_val( sched_switch );
+            const char *prev_pid = s_prev_pid.get_val( sched_switch );
 
             if ( !strncmp( prev_comm,      "swapper/", 8 ) )
                 len = 8;
@@ -1967,14 +2396,18 @@ static void check_for_gfxcontext_hash_collision( uint64_t hashval, const char *b
 
 uint64_t TraceEvents::get_event_gfxcontext_hash( const trace_event_t &event )
 {
-    if ( is_msm_timeline_event( event.name ) )
+    if ( is_msm_timeline_event( event ) )
     {
-        if (!strcmp( event.name, "msm_gpu_preemption_trigger" ))
+        if ( event.type == TRACE_EVENT_msm_gpu_preemption_trigger )
             return event.id;
-        else if (!strcmp( event.name, "msm_gpu_preemption_irq" ))
+        else if ( event.type == TRACE_EVENT_msm_gpu_preemption_irq )
             return event.id_start;
         else
-            return atoi( get_event_field_val( event, "id", "0" ) );
+        {
+            static event_field_slot_t s_id( "id" );
+
+            return ( int )s_id.get_int( event );
+        }
     }
 
     if ( is_drm_sched_timeline_event( event ) )
@@ -1984,8 +2417,10 @@ uint64_t TraceEvents::get_event_gfxcontext_hash( const trace_event_t &event )
 
     if ( event.seqno )
     {
-        const char *context = get_event_field_val( event, "context", NULL );
-        const char *timeline = get_event_field_val( event, "timeline", NULL );
+        static event_field_slot_t s_context( "context" );
+        static event_field_slot_t s_timeline( "timeline" );
+        const char *context = s_context.get_val( event, NULL );
+        const char *timeline = s_timeline.get_val( event, NULL );
 
         if ( timeline && context )
         {
@@ -2017,31 +2452,35 @@ std::string TraceEvents::get_ftrace_ctx_str( const trace_event_t &event )
 
 void TraceEvents::init_sched_switch_event( trace_event_t &event )
 {
-    bool is_psci_exit = !strcmp( event.name, "psci_domain_idle_exit" );
+    if ( event.type == TRACE_EVENT_psci_domain_idle_enter )
+    {
+        m_psci_idle_enter.set_begin( event.cpu, event.id );
+        return;
+    }
 
-    if ( is_psci_exit ) {
-        for (int32_t i = event.id; i >= 0; i--)
-            if (!strcmp( m_events[i].name, "psci_domain_idle_enter" )) {
-                if (event.cpu != m_events[i].cpu)
-                    continue;
+    if ( event.type == TRACE_EVENT_psci_domain_idle_exit )
+    {
+        uint32_t id_enter = m_psci_idle_enter.pop_begin( event.cpu );
 
-                event.id_start = m_events[i].id;
-                event.duration = event.ts - m_events[i].ts;
-                event.flags |= TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING;
-                m_sched_switch_cpu_locs.add_location_u64( event.cpu, event.id );
-                break;
-            }
+        if ( is_valid_id( id_enter ) )
+        {
+            event.id_start = id_enter;
+            event.duration = event.ts - m_events[ id_enter ].ts;
+            event.flags |= TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING;
+            m_sched_switch_cpu_locs.add_location_u64( event.cpu, event.id );
+        }
         return;
     }
 
-    const char *prev_pid_str = get_event_field_val( event, "prev_pid" );
-    const char *next_pid_str = get_event_field_val( event, "next_pid" );
+    static event_field_slot_t s_prev_pid( "prev_pid" );
+    static event_field_slot_t s_next_pid( "next_pid" );
+    static event_field_slot_t s_prev_state( "prev_state" );
 
-    if ( *prev_pid_str && *next_pid_str )
+    if ( ( s_prev_pid.find( event ) >= 0 ) && ( s_next_pid.find( event ) >= 0 ) )
     {
-        int prev_pid = atoi( prev_pid_str );
-        int next_pid = atoi( next_pid_str );
-        const std::vector< uint32_t > *plocs;
+        int prev_pid = ( int )s_prev_pid.get_int( event );
+        int next_pid = ( int )s_next_pid.get_int( event );
+        const IdList *plocs;
 
         // Seems that sched_switch event.pid is equal to the event prev_pid field.
         // We're running with this in several bits of code in gpuvis_graph, so assert it's true.
@@ -2057,15 +2496,11 @@ void TraceEvents::init_sched_switch_event( trace_event_t &event )
             // order to calculate the duration properly, we need to find the most recent event for the current cpu.
             if ( prev_pid == 0 && m_events[ ploc ].cpu != event.cpu )
             {
-                for (size_t i = plocs->size() - 1; i --> 0;)
-                {
-                    ploc = plocs->at( i );
+                uint32_t cpu = event.cpu;
+                uint32_t id = plocs->find_last_if( [&]( uint32_t locid ) { return m_events[ locid ].cpu == cpu; } );
 
-                    if ( m_events[ ploc ].cpu == event.cpu )
-                    {
-                        break;
-                    }
-                }
+                // No earlier event on this cpu, so fall back to the first one
+                ploc = is_valid_id( id ) ? id : plocs->front();
             }
 
             const trace_event_t &event_prev = m_events[ ploc ];
@@ -2076,7 +2511,7 @@ void TraceEvents::init_sched_switch_event( trace_event_t &event )
             // TASK_STOPPED (4): Stopped process by job control signal or ptrace
             // TASK_TRACED (8): Task is being monitored by other process (such as debugger)
             // TASK_ZOMBIE (32): Finished but waiting for parent to call wait() to cleanup
-            int prev_state = atoi( get_event_field_val( event, "prev_state" ) );
+            int prev_state = ( int )s_prev_state.get_int( event );
             int task_state = prev_state & ( TASK_REPORT_MAX - 1 );
 
             if ( task_state == 0 )
@@ -2113,10 +2548,14 @@ void TraceEvents::init_sched_switch_event( trace_event_t &event )
 void TraceEvents::init_sched_process_fork( trace_event_t &event )
 {
     // parent_comm=glxgears parent_pid=23543 child_comm=glxgears child_pid=23544
-    int tgid = atoi( get_event_field_val( event, "parent_pid", "0" ) );
-    int pid = atoi( get_event_field_val( event, "child_pid", "0" ) );
-    const char *tgid_comm = get_event_field_val( event, "parent_comm", NULL );
-    const char *child_comm = get_event_field_val( event, "child_comm", NULL );
+    static event_field_slot_t s_parent_pid( "parent_pid" );
+    static event_field_slot_t s_child_pid( "child_pid" );
+    static event_field_slot_t s_parent_comm( "parent_comm" );
+    static event_field_slot_t s_child_comm( "child_comm" );
+    int tgid = ( int )s_parent_pid.get_int( event );
+    int pid = ( int )s_child_pid.get_int( event );
+    const char *tgid_comm = s_parent_comm.get_val( event, NULL );
+    const char *child_comm = s_child_comm.get_val( event, NULL );
 
     if ( tgid && pid && tgid_comm && child_comm )
     {
@@ -2152,15 +2591,14 @@ void TraceEvents::init_amd_timeline_event( trace_event_t &event )
     m_gfxcontext_locs.add_location_u64( gfxcontext_hash, event.id );
 
     // Grab the event locations for this event context
-    const std::vector< uint32_t > *plocs = get_gfxcontext_locs( gfxcontext_hash );
+    const IdList *plocs = get_gfxcontext_locs( gfxcontext_hash );
     if ( plocs->size() > 1 )
     {
         // First event.
         const trace_event_t &event0 = m_events[ plocs->front() ];
 
         // Event right before the event we just added.
-        auto it = plocs->rbegin() + 1;
-        const trace_event_t &event_prev = m_events[ *it ];
+        const trace_event_t &event_prev = m_events[ ( *plocs )[ plocs->size() - 2 ] ];
 
         // Assume the user comm is the first comm event in this set.
         event.user_comm = event0.comm;
@@ -2181,9 +2619,12 @@ void TraceEvents::init_amd_timeline_event( trace_event_t &event )
 
 void TraceEvents::init_msm_timeline_event( trace_event_t &event )
 {
+    static event_field_slot_t s_ring_id( "ring_id" );
+    static event_field_slot_t s_ring_id_from( "ring_id_from" );
+    static event_field_slot_t s_ring_id_to( "ring_id_to" );
     bool is_preempt_trigger, is_preempt_irq;
-    is_preempt_trigger = !strcmp( event.name, "msm_gpu_preemption_trigger" );
-    is_preempt_irq = !strcmp( event.name, "msm_gpu_preemption_irq" );
+    is_preempt_trigger = ( event.type == TRACE_EVENT_msm_gpu_preemption_trigger );
+    is_preempt_irq = ( event.type == TRACE_EVENT_msm_gpu_preemption_irq );
 
     // We have a timeline for preemption which requires different handling
     if ( is_preempt_trigger || is_preempt_irq ) {
@@ -2192,8 +2633,8 @@ void TraceEvents::init_msm_timeline_event( trace_event_t &event )
         m_amd_timeline_locs.add_location_str( str.c_str(), event.id );
 
         if (is_preempt_trigger) {
-            int ring_from = atoi( get_event_field_val( event, "ring_id_from", "0" ) );
-            int ring_to = atoi( get_event_field_val( event, "ring_id_to", "0" ) );
+            int ring_from = ( int )s_ring_id_from.get_int( event );
+            int ring_to = ( int )s_ring_id_to.get_int( event );
             event.flags |= TRACE_FLAG_SW_QUEUE;
             event.user_comm = m_strpool.getstrf(  "%d -> %d",  ring_from, ring_to );
 
@@ -2204,13 +2645,13 @@ void TraceEvents::init_msm_timeline_event( trace_event_t &event )
         }
 
         if (is_preempt_irq) {
-            int ring_id = atoi( get_event_field_val( event, "ring_id", "0" ) );
+            int ring_id = ( int )s_ring_id.get_int( event );
             event.flags |= TRACE_FLAG_FENCE_SIGNALED;
             // We look for a previous trigger event to pair this one with
             for (int32_t i = event.id; i >= 0; i--)
                 if (!strcmp( m_events[i].name, "msm_gpu_preemption_trigger" )) {
                     // Ignore unamatched pairs (preemptions should never overlap)
-                    int ring_to = atoi( get_event_field_val( m_events[i], "ring_id_to", "0" ) );
+                    int ring_to = ( int )s_ring_id_to.get_int( m_events[i] );
                     if (ring_id != ring_to)
                         break;
 
@@ -2227,23 +2668,22 @@ void TraceEvents::init_msm_timeline_event( trace_event_t &event )
 
     uint64_t gfxcontext_hash = get_event_gfxcontext_hash( event );
 
-    int ringid = atoi( get_event_field_val( event, "ringid", "0" ) );
+    static event_field_slot_t s_ringid( "ringid" );
+    int ringid = ( int )s_ringid.get_int( event );
     std::string str = string_format( "msm ring%d", ringid );
 
     m_amd_timeline_locs.add_location_str( str.c_str(), event.id );
 
     m_gfxcontext_locs.add_location_u64( gfxcontext_hash, event.id );
 
-    const std::vector< uint32_t > *plocs = m_gfxcontext_locs.get_locations_u64( gfxcontext_hash );
+    const IdList *plocs = m_gfxcontext_locs.get_locations_u64( gfxcontext_hash );
 
-    if ( !strcmp( event.name, "msm_gpu_submit_retired" ) )
+    if ( event.type == TRACE_EVENT_msm_gpu_submit_retired )
     {
-        trace_event_t event0;
-
         // Look for a matching flush event
-        for (int32_t i =  plocs->size() - 1; i >= 0; i--) {
-            event0 = m_events[ plocs->at(i) ];
-            if (!strcmp( event0.name, "msm_gpu_submit_flush" ) ) {
+        for ( uint32_t id : *plocs ) {
+            const trace_event_t &event0 = m_events[ id ];
+            if ( event0.type == TRACE_EVENT_msm_gpu_submit_flush ) {
                 event.flags |= TRACE_FLAG_FENCE_SIGNALED;
 
                 for ( uint32_t idx : *plocs )
@@ -2254,7 +2694,7 @@ void TraceEvents::init_msm_timeline_event( trace_event_t &event )
             }
         }
     }
-    else if ( !strcmp( event.name, "msm_gpu_submit_flush" ) )
+    else if ( event.type == TRACE_EVENT_msm_gpu_submit_flush )
     {
         event.flags |= TRACE_FLAG_HW_QUEUE;
     }
@@ -2266,8 +2706,7 @@ void TraceEvents::init_msm_timeline_event( trace_event_t &event )
         event0.flags |= TRACE_FLAG_SW_QUEUE;
 
         // Event right before the event we just added.
-        auto it = plocs->rbegin() + 1;
-        trace_event_t &event_prev = m_events[ *it ];
+        trace_event_t &event_prev = m_events[ ( *plocs )[ plocs->size() - 2 ] ];
 
         event.user_comm = event0.comm;
         event.id_start = event_prev.id;
@@ -2281,24 +2720,38 @@ void TraceEvents::init_msm_freq_event( trace_event_t &event )
     m_msm_freq_locs.add_location_str( str.c_str(), event.id );
 }
 
+// Return the last event in locs with any of flags set, or NULL
+static const trace_event_t *find_last_flagged_event( const std::vector< trace_event_t > &events,
+                                                     const IdList &locs, uint32_t flags )
+{
+    uint32_t id = locs.find_last_if( [&]( uint32_t locid ) { return !!( events[ locid ].flags & flags ); } );
+
+    return is_valid_id( id ) ? &events[ id ] : NULL;
+}
+
 void TraceEvents::init_drm_sched_timeline_event( trace_event_t &event )
 {
+    static event_field_slot_t s_fence( "fence" );
+    static event_field_slot_t s_job_count( "job_count" );
+    static event_field_slot_t s_hw_job_count( "hw_job_count" );
+    static event_field_slot_t s_id( "id" );
+    static event_field_slot_t s_name( "name" );
     std::string str;
     const char *ring;
     uint32_t fence;
 
-    fence = strtoul( get_event_field_val( event, "fence", "0" ), nullptr, 0 );
+    fence = ( uint32_t )s_fence.get_int( event );
     event.flags |= TRACE_FLAG_TIMELINE;
 
-    if ( !strcmp( event.name, "drm_sched_job" ) )
+    if ( event.type == TRACE_EVENT_drm_sched_job )
     {
         event.flags |= TRACE_FLAG_SW_QUEUE;
         event.id_start = INVALID_ID;
-        event.graph_row_id = atoi( get_event_field_val( event, "job_count", "0" ) ) +
-                             atoi( get_event_field_val( event, "hw_job_count", "0" ) );
-        event.seqno = strtoul( get_event_field_val( event, "id", "0" ), nullptr, 0 );
-        m_drm_sched.outstanding_jobs[fence] = event.seqno;
-        ring = get_event_field_val( event, "name", "<unknown>" );
+        event.graph_row_id = ( int )s_job_count.get_int( event ) +
+                             ( int )s_hw_job_count.get_int( event );
+        event.seqno = ( uint32_t )s_id.get_int( event );
+        m_drm_sched.outstanding_jobs.set_begin( fence, event.id );
+        ring = s_name.get_val( event, "<unknown>" );
         str = string_format( "drm sched %s", ring );
         m_drm_sched.rings.insert(str);
         m_amd_timeline_locs.add_location_str( str.c_str(), event.id );
@@ -2306,77 +2759,67 @@ void TraceEvents::init_drm_sched_timeline_event( trace_event_t &event )
         return;
     }
 
-    auto job = m_drm_sched.outstanding_jobs.find( fence );
-    if ( job == m_drm_sched.outstanding_jobs.end() ) {
+    uint32_t job_id = m_drm_sched.outstanding_jobs.get_begin( fence );
+    if ( !is_valid_id( job_id ) ) {
         // no in flight job. This event will be dropped
         return;
     }
 
-    const std::vector< uint32_t > *plocs = get_gfxcontext_locs( job->second );
+    const IdList *plocs = get_gfxcontext_locs( m_events[ job_id ].seqno );
     if ( plocs->size()  < 1 )
     {
         // no previous start event. This event will be dropped
         return;
     }
 
-    if ( !strcmp( event.name, "drm_run_job" ) )
-    {
-        for ( auto it = plocs->rbegin(); it != plocs->rend(); ++it )
-        {
-            const trace_event_t &e = m_events[ *it ];
-            if ( e.flags & TRACE_FLAG_FENCE_SIGNALED )
-            {
-                // if we hit an end event, we should have already found a start
-                // event. Ignore this event, it will be dropped
-                return;
-            }
-
-            if ( e.flags & TRACE_FLAG_SW_QUEUE )
-            {
-                ring = get_event_field_val( e, "name", "<unknown>" );
-                str = string_format( "drm sched %s", ring );
-                m_drm_sched.rings.insert( str );
-                m_amd_timeline_locs.add_location_str( str.c_str(), event.id );
-                event.user_comm = e.comm;
-                event.id_start = e.id;
-                event.flags |= TRACE_FLAG_HW_QUEUE;
-                event.graph_row_id = e.graph_row_id;
-                event.seqno = e.seqno;
-                m_gfxcontext_locs.add_location_u64( event.seqno, event.id );
-                break;
-            }
+    if ( event.type == TRACE_EVENT_drm_run_job )
+    {
+        const trace_event_t *pe = find_last_flagged_event( m_events, *plocs,
+                TRACE_FLAG_FENCE_SIGNALED | TRACE_FLAG_SW_QUEUE );
+
+        // if we hit an end event, we should have already found a start
+        // event. Ignore this event, it will be dropped
+        if ( pe && !( pe->flags & TRACE_FLAG_FENCE_SIGNALED ) )
+        {
+            const trace_event_t &e = *pe;
+
+            ring = s_name.get_val( e, "<unknown>" );
+            str = string_format( "drm sched %s", ring );
+            m_drm_sched.rings.insert( str );
+            m_amd_timeline_locs.add_location_str( str.c_str(), event.id );
+            event.user_comm = e.comm;
+            event.id_start = e.id;
+            event.flags |= TRACE_FLAG_HW_QUEUE;
+            event.graph_row_id = e.graph_row_id;
+            event.seqno = e.seqno;
+            m_gfxcontext_locs.add_location_u64( event.seqno, event.id );
         }
     }
 
-    if ( !strcmp( event.name, "drm_sched_process_job" ) )
+    if ( event.type == TRACE_EVENT_drm_sched_process_job )
     {
         // fence can be reused across multiple jobs, but never at the same
         // time. Find the previous event with TRACE_FLAG_SW_QUEUE as start event.
-        for ( auto it = plocs->rbegin(); it != plocs->rend(); ++it )
-        {
-            const trace_event_t &e = m_events[ *it ];
-            if ( e.flags & TRACE_FLAG_FENCE_SIGNALED )
-            {
-                // if we hit an end event, we should have already found a start
-                // event. Ignore this event, it will be dropped
-                return;
-            }
+        const trace_event_t *pe = find_last_flagged_event( m_events, *plocs,
+                TRACE_FLAG_FENCE_SIGNALED | TRACE_FLAG_HW_QUEUE );
 
-            if ( e.flags & TRACE_FLAG_HW_QUEUE )
-            {
-                ring = get_event_field_val( e, "name", "<unknown>" );
-                str = string_format( "drm sched %s", ring );
-                m_drm_sched.rings.insert( str );
-                m_amd_timeline_locs.add_location_str( str.c_str(), event.id );
-                event.user_comm = e.comm;
-                event.id_start = e.id;
-                event.flags |= TRACE_FLAG_FENCE_SIGNALED;
-                event.graph_row_id = e.graph_row_id;
-                event.seqno = e.seqno;
-                m_gfxcontext_locs.add_location_u64( event.seqno, event.id );
-                m_drm_sched.outstanding_jobs.erase( fence );
-                break;
-            }
+        // if we hit an end event, we should have already found a start
+        // event. Ignore this event, it will be dropped
+        if ( pe && !( pe->flags & TRACE_FLAG_FENCE_SIGNALED ) )
+        {
+            const trace_event_t &e = *pe;
+
+            ring = s_name.get_val( e, "<unknown>" );
+            str = string_format( "drm sched %s", ring );
+            m_drm_sched.rings.insert( str );
+            m_amd_timeline_locs.add_location_str( str.c_str(), event.id );
+            event.user_comm = e.comm;
+            event.id_start = e.id;
+            event.flags |= TRACE_FLAG_FENCE_SIGNALED;
+            event.graph_row_id = e.graph_row_id;
+            event.seqno = e.seqno;
+            m_gfxcontext_locs.add_location_u64( event.seqno, event.id );
+            m_drm_sched.outstanding_jobs.close_begin( fence );
         }
     }
 }
@@ -2569,8 +3012,10 @@ static int64_t normalize_vblank_diff( int64_t diff )
 
 void TraceEvents::init_new_event_vblank( trace_event_t &event )
 {
+    static event_field_slot_t s_seq( "seq" );
+
     // See if we have a drm_vblank_event_queued with the same seq number
-    uint32_t seqno = strtoul( get_event_field_val( event, "seq" ), NULL, 10 );
+    uint32_t seqno = ( uint32_t )s_seq.get_int( event );
     uint32_t *vblank_queued_id = m_drm_vblank_event_queued.get_val( seqno );
 
     if ( vblank_queued_id )
@@ -2616,32 +3061,25 @@ void TraceEvents::init_new_event( trace_event_t &event )
     {
         init_new_event_vblank( event );
     }
-    else if ( !strcmp( event.name, "drm_vblank_event_queued" ) )
+    else if ( event.type == TRACE_EVENT_drm_vblank_event_queued )
     {
-        uint32_t seqno = strtoul( get_event_field_val( event, "seq" ), NULL, 10 );
+        static event_field_slot_t s_seq( "seq" );
+        uint32_t seqno = ( uint32_t )s_seq.get_int( event );
 
         if ( seqno )
             m_drm_vblank_event_queued.set_val( seqno, event.id );
     }
 
-    // Add this event comm to our comm locations map (ie, 'thread_main-1152')
-    if ( !event.is_i915_perf() )
-        m_comm_locs.add_location_str( event.comm, event.id );
-
-    // Add this event name to event name map
+    // Add vblanks to event name map as "drm_vblank_event1", etc. Other event
+    //  names and comms are added by init_event_locations().
     if ( event.is_vblank() )
     {
-        // Add vblanks as "drm_vblank_event1", etc
         uint64_t hashval = m_strpool.getu64f( "%s%d", event.name, event.crtc );
 
         m_eventnames_locs.add_location_u64( hashval, event.id );
     }
-    else
-    {
-        m_eventnames_locs.add_location_str( event.name, event.id );
-    }
 
-    if ( !strcmp( event.name, "sched_process_exec" ) )
+    if ( event.type == TRACE_EVENT_sched_process_exec )
     {
         // pid, old_pid, filename
         const char *filename = get_event_field_val( event, "filename" );
@@ -2654,7 +3092,7 @@ void TraceEvents::init_new_event( trace_event_t &event )
             m_trace_info.pid_comm_map.get_val( event.pid, filename );
         }
     }
-    else if ( !strcmp( event.name, "sched_process_exit" ) )
+    else if ( event.type == TRACE_EVENT_sched_process_exit )
     {
         const char *pid_comm = get_event_field_val( event, "comm", NULL );
 
@@ -2666,15 +3104,15 @@ void TraceEvents::init_new_event( trace_event_t &event )
     //    <...>-7860  [021]  3726.235512: sched_process_fork:   comm=sudo pid=7860 child_comm=sudo child_pid=7861
     //    <...>-7861  [010]  3726.825033: sched_process_fork:   comm=glxgears pid=7861 child_comm=glxgears child_pid=7862
     //    <...>-7861  [010]  3726.825304: sched_process_fork:   comm=glxgears pid=7861 child_comm=glxgears child_pid=7863
-    else if ( !strcmp( event.name, "sched_process_fork" ) )
+    else if ( event.type == TRACE_EVENT_sched_process_fork )
     {
         init_sched_process_fork( event );
     }
 #endif
 
     if ( event.is_sched_switch() ||
-         !strcmp( event.name, "psci_domain_idle_enter" ) ||
-         !strcmp( event.name, "psci_domain_idle_exit" ))
+         ( event.type == TRACE_EVENT_psci_domain_idle_enter ) ||
+         ( event.type == TRACE_EVENT_psci_domain_idle_exit ) )
     {
         init_sched_switch_event( event );
     }
@@ -2700,7 +3138,7 @@ void TraceEvents::init_new_event( trace_event_t &event )
     {
         init_drm_sched_timeline_event( event );
     }
-    else if ( is_msm_timeline_event( event.name ) )
+    else if ( is_msm_timeline_event( event ) )
     {
         init_msm_timeline_event( event );
     }
@@ -2712,12 +3150,12 @@ void TraceEvents::init_new_event( trace_event_t &event )
     {
         init_i915_perf_event( event );
     }
-    else if ( is_msm_freq_event(event.name) )
+    else if ( is_msm_freq_event( event ) )
     {
         init_msm_freq_event( event );
     }
 
-    if ( !strcmp( event.name, "amdgpu_job_msg" ) )
+    if ( event.type == TRACE_EVENT_amdgpu_job_msg )
     {
         const char *msg = get_event_field_val( event, "msg", NULL );
         uint64_t gfxcontext_hash = get_event_gfxcontext_hash( event );
@@ -2730,6 +3168,122 @@ void TraceEvents::init_new_event( trace_event_t &event )
     SDL_AtomicAdd( &m_eventsloaded, 1 );
 }
 
+// Add events [start, end) to comm and event name locations and m_events_ts.
+//  Called on worker threads, so this can only read events.
+void TraceEvents::init_event_locations( size_t start, size_t end,
+                                        TraceLocations &comm_locs, TraceLocations &eventnames_locs )
+{
+    for ( size_t i = start; i < end; i++ )
+    {
+        const trace_event_t &event = m_events[ i ];
+
+        // Add this event comm to our comm locations map (ie, 'thread_main-1152')
+        if ( !event.is_i915_perf() )
+            comm_locs.add_location_str( event.comm, event.id );
+
+        // Add this event name to event name map
+        if ( !event.is_vblank() )
+            eventnames_locs.add_location_str( event.name, event.id );
+
+        m_events_ts[ i ] = event.ts;
+    }
+}
+
+// Copy event flags, pid, and duration into their packed columns.
+void TraceEvents::init_event_columns()
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    size_t chunks = std::max< size_t >( 1, std::thread::hardware_concurrency() );
+    size_t chunk_size = ( m_events.size() + chunks - 1 ) / chunks;
+
+    m_events_flags.resize( m_events.size() );
+    m_events_pid.resize( m_events.size() );
+    m_events_duration.resize( m_events.size() );
+
+    parallel_for( chunks, [ & ]( size_t i )
+    {
+        size_t start = std::min( m_events.size(), i * chunk_size );
+        size_t end = std::min( m_events.size(), start + chunk_size );
+
+        for ( size_t idx = start; idx < end; idx++ )
+        {
+            const trace_event_t &event = m_events[ idx ];
+
+            m_events_flags[ idx ] = event.flags;
+            m_events_pid[ idx ] = event.pid;
+            m_events_duration[ idx ] = event.duration;
+        }
+    } );
+}
+
+// Merge sorted event id arrays from src into dst. For equal ids, src comes first.
+static void merge_trace_locations( TraceLocations &dst, TraceLocations &src )
+{
+    for ( auto &it : src.m_locs.m_map )
+    {
+        IdList &locs = *dst.m_locs.get_val_create( it.first );
+
+        if ( locs.empty() )
+        {
+            locs.swap( it.second );
+        }
+        else
+        {
+            IdList merged;
+
+            std::merge( it.second.begin(), it.second.end(), locs.begin(), locs.end(),
+                        std::back_inserter( merged ) );
+            locs.swap( merged );
+        }
+    }
+}
+
+void TraceEvents::init_ts_buckets()
+{
+    size_t count = m_events_ts.size() / 4 + 1;
+
+    m_ts_buckets.clear();
+    if ( m_events_ts.empty() )
+        return;
+
+    m_ts_bucket_start = m_events_ts.front();
+    m_ts_bucket_width = ( m_events_ts.back() - m_ts_bucket_start ) / count + 1;
+
+    // count buckets plus an end entry
+    m_ts_buckets.resize( count + 1 );
+
+    uint32_t id = 0;
+    for ( size_t i = 0; i <= count; i++ )
+    {
+        int64_t ts = m_ts_bucket_start + ( int64_t )i * m_ts_bucket_width;
+
+        while ( ( id < m_events_ts.size() ) && ( m_events_ts[ id ] < ts ) )
+            id++;
+
+        m_ts_buckets[ i ] = id;
+    }
+}
+
+uint32_t TraceEvents::ts_to_eventid( int64_t ts ) const
+{
+    if ( m_ts_buckets.empty() )
+        return INVALID_ID;
+
+    int64_t bucket = std::max< int64_t >( 0, ts - m_ts_bucket_start ) / m_ts_bucket_width;
+
+    // Past the last bucket: return the last event
+    if ( bucket >= ( int64_t )m_ts_buckets.size() - 1 )
+        return m_events_ts.size() - 1;
+
+    // Bucket start events are at or before ts, next bucket start is after
+    auto first = m_events_ts.begin() + m_ts_buckets[ bucket ];
+    auto last = m_events_ts.begin() + m_ts_buckets[ bucket + 1 ];
+    uint32_t id = std::lower_bound( first, last, ts ) - m_events_ts.begin();
+
+    return std::min< uint32_t >( id, m_events_ts.size() - 1 );
+}
+
 TraceEvents::tracestatus_t TraceEvents::get_load_status( uint32_t *count )
 {
     int eventsloaded = SDL_AtomicGet( &m_eventsloaded );
@@ -2790,6 +3344,9 @@ void TraceEvents::init()
     // Set m_eventsloaded initializing bit
     SDL_AtomicSet( &m_eventsloaded, 0x40000000 );
 
+    // Event ids change, so row caches keyed on locs pointers are stale
+    m_init_gen++;
+
     m_vblank_info.resize( m_crtc_max + 1 );
 
     s_opts().set_crtc_max( m_crtc_max );
@@ -2802,18 +3359,94 @@ void TraceEvents::init()
             init_new_event( event );
     }
 
+    {
+        // Comm and event name locations are built per chunk of events on
+        //  worker threads, then merged in event id order.
+        GPUVIS_TRACE_BLOCK( "init_event_locations" );
+
+        size_t chunks = std::max< size_t >( 1, std::thread::hardware_concurrency() );
+        size_t chunk_size = ( m_events.size() + chunks - 1 ) / chunks;
+        std::vector< TraceLocations > comm_locs( chunks );
+        std::vector< TraceLocations > eventnames_locs( chunks );
+
+        m_events_ts.resize( m_events.size() );
+
+        parallel_for( chunks, [ & ]( size_t i )
+        {
+            size_t start = std::min( m_events.size(), i * chunk_size );
+            size_t end = std::min( m_events.size(), start + chunk_size );
+
+            init_event_locations( start, end, comm_locs[ i ], eventnames_locs[ i ] );
+        } );
+
+        init_ts_buckets();
+
+        // Chunks are in ascending event id order, so we can just append them.
+        for ( size_t i = 1; i < chunks; i++ )
+        {
+            for ( auto &it : comm_locs[ i ].m_locs.m_map )
+            {
+                IdList &locs = *comm_locs[ 0 ].m_locs.get_val_create( it.first );
+
+                for ( uint32_t id : it.second )
+                    locs.push_back( id );
+            }
+            for ( auto &it : eventnames_locs[ i ].m_locs.m_map )
+            {
+                IdList &locs = *eventnames_locs[ 0 ].m_locs.get_val_create( it.first );
+
+                for ( uint32_t id : it.second )
+                    locs.push_back( id );
+            }
+        }
+
+        // init_new_event() added sched_switch comms and vblank names
+        merge_trace_locations( m_comm_locs, comm_locs[ 0 ] );
+        merge_trace_locations( m_eventnames_locs, eventnames_locs[ 0 ] );
+    }
+
     // Figure out median vblank intervals
     calculate_vblank_info();
 
-    // Init amd event durations
-    calculate_amd_event_durations();
+    {
+        // The amd, intel, and print passes each touch their own events and
+        //  location maps, so run them concurrently.
+        GPUVIS_TRACE_BLOCK( "calculate_event_durations" );
+
+        std::function< void() > passes[] =
+        {
+            // Init amd event durations
+            [ this ]() { calculate_amd_event_durations(); },
+
+            // Init intel event durations
+            [ this ]()
+            {
+                calculate_i915_req_event_durations();
+                calculate_i915_reqwait_event_durations();
+            },
+
+            // Init print column information
+            [ this ]() { calculate_event_print_info(); },
+        };
+
+        parallel_for( ARRAY_SIZE( passes ), [ & ]( size_t i ) { passes[ i ](); } );
+    }
 
-    // Init intel event durations
-    calculate_i915_req_event_durations();
-    calculate_i915_reqwait_event_durations();
+    // Event flags and durations are final now
+    init_event_columns();
 
-    // Init print column information
-    calculate_event_print_info();
+    // Location lists are done growing, so drop their spare capacity
+    for ( TraceLocations *locs : { &m_tdopexpr_locs, &m_comm_locs, &m_eventnames_locs,
+                                   &m_gfxcontext_locs, &m_gfxcontext_msg_locs, &m_linux_perf_locs,
+                                   &m_amd_timeline_locs, &m_msm_freq_locs,
+                                   &m_sched_switch_prev_locs, &m_sched_switch_next_locs,
+                                   &m_sched_switch_cpu_locs,
+                                   &m_i915.reqwait_end_locs, &m_i915.req_locs } )
+    {
+        locs->shrink_to_fit();
+    }
+    m_i915.perf_locs.shrink_to_fit();
+    m_ftrace.print_locs.shrink_to_fit();
 
     // Remove tgid groups with single threads
     remove_single_tgids();
@@ -2859,7 +3492,7 @@ void TraceEvents::remove_single_tgids()
 
 void TraceEvents::set_event_color( const std::string &eventname, ImU32 color )
 {
-    const std::vector< uint32_t > *plocs =
+    const IdList *plocs =
             m_eventnames_locs.get_locations_str( eventname.c_str() );
 
     if ( plocs )
@@ -2874,6 +3507,8 @@ void TraceEvents::set_event_color( const std::string &eventname, ImU32 color )
             if ( !( event.flags & TRACE_FLAG_AUTOGEN_COLOR ) )
                 event.color = color;
         }
+
+        m_event_colors_gen++;
     }
 }
 
@@ -2936,15 +3571,17 @@ void TraceEvents::calculate_amd_event_durations()
     {
         uint32_t graph_row_id = 0;
         int64_t last_fence_signaled_ts = 0;
-        std::vector< uint32_t > &locs = timeline_locs.second;
+        IdList &locs = timeline_locs.second;
+        IdList timeline;
         // const char *name = m_strpool.findstr( timeline_locs.first );
 
         // Erase all timeline events with single entries or no fence_signaled
-        locs.erase( std::remove_if( locs.begin(), locs.end(),
-                                    [&events]( const uint32_t index )
-                                        { return !events[ index ].is_timeline(); }
-                                  ),
-                    locs.end() );
+        for ( uint32_t index : locs )
+        {
+            if ( events[ index ].is_timeline() )
+                timeline.push_back( index );
+        }
+        locs.swap( timeline );
 
         if ( locs.empty() )
             erase_list.push_back( timeline_locs.first );
@@ -3050,25 +3687,18 @@ void TraceEvents::calculate_amd_event_durations()
 
 i915_type_t get_i915_reqtype( const trace_event_t &event )
 {
-    if ( !strcmp( event.name, "intel_engine_notify" ) )
-        return i915_req_Notify;
-
-    if ( !strncmp( event.name, "i915_", 5 ) )
-    {
-        if ( strstr( event.name, "_request_queue" ) )
-            return i915_req_Queue;
-        else if ( strstr( event.name, "_request_add" ) )
-            return i915_req_Add;
-        else if ( strstr( event.name, "_request_submit" ) )
-            return i915_req_Submit;
-        else if ( strstr( event.name, "_request_in" ) )
-            return i915_req_In;
-        else if ( strstr( event.name, "_request_out" ) )
-            return i915_req_Out;
-        else if ( strstr( event.name, "_request_wait_begin" ) )
-            return i915_reqwait_begin;
-        else if ( strstr( event.name, "_request_wait_end" ) )
-            return i915_reqwait_end;
+    switch ( event.type )
+    {
+    case TRACE_EVENT_intel_engine_notify:     return i915_req_Notify;
+    case TRACE_EVENT_i915_request_queue:      return i915_req_Queue;
+    case TRACE_EVENT_i915_request_add:        return i915_req_Add;
+    case TRACE_EVENT_i915_request_submit:     return i915_req_Submit;
+    case TRACE_EVENT_i915_request_in:         return i915_req_In;
+    case TRACE_EVENT_i915_request_out:        return i915_req_Out;
+    case TRACE_EVENT_i915_request_wait_begin: return i915_reqwait_begin;
+    case TRACE_EVENT_i915_request_wait_end:   return i915_reqwait_end;
+    default:
+        break;
     }
 
     if ( event.is_i915_perf() )
@@ -3095,18 +3725,23 @@ void TraceEvents::calculate_i915_reqwait_event_durations()
     for ( auto &req_locs : m_i915.reqwait_end_locs.m_locs.m_map )
     {
         row_pos_t row_pos;
-        std::vector< uint32_t > &locs = req_locs.second;
+        const IdList &locs = req_locs.second;
         // const char *name = m_strpool.findstr( req_locs.first );
 
         for ( uint32_t idx : locs )
+        {
+            const trace_event_t &event = m_events[ idx ];
+
+            row_pos.add( idx, m_events[ event.id_start ].ts, event.ts );
+        }
+
+        row_pos.calc_rows( [&]( uint32_t idx, uint32_t row )
         {
             trace_event_t &event = m_events[ idx ];
-            trace_event_t &event_begin = m_events[ event.id_start ];
-            uint32_t row = row_pos.get_row( event_begin.ts, event.ts );
 
-            event_begin.graph_row_id = row;
+            m_events[ event.id_start ].graph_row_id = row;
             event.graph_row_id = row;
-        }
+        } );
 
         m_row_count.m_map[ req_locs.first ] = row_pos.m_rows;
     }
@@ -3143,15 +3778,17 @@ void TraceEvents::calculate_i915_req_event_durations()
         if ( !events[ i915_req_Notify ] && events[ i915_req_In ] )
         {
             // Try to find the global seqno from our request_in event
-            const char *globalstr = get_event_field_val( *events[ i915_req_In ], "global_seqno", NULL );
+            static event_field_slot_t s_global_seqno( "global_seqno" );
+            static event_field_slot_t s_global( "global" );
+            const trace_event_t &event_in = *events[ i915_req_In ];
+            const event_field_slot_t &global_slot =
+                    ( s_global_seqno.find( event_in ) >= 0 ) ? s_global_seqno : s_global;
 
-            if ( !globalstr )
-                globalstr = get_event_field_val( *events[ i915_req_In ], "global", NULL );
-            if ( globalstr )
+            if ( global_slot.find( event_in ) >= 0 )
             {
-                uint32_t global_seqno = strtoul( globalstr, NULL, 10 );
+                uint32_t global_seqno = ( uint32_t )global_slot.get_int( event_in );
                 const std::vector< uint32_t > *plocs =
-                        m_i915.gem_req_locs.get_locations( ringno, global_seqno, "0" );
+                        m_i915.gem_req_locs.get_locations( ringno, global_seqno, 0 );
 
                 // We found event(s) that match our ring and global seqno.
                 if ( plocs )
@@ -3161,7 +3798,7 @@ void TraceEvents::calculate_i915_req_event_durations()
                     {
                         trace_event_t &event_notify = m_events[ i ];
 
-                        if ( !strcmp( event_notify.name, "intel_engine_notify" ) )
+                        if ( event_notify.type == TRACE_EVENT_intel_engine_notify )
                         {
                             // Set id_start to point to the request_in event
                             event_notify.id_start = events[ i915_req_In ]->id;
@@ -3227,10 +3864,12 @@ void TraceEvents::calculate_i915_req_event_durations()
     for ( auto &req_locs : m_i915.req_locs.m_locs.m_map )
     {
         row_pos_t row_pos;
-        std::vector< uint32_t > &locs = req_locs.second;
+        IdList &locs = req_locs.second;
         // const char *name = m_strpool.findstr( req_locs.first );
+        std::vector< uint32_t > sorted( locs.begin(), locs.end() );
 
-        std::sort( locs.begin(), locs.end() );
+        std::sort( sorted.begin(), sorted.end() );
+        locs.assign( sorted );
 
         for ( uint32_t idx : locs )
         {
@@ -3239,7 +3878,7 @@ void TraceEvents::calculate_i915_req_event_durations()
 
             trace_event_t &event = m_events[ idx ];
             const std::vector< uint32_t > *plocs;
-            const trace_event_t *pevent = !strcmp( event.name, "intel_engine_notify" ) ?
+            const trace_event_t *pevent = ( event.type == TRACE_EVENT_intel_engine_notify ) ?
                         &m_events[ event.id_start ] : &event;
 
             plocs = m_i915.gem_req_locs.get_locations( *pevent );
@@ -3247,25 +3886,37 @@ void TraceEvents::calculate_i915_req_event_durations()
             {
                 int64_t min_ts = m_events[ plocs->front() ].ts;
                 int64_t max_ts = m_events[ plocs->back() ].ts;
-                uint32_t row = row_pos.get_row( min_ts, max_ts );
 
+                row_pos.add( pevent->id, min_ts, max_ts );
+
+                // Mark the rest of this ring/ctx/seqno as added
                 for ( uint32_t i : *plocs )
-                    m_events[ i ].graph_row_id = row;
+                    m_events[ i ].graph_row_id = 0;
             }
         }
 
+        row_pos.calc_rows( [&]( uint32_t id, uint32_t row )
+        {
+            const std::vector< uint32_t > *plocs = m_i915.gem_req_locs.get_locations( m_events[ id ] );
+
+            for ( uint32_t i : *plocs )
+                m_events[ i ].graph_row_id = row;
+        } );
+
         m_row_count.m_map[ req_locs.first ] = row_pos.m_rows;
     }
 }
 
-const std::vector< uint32_t > *TraceEvents::get_locs( const char *name,
-        loc_type_t *ptype, std::string *errstr )
+const IdList *TraceEvents::get_locs( const char *name,
+        loc_type_t *ptype, std::string *errstr, float *progress )
 {
     loc_type_t type = LOC_TYPE_Max;
-    const std::vector< uint32_t > *plocs = NULL;
+    const IdList *plocs = NULL;
 
     if ( errstr )
         errstr->clear();
+    if ( progress )
+        *progress = 1.0f;
 
     if ( !strcmp( name, "cpu graph" ) )
     {
@@ -3319,7 +3970,7 @@ const std::vector< uint32_t > *TraceEvents::get_locs( const char *name,
         if ( plot )
         {
             type = LOC_TYPE_Plot;
-            plocs = get_tdopexpr_locs( plot->m_filter_str.c_str() );
+            plocs = get_tdopexpr_locs( plot->m_filter_str.c_str(), NULL, progress );
         }
     }
     else if ( !strncmp( name, "msm ring", 8 ) )
@@ -3371,7 +4022,7 @@ const std::vector< uint32_t > *TraceEvents::get_locs( const char *name,
             {
                 // TDOP Expressions. Ie, $name = print, etc.
                 type = LOC_TYPE_Tdopexpr;
-                plocs = get_tdopexpr_locs( name );
+                plocs = get_tdopexpr_locs( name, NULL, progress );
 
                 if ( !plocs )
                 {
@@ -3502,6 +4153,8 @@ TraceWin::TraceWin( const char *filename, size_t filesize )
 
 TraceWin::~TraceWin()
 {
+    filter_job_cancel();
+
     s_ini().PutStr( "event_filter_buf", m_filter.buf );
 
     m_graph.rows.shutdown();
@@ -3513,6 +4166,123 @@ TraceWin::~TraceWin()
     s_opts().set_crtc_max( -1 );
 }
 
+void TraceWin::load_preview_render( uint32_t count, bool loading )
+{
+    load_preview_t &preview = m_trace_events.m_load_preview;
+
+    ImGui::Text( "%s events %u...", loading ? "Loading" : "Initializing", count );
+
+    if ( ImGui::Button( "Cancel" ) ||
+         ( ImGui::IsWindowFocused() && s_actions().get( action_escape ) ) )
+    {
+        s_app().cancel_load_file();
+    }
+
+    if ( !loading )
+        return;
+
+    // Rows are only filled in while reading trace.dat files
+    std::lock_guard< std::mutex > lock( preview.m_mutex );
+    int64_t loaded_ts = -1;
+
+    for ( uint32_t i = 0; i < preview.m_numrows; i++ )
+        loaded_ts = std::max< int64_t >( loaded_ts, preview.m_rows[ i ].last_ts );
+    if ( loaded_ts <= 0 )
+        return;
+
+    // Stop reading where all cpus are now and show what has been loaded.
+    //  Events are read in ts order, so that is the start of the trace.
+    ImGui::SameLine();
+    if ( preview.is_stopped() )
+    {
+        std::string str = ts_to_timestr( preview.m_stop_ts, 2 );
+
+        ImGui::Text( "Stopping at %s...", str.c_str() );
+    }
+    else if ( ImGui::Button( "Show loaded events" ) )
+    {
+        preview.stop();
+    }
+
+    ImGui::SameLine();
+    ImGui::Text( "Loaded %s", ts_to_timestr( loaded_ts, 2 ).c_str() );
+
+    // Event counts for each cpu across the loaded time range
+    ImVec2 pos = ImGui::GetCursorScreenPos();
+    float row_h = ImGui::GetTextLineHeightWithSpacing();
+    float label_w = ImGui::CalcTextSize( "cpu 000 " ).x;
+
+    for ( uint32_t i = 0; i < preview.m_numrows; i++ )
+    {
+        float w = ImGui::CalcTextSize( ( preview.m_rows[ i ].label + " " ).c_str() ).x;
+
+        label_w = std::max< float >( label_w, w );
+    }
+
+    uint32_t width = ( uint32_t )std::max< float >( 0.0f, ImGui::GetContentRegionAvail().x - label_w );
+    std::vector< uint32_t > counts( ( size_t )width * preview.m_numrows );
+    uint32_t maxcount = 1;
+
+    if ( !width )
+        return;
+
+    for ( uint32_t i = 0; i < preview.m_numrows; i++ )
+    {
+        const load_preview_t::row_t &row = preview.m_rows[ i ];
+        int64_t bucket_ts = row.bucket_ts;
+        int64_t last_ts = row.last_ts;
+
+        for ( int64_t b = 0; ( b < load_preview_t::NUM_BUCKETS ) && ( b * bucket_ts <= last_ts ); b++ )
+        {
+            int64_t mid_ts = b * bucket_ts + bucket_ts / 2;
+            uint32_t x = ( uint32_t )std::min< int64_t >( width - 1, mid_ts * width / loaded_ts );
+            uint32_t &bucket_count = counts[ i * width + x ];
+
+            bucket_count += row.counts[ b ].load( std::memory_order_relaxed );
+            maxcount = std::max< uint32_t >( maxcount, bucket_count );
+        }
+    }
+
+    ImDrawList *DrawList = ImGui::GetWindowDrawList();
+    ImVec2 mouse_pos = ImGui::GetMousePos();
+    float x0 = pos.x + label_w;
+
+    for ( uint32_t i = 0; i < preview.m_numrows; i++ )
+    {
+        float y = pos.y + i * row_h;
+        const std::string &label = preview.m_rows[ i ].label;
+
+        DrawList->AddText( ImVec2( pos.x, y ), s_clrs().get( col_Graph_RowLabelText ), label.c_str() );
+        DrawList->AddRectFilled( ImVec2( x0, y ), ImVec2( x0 + width, y + row_h - 1 ),
+                                 s_clrs().get( col_Graph_RowBk ) );
+
+        for ( uint32_t x = 0; x < width; x++ )
+        {
+            uint32_t bucket_count = counts[ i * width + x ];
+
+            if ( bucket_count )
+            {
+                ImU32 alpha = 0x40 + 0xbf * bucket_count / maxcount;
+
+                DrawList->AddRectFilled( ImVec2( x0 + x, y ), ImVec2( x0 + x + 1, y + row_h - 1 ),
+                                         s_clrs().get( col_Graph_1Event, alpha ) );
+            }
+        }
+
+        if ( ( mouse_pos.x >= x0 ) && ( mouse_pos.x < x0 + width ) &&
+             ( mouse_pos.y >= y ) && ( mouse_pos.y < y + row_h ) &&
+             ImGui::IsWindowHovered() )
+        {
+            uint32_t x = ( uint32_t )( mouse_pos.x - x0 );
+            std::string ts_str = ts_to_timestr( ( int64_t )x * loaded_ts / width, 2 );
+
+            ImGui::SetTooltip( "%s: %u events near %s", label.c_str(), counts[ i * width + x ], ts_str.c_str() );
+        }
+    }
+
+    ImGui::Dummy( ImVec2( label_w + width, preview.m_numrows * row_h ) );
+}
+
 void TraceWin::render()
 {
     GPUVIS_TRACE_BLOCK( __func__ );
@@ -3554,6 +4324,9 @@ void TraceWin::render()
                     m_i915_perf.counters.init( m_trace_events );
             }
 
+            // Apply event filter results if background job finished
+            filter_job_update();
+
             if ( !s_opts().getb( OPT_ShowEventList ) ||
                  imgui_collapsingheader( "Event Graph", &m_graph.has_focus, ImGuiTreeNodeFlags_DefaultOpen ) )
             {
@@ -3591,15 +4364,7 @@ void TraceWin::render()
     else if ( status == TraceEvents::Trace_Loading ||
               status == TraceEvents::Trace_Initializing )
     {
-        bool loading = ( status == TraceEvents::Trace_Loading );
-
-        ImGui::Text( "%s events %u...", loading ? "Loading" : "Initializing", count );
-
-        if ( ImGui::Button( "Cancel" ) ||
-             ( ImGui::IsWindowFocused() && s_actions().get( action_escape ) ) )
-        {
-            s_app().cancel_load_file();
-        }
+        load_preview_render( count, status == TraceEvents::Trace_Loading );
     }
     else
     {
@@ -3734,10 +4499,10 @@ void TraceWin::trace_render_info()
             ImGui::SetColumnWidth( 1, imgui_scale( 75.0f ) );
         }
 
-        for ( auto item : m_trace_events.m_eventnames_locs.m_locs.m_map )
+        for ( const auto &item : m_trace_events.m_eventnames_locs.m_locs.m_map )
         {
             const char *eventname = m_trace_events.m_strpool.findstr( item.first );
-            const std::vector< uint32_t > &locs = item.second;
+            const IdList &locs = item.second;
 
             ImGui::Text( "%s", eventname );
             ImGui::NextColumn();
@@ -4003,7 +4768,7 @@ static std::string get_event_fields_str( const trace_event_t &event, const char
     {
         std::string buf;
         const char *key = event.fields[ i ].key;
-        const char *value = event.fields[ i ].value;
+        const char *value = event.get_field_val( i );
 
         if ( event.is_ftrace_print() && !strcmp( key, "buf" ) )
         {
@@ -4152,6 +4917,139 @@ static bool imgui_input_uint32( uint32_t *pval, float w, const char *label, cons
     return ret;
 }
 
+// Background evaluation of the event list filter
+struct filter_job_t
+{
+    TraceEvents *trace_events = nullptr;
+    class TdopExpr *tdop_expr = nullptr;
+    SDL_Thread *thread = nullptr;
+    util_time_t t0;
+
+    // Count of events evaluated so far
+    SDL_atomic_t eventsdone = { 0 };
+    SDL_atomic_t cancel = { 0 };
+    SDL_atomic_t finished = { 0 };
+
+    // Ascending ids of matching events for each chunk of m_events
+    std::vector< std::vector< uint32_t > > chunks;
+    // pid -> count of matching events for that pid
+    util_umap< int, uint32_t > pid_eventcount;
+};
+
+static int SDLCALL filter_thread_func( void *data )
+{
+    filter_job_t *job = ( filter_job_t * )data;
+    TraceEvents *trace_events = job->trace_events;
+
+    if ( trace_events->tdopexpr_eval_chunks( job->tdop_expr, job->chunks, &job->eventsdone, &job->cancel ) )
+    {
+        const std::vector< int > &events_pid = trace_events->m_events_pid;
+
+        for ( const std::vector< uint32_t > &chunk : job->chunks )
+        {
+            for ( uint32_t id : chunk )
+            {
+                // Bump up count of !filtered events for this pid
+                uint32_t *count = job->pid_eventcount.get_val( events_pid[ id ], 0 );
+                (*count)++;
+            }
+        }
+    }
+
+    SDL_AtomicSet( &job->finished, 1 );
+    return 0;
+}
+
+void TraceWin::filter_job_start( class TdopExpr *tdop_expr )
+{
+    filter_job_cancel();
+
+    filter_job_t *job = new filter_job_t;
+
+    job->trace_events = &m_trace_events;
+    job->tdop_expr = tdop_expr;
+    job->t0 = util_get_time();
+    job->thread = SDL_CreateThread( filter_thread_func, "eventfilter", job );
+    if ( !job->thread )
+    {
+        logf( "[Error] %s: SDL_CreateThread failed.", __func__ );
+
+        // Evaluate it here then
+        filter_thread_func( job );
+    }
+
+    m_filter.job = job;
+}
+
+void TraceWin::filter_job_cancel()
+{
+    filter_job_t *job = m_filter.job;
+
+    if ( job )
+    {
+        SDL_AtomicSet( &job->cancel, 1 );
+
+        if ( job->thread )
+            SDL_WaitThread( job->thread, NULL );
+
+        tdopexpr_delete( job->tdop_expr );
+        delete job;
+
+        m_filter.job = NULL;
+    }
+}
+
+void TraceWin::filter_job_update()
+{
+    filter_job_t *job = m_filter.job;
+
+    if ( !job || !SDL_AtomicGet( &job->finished ) )
+        return;
+
+    if ( job->thread )
+        SDL_WaitThread( job->thread, NULL );
+    job->thread = NULL;
+
+    // is_filtered_out is read by the graph, so only set it here on the main thread
+    std::vector< trace_event_t > &events = m_trace_events.m_events;
+    size_t nchunks = job->chunks.size();
+    size_t chunk_size = ( events.size() + nchunks - 1 ) / nchunks;
+    size_t total = 0;
+
+    parallel_for( nchunks, [ & ]( size_t i )
+    {
+        size_t start = std::min( events.size(), i * chunk_size );
+        size_t end = std::min( events.size(), start + chunk_size );
+
+        for ( size_t idx = start; idx < end; idx++ )
+            events[ idx ].is_filtered_out = true;
+        for ( uint32_t id : job->chunks[ i ] )
+            events[ id ].is_filtered_out = false;
+    } );
+
+    // Chunks are in ascending event id order, so we can just append them.
+    for ( const std::vector< uint32_t > &chunk : job->chunks )
+        total += chunk.size();
+
+    m_filter.events.reserve( total );
+    for ( const std::vector< uint32_t > &chunk : job->chunks )
+        m_filter.events.insert( m_filter.events.end(), chunk.begin(), chunk.end() );
+
+    m_filter.pid_eventcount.m_map.swap( job->pid_eventcount.m_map );
+
+    if ( m_filter.events.empty() )
+        m_filter.errstr = "WARNING: No events found.";
+
+    float time = util_time_to_ms( job->t0, util_get_time() );
+    if ( time > 1000.0f )
+        logf( "tdopexpr_compile(\"%s\"): %.2fms\n", m_filter.buf, time );
+
+    tdopexpr_delete( job->tdop_expr );
+    delete job;
+
+    m_filter.job = NULL;
+}
+
 void TraceWin::eventlist_render_options()
 {
     // Goto event
@@ -4191,43 +5089,16 @@ void TraceWin::eventlist_render_options()
         m_filter.errstr.clear();
         m_filter.enabled = false;
 
+        filter_job_cancel();
+
         if ( m_filter.buf[ 0 ] )
         {
             tdop_get_key_func get_key_func = std::bind( filter_get_key_func, &m_trace_events.m_strpool, _1, _2 );
             class TdopExpr *tdop_expr = tdopexpr_compile( m_filter.buf, get_key_func, m_filter.errstr );
 
-            util_time_t t0 = util_get_time();
-
+            // Results are picked up by filter_job_update() when the job finishes
             if ( tdop_expr )
-            {
-                for ( trace_event_t &event : m_trace_events.m_events )
-                {
-                    tdop_get_keyval_func get_keyval_func = std::bind( filter_get_keyval_func,
-                                                                      &m_trace_events.m_trace_info, &event, _1, _2 );
-
-                    const char *ret = tdopexpr_exec( tdop_expr, get_keyval_func );
-
-                    event.is_filtered_out = !ret[ 0 ];
-                    if ( !event.is_filtered_out )
-                    {
-                        m_filter.events.push_back( event.id );
-
-                        // Bump up count of !filtered events for this pid
-                        uint32_t *count = m_filter.pid_eventcount.get_val( event.pid, 0 );
-                        (*count)++;
-                    }
-                }
-
-                if ( m_filter.events.empty() )
-                    m_filter.errstr = "WARNING: No events found.";
-
-                tdopexpr_delete( tdop_expr );
-                tdop_expr = NULL;
-            }
-
-            float time = util_time_to_ms( t0, util_get_time() );
-            if ( time > 1000.0f )
-                logf( "tdopexpr_compile(\"%s\"): %.2fms\n", m_filter.buf, time );
+                filter_job_start( tdop_expr );
         }
     }
 
@@ -4259,13 +5130,27 @@ void TraceWin::eventlist_render_options()
     ImGui::SameLine();
     if ( ImGui::Button( "Clear Filter" ) )
     {
+        filter_job_cancel();
+
         m_filter.events.clear();
         m_filter.pid_eventcount.m_map.clear();
         m_filter.errstr.clear();
         m_filter.buf[ 0 ] = 0;
     }
 
-    if ( !m_filter.errstr.empty() )
+    if ( m_filter.job )
+    {
+        size_t count = std::max< size_t >( 1, m_trace_events.m_events.size() );
+        int eventsdone = SDL_AtomicGet( &m_filter.job->eventsdone );
+
+        ImGui::SameLine();
+        ImGui::Text( "Filtering events %.0f%%...", 100.0 * eventsdone / count );
+
+        ImGui::SameLine();
+        if ( ImGui::Button( "Cancel" ) )
+            filter_job_cancel();
+    }
+    else if ( !m_filter.errstr.empty() )
     {
         ImGui::SameLine();
         ImGui::TextColored( ImVec4( 1, 0, 0, 1 ), "%s", m_filter.errstr.c_str() );
@@ -4863,7 +5748,7 @@ static void render_color_items( colors_t i0, colors_t i1,
 static trace_event_t *get_first_colorable_event(
         TraceEvents &trace_events, const char *eventname )
 {
-    const std::vector< uint32_t > *plocs =
+    const IdList *plocs =
             trace_events.m_eventnames_locs.get_locations_str( eventname );
 
     if ( plocs )
@@ -5027,6 +5912,8 @@ static void reset_event_colors_to_default( TraceWin *win )
             if ( !( event.flags & TRACE_FLAG_AUTOGEN_COLOR ) )
                 event.color = 0;
         }
+
+        win->m_trace_events.m_event_colors_gen++;
     }
 }
 
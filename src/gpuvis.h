@@ -79,12 +79,12 @@ public:
 
     void add_location_u64( uint64_t hashval, uint32_t loc )
     {
-        std::vector< uint32_t > *plocs = m_locs.get_val_create( hashval );
+        IdList *plocs = m_locs.get_val_create( hashval );
 
         plocs->push_back( loc );
     }
 
-    std::vector< uint32_t > *get_locations_u64( uint64_t hashval )
+    IdList *get_locations_u64( uint64_t hashval )
     {
         return m_locs.get_val( hashval );
     }
@@ -94,14 +94,20 @@ public:
         add_location_u64( hashstr64( name ), loc );
     }
 
-    std::vector< uint32_t > *get_locations_str( const char *name )
+    IdList *get_locations_str( const char *name )
     {
         return get_locations_u64( hashstr64( name ) );
     }
 
+    void shrink_to_fit()
+    {
+        for ( auto &it : m_locs.m_map )
+            it.second.shrink_to_fit();
+    }
+
 public:
-    // Map of name hashval to array of event locations.
-    util_umap< uint64_t, std::vector< uint32_t > > m_locs;
+    // Map of name hashval to ascending event locations.
+    util_umap< uint64_t, IdList > m_locs;
 };
 
 class TraceLocationsRingCtxSeq
@@ -112,10 +118,10 @@ public:
 
     bool add_location( const trace_event_t &event );
     std::vector< uint32_t > *get_locations( const trace_event_t &event );
-    std::vector< uint32_t > *get_locations( uint32_t ringno, uint32_t seqno, const char *ctxstr );
+    std::vector< uint32_t > *get_locations( uint32_t ringno, uint32_t seqno, uint64_t ctx );
 
     static uint64_t db_key( const trace_event_t &event );
-    static uint64_t db_key( uint32_t ringno, uint32_t seqno, const char *ctxstr );
+    static uint64_t db_key( uint32_t ringno, uint32_t seqno, uint64_t ctx );
 
     static uint32_t get_i915_ringno( const trace_event_t &event, bool *is_class_instance = nullptr );
     static uint32_t get_i915_hw_id( const trace_event_t &event);
@@ -126,8 +132,50 @@ public:
     util_umap< uint64_t, std::vector< uint32_t > > m_locs;
 };
 
-// Given a sorted array (like from TraceLocations), binary search for eventid
-//   and return the vector index, or vec.size() if not found.
+// Begin events waiting for their end event, keyed on cpu, pid, fence, etc.
+//  Lets init pair begin / end events in a single pass over m_events.
+class TracePairedEvents
+{
+public:
+    TracePairedEvents() {}
+    ~TracePairedEvents() {}
+
+    // Set eventid as the open begin event for key
+    void set_begin( uint64_t key, uint32_t eventid )
+    {
+        m_open.m_map[ key ] = eventid;
+    }
+
+    // Return open begin event for key, or INVALID_ID
+    uint32_t get_begin( uint64_t key )
+    {
+        uint32_t *eventid = m_open.get_val( key );
+
+        return eventid ? *eventid : INVALID_ID;
+    }
+
+    // Return and close open begin event for key, or INVALID_ID
+    uint32_t pop_begin( uint64_t key )
+    {
+        uint32_t eventid = get_begin( key );
+
+        if ( is_valid_id( eventid ) )
+            m_open.erase_key( key );
+        return eventid;
+    }
+
+    void close_begin( uint64_t key )
+    {
+        m_open.erase_key( key );
+    }
+
+public:
+    // Map of key to open begin event id
+    util_umap< uint64_t, uint32_t > m_open;
+};
+
+// Given a sorted array, binary search for eventid and return the index
+//   of the first id not less than it, or vec.size() if not found.
 inline size_t vec_find_eventid( const std::vector< uint32_t > &vec, uint32_t eventid )
 {
     auto i = std::lower_bound( vec.begin(), vec.end(), eventid );
@@ -135,6 +183,13 @@ inline size_t vec_find_eventid( const std::vector< uint32_t > &vec, uint32_t eve
     return i - vec.begin();
 }
 
+// Same for TraceLocations lists. Prefer locs.lower_bound() and walking the
+//   iterator over indexing locs, which has to decode from a block start.
+inline size_t vec_find_eventid( const IdList &locs, uint32_t eventid )
+{
+    return locs.lower_bound( eventid ).index();
+}
+
 /*
    [Compositor] NewFrame idx=2776
    [Compositor Client] WaitGetPoses End ThreadId=5125
@@ -161,6 +216,13 @@ public:
 
     uint32_t find_ts_index( int64_t ts0 );
 
+    // Build min/max level of detail pyramid from m_plotdata
+    void build_lod();
+    // Get m_lod level to draw count samples across width pixels, or -1 to draw all samples
+    int get_lod_level( size_t count, float width );
+    // Number of m_plotdata samples in each bucket of m_lod[ level ]
+    size_t get_lod_span( int level );
+
 public:
     struct plotdata_t
     {
@@ -170,6 +232,22 @@ public:
     };
     std::vector< plotdata_t > m_plotdata;
 
+    // Summary of a run of consecutive samples
+    struct plotlod_t
+    {
+        int64_t ts0;        // First sample timestamp
+        int64_t ts1;        // Last sample timestamp
+        uint32_t eventid;   // First sample eventid
+        float first;
+        float last;
+        float minval;
+        float maxval;
+    };
+    // Level 0 summarizes m_plotdata, each level above summarizes the level below
+    std::vector< std::vector< plotlod_t > > m_lod;
+    // Size of m_plotdata when m_lod was built
+    size_t m_lod_size = 0;
+
     float m_minval = FLT_MAX;
     float m_maxval = FLT_MIN;
 
@@ -220,6 +298,8 @@ public:
 
     std::string m_plot_buf;
     std::string m_plot_err_str;
+    // Fraction of events searched while Create waits on a background search
+    float m_plot_progress = 1.0f;
     bool m_interpolation;
     char m_plot_name_buf[ 128 ];
     char m_plot_filter_buf[ 512 ];
@@ -241,6 +321,8 @@ public:
 public:
     std::string m_buf;
     std::string m_err_str;
+    // Fraction of events searched while Create waits on a background search
+    float m_progress = 1.0f;
 
     char m_name_buf[ 128 ];
     char m_filter_buf[ 512 ];
@@ -263,16 +345,103 @@ public:
 public:
     std::string m_buf;
     std::string m_err_str;
+    // Fraction of events searched while Create waits on a background search
+    float m_progress = 1.0f;
 
     char m_filter_buf[ 512 ];
 
     std::vector< std::string > m_previous_filters;
 };
 
+// Events of a graph row bucketed by time, for drawing zoomed out rows
+struct event_tile_t
+{
+    int64_t ts0;        // First event timestamp
+    int64_t ts1;        // Last event timestamp
+    uint32_t locs0;     // Row locs index of first event
+    uint32_t locs1;     // Row locs index past last event
+    uint32_t count;     // Count of events drawn
+    ImU32 color;        // Last event color
+};
+
+struct event_tiles_t
+{
+    // levels[ i ] buckets are ( 1 << ( 10 + 2 * i ) ) ns wide
+    std::vector< std::vector< event_tile_t > > levels;
+
+    // Row locs size and TraceEvents::m_event_colors_gen when built
+    size_t locs_size = 0;
+    uint32_t colors_gen = 0;
+
+    // ImGui frame these were last drawn, so tiles of hidden rows get dropped
+    int last_frame = 0;
+};
+
+// Time intervals ( ts0, ts1 ) of a graph row's duration events, for finding
+//  the bars overlapping the visible range without scanning the whole row
+class interval_index_t
+{
+public:
+    void clear();
+    void add( uint32_t eventid, int64_t ts0, int64_t ts1 );
+    // Sort intervals by start and build max end tree
+    void build( size_t locs_size );
+
+    // Call func( eventid ) for intervals overlapping [ ts0, ts1 ], in start order
+    template < typename T >
+    void find( int64_t ts0, int64_t ts1, T func ) const
+    {
+        size_t count = std::upper_bound( m_ts0.begin(), m_ts0.end(), ts1 ) - m_ts0.begin();
+
+        if ( !count )
+            return;
+
+        // Walk max end tree depth first, skipping subtrees that end before
+        //  ts0 or that start past ts1.
+        struct node_t { size_t node; size_t first; size_t width; } stack[ 64 ];
+        size_t sp = 0;
+
+        stack[ sp++ ] = { 1, 0, m_leaves };
+        while ( sp )
+        {
+            node_t n = stack[ --sp ];
+
+            if ( ( n.first >= count ) || ( m_maxend[ n.node ] < ts0 ) )
+                continue;
+
+            if ( n.width == 1 )
+            {
+                func( m_eventids[ n.first ] );
+                continue;
+            }
+
+            n.width /= 2;
+            stack[ sp++ ] = { 2 * n.node + 1, n.first + n.width, n.width };
+            stack[ sp++ ] = { 2 * n.node, n.first, n.width };
+        }
+    }
+
+public:
+    // Row locs size when built
+    size_t locs_size = 0;
+    bool built = false;
+
+protected:
+    std::vector< int64_t > m_ts0;       // Interval starts, ascending
+    std::vector< uint32_t > m_eventids; // Event id of each interval
+    std::vector< int64_t > m_ts1;       // Interval ends (until built)
+
+    // Max interval end of each tree node, leaves at [ m_leaves, 2 * m_leaves )
+    std::vector< int64_t > m_maxend;
+    size_t m_leaves = 0;
+};
+
 struct row_filter_t
 {
     BitVec *bitvec = nullptr;
     std::vector< std::string > filters;
+    // Some filters are still being evaluated in the background
+    bool pending = false;
 };
 
 class RowFilters
@@ -288,6 +457,8 @@ public:
 
     size_t find_filter( const std::string &filter );
     void toggle_filter( TraceEvents &trace_events, size_t idx, const std::string &filter );
+    // Rebuild bitvec from the filters' event locations
+    void update_bitvec( TraceEvents &trace_events );
 
 public:
     uint32_t m_rowname_hash = 0;
@@ -340,8 +511,12 @@ public:
         std::string m_right_filter_err_str;
 
         // Left/Right event locations
-        const std::vector< uint32_t > *m_left_plocs = nullptr;
-        const std::vector< uint32_t > *m_right_plocs = nullptr;
+        const IdList *m_left_plocs = nullptr;
+        const IdList *m_right_plocs = nullptr;
+
+        // Fraction of events searched while filters are checked in the background
+        float m_left_progress = 1.0f;
+        float m_right_progress = 1.0f;
     } dlg;
 
     // Variables used to show & select set frame markers
@@ -397,19 +572,28 @@ public:
     tracestatus_t get_load_status( uint32_t *count = NULL );
 
     // Return vec of locations for a tdop expression. Ie: "$name=drm_handle_vblank"
-    const std::vector< uint32_t > *get_tdopexpr_locs( const char *name, std::string *err = nullptr );
+    //  With progress set, new expressions are evaluated on a background job: NULL is
+    //  returned and *progress gets the fraction of events checked (< 1.0f) until a
+    //  later call sees the job finished and picks up its results.
+    const IdList *get_tdopexpr_locs( const char *name, std::string *err = nullptr, float *progress = nullptr );
+    // Cancel background job for name, or all jobs if name is NULL
+    void tdopexpr_job_cancel( const char *name = nullptr );
+    // Evaluate tdop expression over chunks of m_events on worker threads. chunks[ i ] gets
+    //  the ascending ids of matching events in chunk i. Returns false if cancelled.
+    bool tdopexpr_eval_chunks( class TdopExpr *tdop_expr, std::vector< std::vector< uint32_t > > &chunks,
+                               SDL_atomic_t *eventsdone = nullptr, SDL_atomic_t *cancel = nullptr );
     // Return vec of locations for a cmdline. Ie: "SkinningApp-1536"
-    const std::vector< uint32_t > *get_comm_locs( const char *name );
+    const IdList *get_comm_locs( const char *name );
     // "gfx", "sdma0", etc.
-    const std::vector< uint32_t > *get_timeline_locs( const char *name );
+    const IdList *get_timeline_locs( const char *name );
 
     // Hash a string like "gfx_249_91446"
     uint64_t get_event_gfxcontext_hash( const trace_event_t &event );
-    const std::vector< uint32_t > *get_gfxcontext_locs( uint64_t gfxcontext_hash );
+    const IdList *get_gfxcontext_locs( uint64_t gfxcontext_hash );
 
     // Return vec of locations for sched_switch events.
     enum switch_t { SCHED_SWITCH_PREV, SCHED_SWITCH_NEXT };
-    const std::vector< uint32_t > *get_sched_switch_locs( int pid, switch_t switch_type );
+    const IdList *get_sched_switch_locs( int pid, switch_t switch_type );
 
     void calculate_amd_event_durations();
     void calculate_i915_req_event_durations();
@@ -426,7 +610,8 @@ public:
 
     void remove_single_tgids();
 
-    const std::vector< uint32_t > *get_locs( const char *name, loc_type_t *type = nullptr, std::string *errstr = nullptr );
+    const IdList *get_locs( const char *name, loc_type_t *type = nullptr, std::string *errstr = nullptr,
+                            float *progress = nullptr );
 
     GraphPlot *get_plot_ptr( const char *plot_name )
     {
@@ -458,7 +643,9 @@ public:
     {
         return m_ftrace.print_info.get_val( id );
     }
-    uint32_t ts_to_ftrace_print_info_idx( const std::vector< uint32_t > &locs, int64_t ts );
+
+    // Return id of first event at or after ts (or the last event)
+    uint32_t ts_to_eventid( int64_t ts ) const;
 
     void add_i915_perf_frequency( const trace_event_t &event, int64_t ts, float value );
 
@@ -467,6 +654,10 @@ public:
     void init();
 
     void init_new_event( trace_event_t &event );
+    void init_event_locations( size_t start, size_t end,
+                               TraceLocations &comm_locs, TraceLocations &eventnames_locs );
+    void init_ts_buckets();
+    void init_event_columns();
     void init_new_event_vblank( trace_event_t &event );
     void init_sched_switch_event( trace_event_t &event );
     void init_sched_process_fork( trace_event_t &event );
@@ -477,7 +668,7 @@ public:
     void init_i915_event( trace_event_t &event );
     void init_i915_perf_event( trace_event_t &event );
 
-    int new_event_cb( const trace_event_t &event );
+    int new_event_cb( std::vector< trace_event_t > &events, const trace_event_t &event );
     void new_event_ftrace_print( trace_event_t &event );
 
     ftrace_row_info_t *get_ftrace_row_info_pid( int pid, bool add = false );
@@ -493,12 +684,31 @@ public:
     trace_info_t m_trace_info;
     std::vector< trace_event_t > m_events;
 
+    // Event timestamps (m_events[ i ].ts) packed together for binary searches
+    std::vector< int64_t > m_events_ts;
+    // Event flags, pid, and duration columns for the graph row and filter loops.
+    //  Filled at the end of init(), once the duration passes have set them.
+    std::vector< uint32_t > m_events_flags;
+    std::vector< int > m_events_pid;
+    std::vector< int64_t > m_events_duration;
+
+    // Id of first event at or after m_ts_bucket_start + i * m_ts_bucket_width.
+    //  One bucket per few events, so ts_to_eventid() searches a handful of ts values.
+    std::vector< uint32_t > m_ts_buckets;
+    int64_t m_ts_bucket_start = 0;
+    int64_t m_ts_bucket_width = 1;
+
+    // Linux perf stack traces, indexed by trace_event_t::backtrace_id
+    std::vector< std::vector< const char * > > m_backtraces;
+
     // Max drm_vblank_event crc value we've seen
     int m_crtc_max = -1;
 
     // Map of tdop expression string hashval to array of event locations.
     TraceLocations m_tdopexpr_locs;
     std::unordered_set< uint64_t > m_failed_commands;
+    // Map of tdop expression string hashval to its running background job
+    util_umap< uint64_t, struct tdopexpr_job_t * > m_tdopexpr_jobs;
 
     // Map of comm hashval to array of event locations.
     TraceLocations m_comm_locs;
@@ -524,6 +734,8 @@ public:
     TraceLocations m_sched_switch_next_locs;
 
     TraceLocations m_sched_switch_cpu_locs;
+    // cpu -> open psci_domain_idle_enter event
+    TracePairedEvents m_psci_idle_enter;
     util_umap< int, int64_t > m_sched_switch_time_pid;
     int64_t m_sched_switch_time_total = 0;
 
@@ -552,7 +764,7 @@ public:
         TraceLocationsRingCtxSeq req_queue_locs;
 
         // i915-perf (GPU generated data)
-        std::vector< uint32_t > perf_locs;
+        IdList perf_locs;
         // i915-perf-begin event to i915_request_in
         util_umap< uint32_t, uint32_t > perf_to_req_in;
         // Maps a HW context ID to its color
@@ -583,7 +795,7 @@ public:
     struct
     {
         // ftrace print event IDs sorted by timestamp
-        std::vector< uint32_t > print_locs;
+        IdList print_locs;
 
         // event id to ftrace print event info map
         util_umap< uint32_t, print_info_t > print_info;
@@ -628,6 +840,14 @@ public:
     // 0: events loaded, 1+: loading events, -1: error
     SDL_atomic_t m_eventsloaded = { 1 };
 
+    // Per-cpu event counts drawn while trace.dat is loading
+    load_preview_t m_load_preview;
+
+    // Bumped when event colors change
+    uint32_t m_event_colors_gen = 0;
+    // Bumped each time init() runs on newly loaded events
+    uint32_t m_init_gen = 0;
+
     struct intel_perf_data_reader *i915_perf_reader = NULL;
     struct intel_xe_perf_data_reader *xe_perf_reader = NULL;
 
@@ -635,8 +855,8 @@ public:
         // set of rings discovered during event parsing
         std::unordered_set< std::string > rings;
 
-        // mapping from fence to outstanding job id
-        std::map<uint32_t, uint32_t> outstanding_jobs;
+        // fence -> outstanding drm_sched_job event
+        TracePairedEvents outstanding_jobs;
     } m_drm_sched;
 };
 
@@ -776,16 +996,27 @@ public:
     void render();
     void trace_render_info();
 
+    // Stop background event filter evaluation and throw away its results
+    void filter_job_cancel();
+
     trace_event_t &get_event( uint32_t id )
     {
         return m_trace_events.m_events[ id ];
     }
 
+protected:
+    // Render loading progress and per-cpu counts of events read so far
+    void load_preview_render( uint32_t count, bool loading );
+
 protected:
     // Render events list
     void eventlist_render_options();
     void eventlist_render();
 
+    // Start background evaluation of event filter / apply its results when done
+    void filter_job_start( class TdopExpr *tdop_expr );
+    void filter_job_update();
+
     // Handle events list popup menu
     bool eventlist_render_popupmenu( uint32_t eventid );
 
@@ -822,6 +1053,8 @@ protected:
     uint32_t graph_render_plot( graph_info_t &gi, GraphPlot &plot );
     // Render regular trace events
     uint32_t graph_render_row_events( graph_info_t &gi );
+    bool graph_render_row_event_tiles( graph_info_t &gi, class event_renderer_t &event_renderer,
+                                       bool hide_sched_switch );
     // Render intel i915 request_wait events
     uint32_t graph_render_i915_reqwait_events( graph_info_t &gi );
     // Render intel i915 request_add, request_submit, request_in, request_out, intel_engine_notify
@@ -924,8 +1157,6 @@ public:
     uint32_t m_create_filter_eventid = INVALID_ID;
     FrameMarkers m_frame_markers;
 
-    util_umap< int64_t, uint32_t > m_ts_to_eventid_cache;
-
     // Filter data
     struct
     {
@@ -937,6 +1168,8 @@ public:
         std::vector< uint32_t > events;
         // pid -> count of !filtered events for that pid
         util_umap< int, uint32_t > pid_eventcount;
+        // Background filter evaluation, if running
+        struct filter_job_t *job = nullptr;
     } m_filter;
 
     struct
@@ -1042,6 +1275,16 @@ public:
 
         float scroll_pos = -1.0f;
         float scroll_x = -1.0f;
+
+        // Row locs pointer | hide_sched_switch -> event tiles. Tiles not drawn
+        //  for s_event_tiles_max_age frames are freed.
+        util_umap< uint64_t, event_tiles_t > event_tiles;
+
+        // Row locs pointer | interval type -> duration event intervals
+        util_umap< uint64_t, interval_index_t > intervals;
+
+        // TraceEvents::m_init_gen event_tiles and intervals were built for
+        uint32_t init_gen = 0;
     } m_graph;
 
     // Pinned graph tooltip windows
@@ -1092,6 +1335,9 @@ enum : uint32_t
     OPT_Gamma,
     OPT_UseFreetype,
     OPT_TrimTrace,
+    OPT_ParallelLoad,
+    OPT_LazyFieldFormat,
+    OPT_EventCache,
     OPT_ShowFps,
     OPT_VerticalSync,
     OPT_ShowI915Counters,
@@ -1169,20 +1415,45 @@ public:
     row_pos_t() {}
     ~row_pos_t() {}
 
-    // Given a start and end time, return a row index with an open spot
-    uint32_t get_row( int64_t min_ts, int64_t max_ts );
+    // Add a block from min_ts to max_ts which needs a row
+    void add( uint32_t id, int64_t min_ts, int64_t max_ts )
+    {
+        m_blocks.push_back( { min_ts, max_ts, id, 0 } );
+    }
+
+    // Assign rows to all added blocks and call func( id, row ) for each
+    template < typename T >
+    void calc_rows( T func )
+    {
+        calc_rows();
+
+        for ( const block_t &block : m_blocks )
+            func( block.id, block.row );
+    }
+
+protected:
+    // Sweep blocks in start order, giving each the lowest row free at its start
+    void calc_rows();
 
 public:
+    struct block_t
+    {
+        int64_t min_ts;
+        int64_t max_ts;
+        uint32_t id;
+        uint32_t row;
+    };
+    std::vector< block_t > m_blocks;
+
     // Count of total rows used
     uint32_t m_rows = 0;
-    // Map of min_ts -> max_ts blocks used for for each row
-    std::array< std::map< int64_t, int64_t >, Opts::MAX_ROW_SIZE > m_row_pos = {};
 };
 
 class MainApp
 {
 public:
     struct loading_info_t;
+    struct load_source_t;
 
 public:
     MainApp() {}
@@ -1193,7 +1464,7 @@ public:
     void init( int argc, char **argv );
     void shutdown( SDL_Window *window );
 
-    bool load_file( const char *filename, bool last );
+    bool load_files( const std::vector< std::string > &filenames );
     void cancel_load_file();
 
     // Trace file loaded and viewing?
@@ -1230,13 +1501,14 @@ public:
     void set_state( state_t state, const char *filename = nullptr );
 
     static int SDLCALL thread_func( void *data );
+    static void load_source( load_source_t &source, TraceEvents &trace_events, bool use_cache );
 
-    static int load_trace_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb );
-    static int load_etl_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb );
-    static int load_i915_perf_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb );
-    static int load_xe_perf_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb );
+    static int load_trace_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb, bool use_cache );
+    static int load_etl_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb );
+    static int load_i915_perf_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb );
+    static int load_xe_perf_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb );
 #if defined( HAVE_RAPIDJSON )
-    static int load_perf_file( loading_info_t *loading_info, TraceEvents &trace_events, EventCallback trace_cb );
+    static int load_perf_file( load_source_t &source, TraceEvents &trace_events, EventCallback trace_cb );
 #endif
 
 public:
@@ -1252,14 +1524,34 @@ public:
         trace_type_xe_perf_trace,
     };
 
-    struct loading_info_t
+    // One input file of a load. Sources are read into their own event
+    //  arrays (concurrently where they don't share state) and then merged.
+    struct load_source_t
     {
-        // State_Idle, Loading, Loaded, CancelLoading
-        SDL_atomic_t state = { 0 };
+        std::string filename;
 
         // Which trace format are we loading
         trace_type_t type = trace_type_invalid;
 
+        // Extracted from a zip archive: delete when done
+        bool is_tmpfile = false;
+        // Zip archive member in a memory file: close when done
+        int memfd = -1;
+
+        // i915/xe perf files only need their own trace_info so they're
+        //  read on their own thread while trace files load.
+        bool is_standalone = false;
+        trace_info_t trace_info;
+
+        int ret = 0;
+        std::vector< trace_event_t > events;
+    };
+
+    struct loading_info_t
+    {
+        // State_Idle, Loading, Loaded, CancelLoading
+        SDL_atomic_t state = { 0 };
+
         uint64_t tracestart = 0;
         uint64_t tracelen = 0;
 
@@ -1269,7 +1561,16 @@ public:
         std::vector< std::string > inputfiles;
         std::unordered_set< std::string > tmpfiles;
 
-        bool last;
+        // Zip archive members decompressed into memory files
+        struct memfile_t
+        {
+            std::string name;   // Archive member name, picks the trace format
+            int fd = -1;
+        };
+        std::unordered_map< std::string, memfile_t > memfiles;
+
+        // Files being loaded by thread_func
+        std::vector< std::unique_ptr< load_source_t > > sources;
     };
     loading_info_t m_loading_info;
 
@@ -1288,8 +1589,6 @@ public:
 
     TraceWin *m_trace_win = nullptr;
 
-    trace_type_t m_trace_type = trace_type_invalid;
-
     FontInfo m_font_main;
     FontInfo m_font_small;
 
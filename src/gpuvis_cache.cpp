@@ -0,0 +1,764 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <functional>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#define USE_MMAP
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_cache.h"
+
+// Bump this whenever the cache layout or the event loading changes
+#define GPUVIS_CACHE_VERSION 3
+
+static const char s_cache_magic[ 8 ] = "gpuvisc";
+
+struct cache_header_t
+{
+    char magic[ 8 ];
+    uint32_t version;
+    uint32_t cpu_info_size;
+
+    // Trace file this cache was created from
+    uint64_t file_size;
+    int64_t file_mtime;
+
+    // Load options which change the events read
+    uint64_t tracestart;
+    uint64_t tracelen;
+    uint64_t trim_trace;
+};
+
+/*
+ * Everything is written with native endianness and every section is padded
+ * to 8 bytes so the columns can be used in place from the mapped file.
+ *
+ *   header
+ *   strings: count, u32 lengths[], nul terminated string data
+ *   trace_info: cpus, flags, ts, file/uname/version strings, cpu_info_t[],
+ *       pid_comm_map, pid_tgid_map, tgid_pids
+ *   events: count, field count, one column per trace_event_t member,
+ *       u32 numfields[], u32 field keys[], u32 field values[]
+ *   raw records: format count, u32 format system/name[], u32 event format[],
+ *       u32 record sizes[], record data
+ *
+ * Strings are stored as indices into the string table. Lazy fields which
+ * haven't been rendered are stored as INVALID_ID, and their event's raw
+ * record is stored instead. On reload the event formats are read from the
+ * trace file headers so those fields still render on demand.
+ */
+class cache_writer_t
+{
+public:
+    cache_writer_t() {}
+    ~cache_writer_t()
+    {
+        if ( m_fp )
+            fclose( m_fp );
+    }
+
+    bool open( const char *filename )
+    {
+        m_fp = fopen( filename, "wb" );
+        return !!m_fp;
+    }
+
+    bool close()
+    {
+        if ( m_fp && fclose( m_fp ) )
+            m_error = true;
+
+        m_fp = nullptr;
+        return !m_error;
+    }
+
+    void write( const void *data, size_t size )
+    {
+        if ( size && ( fwrite( data, size, 1, m_fp ) != 1 ) )
+            m_error = true;
+        m_offset += size;
+    }
+
+    template < typename T >
+    void write_val( T val )
+    {
+        write( &val, sizeof( T ) );
+    }
+
+    void write_str( const std::string &str )
+    {
+        write_val< uint64_t >( str.size() );
+        write( str.c_str(), str.size() );
+        align();
+    }
+
+    void align()
+    {
+        static const char s_pad[ 8 ] = { 0 };
+
+        write( s_pad, ( 8 - ( m_offset & 7 ) ) & 7 );
+    }
+
+public:
+    FILE *m_fp = nullptr;
+    size_t m_offset = 0;
+    bool m_error = false;
+};
+
+class cache_reader_t
+{
+public:
+    cache_reader_t( const char *data, size_t size ) : m_data( data ), m_size( size ) {}
+    ~cache_reader_t() {}
+
+    // Read count * per elements. The counts come from the file, so check
+    // them against what's left before multiplying anything.
+    template < typename T >
+    const T *get( uint64_t count = 1, uint64_t per = 1 )
+    {
+        if ( m_error || !per || ( count > ( m_size - m_offset ) / sizeof( T ) / per ) )
+        {
+            m_error = true;
+            return NULL;
+        }
+
+        const T *ret = ( const T * )( m_data + m_offset );
+
+        m_offset += count * per * sizeof( T );
+        return ret;
+    }
+
+    template < typename T >
+    const T *get_column( uint64_t count, uint64_t per = 1 )
+    {
+        const T *ret = get< T >( count, per );
+
+        align();
+        return ret;
+    }
+
+    template < typename T >
+    T get_val( T def = 0 )
+    {
+        const T *val = get< T >();
+
+        return val ? *val : def;
+    }
+
+    std::string get_str()
+    {
+        uint64_t len = get_val< uint64_t >();
+        const char *str = get_column< char >( len );
+
+        return str ? std::string( str, len ) : std::string();
+    }
+
+    void align()
+    {
+        m_offset = std::min< size_t >( m_size, ( m_offset + 7 ) & ~( size_t )7 );
+    }
+
+public:
+    const char *m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_error = false;
+};
+
+class cache_file_t
+{
+public:
+    cache_file_t() {}
+    ~cache_file_t()
+    {
+#if defined( USE_MMAP )
+        if ( m_data )
+            munmap( ( void * )m_data, m_size );
+#endif
+    }
+
+    bool open( const char *filename )
+    {
+        size_t size = get_file_size( filename );
+
+        if ( size < sizeof( cache_header_t ) )
+            return false;
+
+#if defined( USE_MMAP )
+        int fd = ::open( filename, O_RDONLY );
+        if ( fd < 0 )
+            return false;
+
+        void *map = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+
+        if ( map == MAP_FAILED )
+            return false;
+
+        madvise( map, size, MADV_SEQUENTIAL );
+
+        m_data = ( const char * )map;
+#else
+        FILE *fp = fopen( filename, "rb" );
+        if ( !fp )
+            return false;
+
+        m_buf.resize( size );
+        bool ok = ( fread( &m_buf[ 0 ], size, 1, fp ) == 1 );
+        fclose( fp );
+
+        if ( !ok )
+            return false;
+
+        m_data = &m_buf[ 0 ];
+#endif
+        m_size = size;
+        return true;
+    }
+
+public:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+#if !defined( USE_MMAP )
+    std::vector< char > m_buf;
+#endif
+};
+
+std::string trace_cache_filename( const char *file )
+{
+    std::string path = get_realpath( file );
+
+    // Keyed on the full trace path so same named traces don't collide
+    return util_get_cache_dir( "gpuvis" ) + string_format( "/%016" PRIx64 "-%s.gpuvis-cache",
+            hashstr64( path ), get_path_filename( path.c_str() ) );
+}
+
+static bool init_cache_header( cache_header_t &hdr, const char *file, const trace_info_t &trace_info )
+{
+    struct stat st;
+
+    if ( stat( file, &st ) )
+        return false;
+
+    memset( &hdr, 0, sizeof( hdr ) );
+    memcpy( hdr.magic, s_cache_magic, sizeof( hdr.magic ) );
+    hdr.version = GPUVIS_CACHE_VERSION;
+    hdr.cpu_info_size = sizeof( cpu_info_t );
+
+    hdr.file_size = st.st_size;
+    hdr.file_mtime = st.st_mtime;
+
+    hdr.tracestart = trace_info.m_tracestart;
+    hdr.tracelen = trace_info.m_tracelen;
+    hdr.trim_trace = trace_info.trim_trace;
+    return true;
+}
+
+template < typename T, typename F >
+static void write_column( cache_writer_t &writer, const std::vector< trace_event_t > &events, F func )
+{
+    for ( const trace_event_t &event : events )
+        writer.write_val< T >( func( event ) );
+    writer.align();
+}
+
+int write_trace_cache( const char *file, const trace_info_t &trace_info,
+                       const std::vector< trace_event_t > &events, StrPool &strpool )
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    cache_header_t hdr;
+
+    if ( !init_cache_header( hdr, file, trace_info ) )
+        return -1;
+
+    // Build the string table. Start with the pool so strings which
+    // are only referenced by hash value come back on reload.
+    std::vector< const char * > strs;
+    std::unordered_map< const char *, uint32_t > strindex;
+    auto add_str = [&]( const char *str )
+    {
+        if ( str && strindex.emplace( str, ( uint32_t )strs.size() ).second )
+            strs.push_back( str );
+    };
+    auto get_stridx = [&]( const char *str )
+    {
+        return str ? strindex[ str ] : INVALID_ID;
+    };
+
+    strpool.for_each( [&]( uint64_t hashval, const char *str ) { add_str( str ); } );
+    for ( const auto &it : trace_info.pid_comm_map.m_map )
+        add_str( it.second );
+
+    // Event formats of the raw records we store
+    std::vector< const raw_event_format_t * > formats;
+    std::unordered_map< const raw_event_format_t *, uint32_t > formatindex;
+
+    size_t numfields = 0;
+    for ( const trace_event_t &event : events )
+    {
+        add_str( event.comm );
+        add_str( event.system );
+        add_str( event.name );
+        add_str( event.user_comm );
+
+        for ( uint32_t i = 0; i < event.numfields; i++ )
+        {
+            add_str( event.fields[ i ].key );
+            add_str( event.fields[ i ].value );
+        }
+        numfields += event.numfields;
+
+        if ( event.raw_format &&
+             formatindex.emplace( event.raw_format, ( uint32_t )formats.size() ).second )
+        {
+            const char *system;
+            const char *name;
+
+            get_raw_event_format_name( event.raw_format, &system, &name );
+            add_str( system );
+            add_str( name );
+
+            formats.push_back( event.raw_format );
+        }
+    }
+
+    // Write to a temp file and rename it into place when complete
+    std::string filename = trace_cache_filename( file );
+    std::string filename_tmp = filename + ".tmp";
+    cache_writer_t writer;
+
+    if ( !writer.open( filename_tmp.c_str() ) )
+        return -1;
+
+    writer.write( &hdr, sizeof( hdr ) );
+
+    // Strings
+    writer.write_val< uint64_t >( strs.size() );
+    for ( const char *str : strs )
+        writer.write_val< uint32_t >( strlen( str ) );
+    writer.align();
+    for ( const char *str : strs )
+        writer.write( str, strlen( str ) + 1 );
+    writer.align();
+
+    // trace_info
+    writer.write_val< uint64_t >( trace_info.cpus );
+    writer.write_val< uint64_t >( trace_info.timestamp_in_us );
+    writer.write_val< int64_t >( trace_info.min_file_ts );
+    writer.write_val< int64_t >( trace_info.trimmed_ts );
+    writer.write_str( trace_info.file );
+    writer.write_str( trace_info.uname );
+    writer.write_str( trace_info.opt_version );
+
+    writer.write_val< uint64_t >( trace_info.cpu_info.size() );
+    if ( !trace_info.cpu_info.empty() )
+        writer.write( &trace_info.cpu_info[ 0 ], trace_info.cpu_info.size() * sizeof( cpu_info_t ) );
+    writer.align();
+
+    writer.write_val< uint64_t >( trace_info.pid_comm_map.m_map.size() );
+    for ( const auto &it : trace_info.pid_comm_map.m_map )
+    {
+        writer.write_val< int32_t >( it.first );
+        writer.write_val< uint32_t >( get_stridx( it.second ) );
+    }
+
+    writer.write_val< uint64_t >( trace_info.pid_tgid_map.m_map.size() );
+    for ( const auto &it : trace_info.pid_tgid_map.m_map )
+    {
+        writer.write_val< int32_t >( it.first );
+        writer.write_val< int32_t >( it.second );
+    }
+
+    writer.write_val< uint64_t >( trace_info.tgid_pids.m_map.size() );
+    for ( const auto &it : trace_info.tgid_pids.m_map )
+    {
+        const tgid_info_t &tgid_info = it.second;
+
+        writer.write_val< int32_t >( tgid_info.tgid );
+        writer.write_val< uint32_t >( tgid_info.hashval );
+        writer.write_val< uint32_t >( tgid_info.pids.size() );
+        for ( int pid : tgid_info.pids )
+            writer.write_val< int32_t >( pid );
+    }
+    writer.align();
+
+    // Event columns
+    writer.write_val< uint64_t >( events.size() );
+    writer.write_val< uint64_t >( numfields );
+
+    write_column< int32_t >( writer, events, []( const trace_event_t &e ) { return e.pid; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.cpu; } );
+    write_column< int64_t >( writer, events, []( const trace_event_t &e ) { return e.ts; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.flags; } );
+    write_column< uint16_t >( writer, events, []( const trace_event_t &e ) { return e.type; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.seqno; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.id_start; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.graph_row_id; } );
+    write_column< int32_t >( writer, events, []( const trace_event_t &e ) { return e.crtc; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.i915_perf_timeline; } );
+    write_column< int64_t >( writer, events, []( const trace_event_t &e ) { return e.vblank_ts; } );
+    write_column< uint8_t >( writer, events, []( const trace_event_t &e ) { return e.vblank_ts_high_prec; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.color; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.color_index; } );
+    write_column< int64_t >( writer, events, []( const trace_event_t &e ) { return e.duration; } );
+    write_column< uint32_t >( writer, events, [&]( const trace_event_t &e ) { return get_stridx( e.comm ); } );
+    write_column< uint32_t >( writer, events, [&]( const trace_event_t &e ) { return get_stridx( e.system ); } );
+    write_column< uint32_t >( writer, events, [&]( const trace_event_t &e ) { return get_stridx( e.name ); } );
+    write_column< uint32_t >( writer, events, [&]( const trace_event_t &e ) { return get_stridx( e.user_comm ); } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return e.numfields; } );
+
+    for ( const trace_event_t &event : events )
+    {
+        for ( uint32_t i = 0; i < event.numfields; i++ )
+            writer.write_val< uint32_t >( get_stridx( event.fields[ i ].key ) );
+    }
+    writer.align();
+
+    for ( const trace_event_t &event : events )
+    {
+        for ( uint32_t i = 0; i < event.numfields; i++ )
+            writer.write_val< uint32_t >( get_stridx( event.fields[ i ].value ) );
+    }
+    writer.align();
+
+    // Raw records
+    writer.write_val< uint64_t >( formats.size() );
+    for ( const raw_event_format_t *raw_format : formats )
+    {
+        const char *system;
+        const char *name;
+
+        get_raw_event_format_name( raw_format, &system, &name );
+        writer.write_val< uint32_t >( get_stridx( system ) );
+        writer.write_val< uint32_t >( get_stridx( name ) );
+    }
+    writer.align();
+
+    write_column< uint32_t >( writer, events, [&]( const trace_event_t &e )
+        { return e.raw_format ? formatindex[ e.raw_format ] : INVALID_ID; } );
+    write_column< uint32_t >( writer, events, []( const trace_event_t &e ) { return get_event_raw_size( e ); } );
+
+    for ( const trace_event_t &event : events )
+        writer.write( event.raw_data, get_event_raw_size( event ) );
+    writer.align();
+
+    if ( !writer.close() || rename( filename_tmp.c_str(), filename.c_str() ) )
+    {
+        remove( filename_tmp.c_str() );
+        return -1;
+    }
+
+    return 0;
+}
+
+static bool valid_stridx( const uint32_t *idx, size_t count, size_t numstrs )
+{
+    for ( size_t i = 0; i < count; i++ )
+    {
+        if ( ( idx[ i ] >= numstrs ) && ( idx[ i ] != INVALID_ID ) )
+            return false;
+    }
+    return true;
+}
+
+int read_trace_cache( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb )
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    cache_header_t hdr;
+    cache_file_t cache_file;
+
+    if ( !init_cache_header( hdr, file, trace_info ) )
+        return -1;
+
+    std::string filename = trace_cache_filename( file );
+
+    if ( !cache_file.open( filename.c_str() ) ||
+         memcmp( &hdr, cache_file.m_data, sizeof( hdr ) ) )
+    {
+        return -1;
+    }
+
+    cache_reader_t reader( cache_file.m_data, cache_file.m_size );
+
+    reader.get< cache_header_t >();
+
+    // Strings
+    uint64_t numstrs = reader.get_val< uint64_t >();
+    const uint32_t *strlens = reader.get_column< uint32_t >( numstrs );
+    const char *strdata = reader.m_data + reader.m_offset;
+    size_t strsize = 0;
+
+    for ( uint64_t i = 0; strlens && ( i < numstrs ); i++ )
+        strsize += strlens[ i ] + 1;
+    reader.get_column< char >( strsize );
+
+    // trace_info
+    uint32_t cpus = reader.get_val< uint64_t >();
+    bool timestamp_in_us = !!reader.get_val< uint64_t >();
+    int64_t min_file_ts = reader.get_val< int64_t >();
+    int64_t trimmed_ts = reader.get_val< int64_t >();
+    std::string tracefile = reader.get_str();
+    std::string uname = reader.get_str();
+    std::string opt_version = reader.get_str();
+
+    uint64_t numcpus = reader.get_val< uint64_t >();
+    const cpu_info_t *cpu_info = reader.get_column< cpu_info_t >( numcpus );
+
+    uint64_t numpidcomms = reader.get_val< uint64_t >();
+    const uint32_t *pidcomms = reader.get< uint32_t >( numpidcomms, 2 );
+
+    uint64_t numpidtgids = reader.get_val< uint64_t >();
+    const int32_t *pidtgids = reader.get< int32_t >( numpidtgids, 2 );
+
+    uint64_t numtgids = reader.get_val< uint64_t >();
+    const uint32_t *tgids = ( const uint32_t * )( reader.m_data + reader.m_offset );
+
+    for ( uint64_t i = 0; !reader.m_error && ( i < numtgids ); i++ )
+    {
+        const uint32_t *tgid = reader.get< uint32_t >( 3 );
+
+        if ( tgid )
+            reader.get< int32_t >( tgid[ 2 ] );
+    }
+    reader.align();
+
+    // Event columns
+    uint64_t numevents = reader.get_val< uint64_t >();
+    uint64_t numfields = reader.get_val< uint64_t >();
+
+    const int32_t *pid = reader.get_column< int32_t >( numevents );
+    const uint32_t *cpu = reader.get_column< uint32_t >( numevents );
+    const int64_t *ts = reader.get_column< int64_t >( numevents );
+    const uint32_t *flags = reader.get_column< uint32_t >( numevents );
+    const uint16_t *type = reader.get_column< uint16_t >( numevents );
+    const uint32_t *seqno = reader.get_column< uint32_t >( numevents );
+    const uint32_t *id_start = reader.get_column< uint32_t >( numevents );
+    const uint32_t *graph_row_id = reader.get_column< uint32_t >( numevents );
+    const int32_t *crtc = reader.get_column< int32_t >( numevents );
+    const uint32_t *i915_perf_timeline = reader.get_column< uint32_t >( numevents );
+    const int64_t *vblank_ts = reader.get_column< int64_t >( numevents );
+    const uint8_t *vblank_ts_high_prec = reader.get_column< uint8_t >( numevents );
+    const uint32_t *color = reader.get_column< uint32_t >( numevents );
+    const uint32_t *color_index = reader.get_column< uint32_t >( numevents );
+    const int64_t *duration = reader.get_column< int64_t >( numevents );
+    const uint32_t *comm = reader.get_column< uint32_t >( numevents );
+    const uint32_t *system = reader.get_column< uint32_t >( numevents );
+    const uint32_t *name = reader.get_column< uint32_t >( numevents );
+    const uint32_t *user_comm = reader.get_column< uint32_t >( numevents );
+    const uint32_t *event_numfields = reader.get_column< uint32_t >( numevents );
+    const uint32_t *field_keys = reader.get_column< uint32_t >( numfields );
+    const uint32_t *field_values = reader.get_column< uint32_t >( numfields );
+
+    // Raw records
+    uint64_t numformats = reader.get_val< uint64_t >();
+    const uint32_t *format_names = reader.get_column< uint32_t >( numformats, 2 );
+    const uint32_t *raw_format = reader.get_column< uint32_t >( numevents );
+    const uint32_t *raw_size = reader.get_column< uint32_t >( numevents );
+    uint64_t rawsize = 0;
+
+    for ( uint64_t i = 0; raw_size && ( i < numevents ); i++ )
+        rawsize += raw_size[ i ];
+    const char *raw_data = reader.get_column< char >( rawsize );
+
+    if ( reader.m_error || ( reader.m_offset != reader.m_size ) )
+        return -1;
+
+    // Validate string indices and field counts before touching anything
+    uint64_t totfields = 0;
+    for ( uint64_t i = 0; i < numevents; i++ )
+    {
+        if ( ( type[ i ] >= TRACE_EVENT_Max ) ||
+             ( is_valid_id( raw_format[ i ] ) && ( raw_format[ i ] >= numformats ) ) )
+        {
+            return -1;
+        }
+
+        totfields += event_numfields[ i ];
+    }
+
+    // Unset field values must be renderable from their event's raw record
+    std::vector< uint32_t > format_numfields( numformats, 0 );
+    if ( totfields == numfields )
+    {
+        const uint32_t *values = field_values;
+
+        for ( uint64_t i = 0; i < numevents; i++ )
+        {
+            for ( uint32_t j = 0; j < event_numfields[ i ]; j++ )
+            {
+                if ( is_valid_id( values[ j ] ) )
+                    continue;
+                if ( !is_valid_id( raw_format[ i ] ) )
+                    return -1;
+
+                uint32_t &count = format_numfields[ raw_format[ i ] ];
+                count = std::max< uint32_t >( count, j + 1 );
+            }
+            values += event_numfields[ i ];
+        }
+    }
+
+    for ( uint64_t i = 0; i < numpidcomms; i++ )
+    {
+        if ( !valid_stridx( &pidcomms[ i * 2 + 1 ], 1, numstrs ) )
+            return -1;
+    }
+
+    if ( ( totfields != numfields ) ||
+         !valid_stridx( comm, numevents, numstrs ) ||
+         !valid_stridx( system, numevents, numstrs ) ||
+         !valid_stridx( name, numevents, numstrs ) ||
+         !valid_stridx( user_comm, numevents, numstrs ) ||
+         !valid_stridx( field_keys, numfields, numstrs ) ||
+         !valid_stridx( field_values, numfields, numstrs ) ||
+         !valid_stridx( format_names, numformats * 2, numstrs ) )
+    {
+        return -1;
+    }
+
+    std::vector< const char * > strs( numstrs + 1 );
+    for ( uint64_t i = 0; i < numstrs; i++ )
+    {
+        strs[ i ] = strpool.getstr( strdata, strlens[ i ] );
+        strdata += strlens[ i ] + 1;
+    }
+    auto get_str = [&]( uint32_t idx )
+    {
+        return is_valid_id( idx ) ? strs[ idx ] : NULL;
+    };
+
+    // Unrendered lazy fields need the event formats from the trace file
+    std::vector< const raw_event_format_t * > formats( numformats );
+
+    if ( numformats && read_trace_formats( file, strpool, trace_info ) )
+        return -1;
+
+    for ( uint64_t i = 0; i < numformats; i++ )
+    {
+        const char *format_system = get_str( format_names[ i * 2 ] );
+        const char *format_name = get_str( format_names[ i * 2 + 1 ] );
+
+        formats[ i ] = ( format_system && format_name ) ?
+                find_raw_event_format( trace_info, format_system, format_name ) : NULL;
+        if ( !formats[ i ] || ( get_raw_event_format_numfields( formats[ i ] ) < format_numfields[ i ] ) )
+            return -1;
+    }
+
+    trace_info.cpus = cpus;
+    trace_info.file = tracefile;
+    trace_info.uname = uname;
+    trace_info.opt_version = opt_version;
+    trace_info.timestamp_in_us = timestamp_in_us;
+    trace_info.min_file_ts = min_file_ts;
+    trace_info.trimmed_ts = trimmed_ts;
+    trace_info.cpu_info.assign( cpu_info, cpu_info + numcpus );
+
+    for ( uint64_t i = 0; i < numpidcomms; i++ )
+        trace_info.pid_comm_map.set_val( ( int )pidcomms[ i * 2 ], get_str( pidcomms[ i * 2 + 1 ] ) );
+
+    for ( uint64_t i = 0; i < numpidtgids; i++ )
+        trace_info.pid_tgid_map.set_val( pidtgids[ i * 2 ], pidtgids[ i * 2 + 1 ] );
+
+    for ( uint64_t i = 0; i < numtgids; i++ )
+    {
+        tgid_info_t *tgid_info = trace_info.tgid_pids.get_val_create( ( int )tgids[ 0 ] );
+
+        tgid_info->tgid = ( int )tgids[ 0 ];
+        tgid_info->hashval = tgids[ 1 ];
+        for ( uint32_t j = 0; j < tgids[ 2 ]; j++ )
+            tgid_info->add_pid( ( int )tgids[ 3 + j ] );
+
+        tgids += 3 + tgids[ 2 ];
+    }
+
+    // One allocation for every event's fields instead of one per event.
+    //  Event fields are never freed, same as with read_trace_file.
+    event_field_t *fields = numfields ? new event_field_t[ numfields ] : NULL;
+
+    // Hand events to the loader just like read_trace_file does
+    uint64_t field = 0;
+    for ( uint64_t i = 0; i < numevents; i++ )
+    {
+        trace_event_t event;
+
+        event.pid = pid[ i ];
+        event.id = ( uint32_t )i;
+        event.cpu = cpu[ i ];
+        event.ts = ts[ i ];
+        event.flags = flags[ i ];
+        event.type = type[ i ];
+        event.seqno = seqno[ i ];
+        event.id_start = id_start[ i ];
+        event.graph_row_id = graph_row_id[ i ];
+        event.crtc = crtc[ i ];
+        event.i915_perf_timeline = i915_perf_timeline[ i ];
+        event.vblank_ts = vblank_ts[ i ];
+        event.vblank_ts_high_prec = !!vblank_ts_high_prec[ i ];
+        event.color = color[ i ];
+        event.color_index = color_index[ i ];
+        event.duration = duration[ i ];
+        event.comm = get_str( comm[ i ] );
+        event.system = get_str( system[ i ] );
+        event.name = get_str( name[ i ] );
+        event.user_comm = get_str( user_comm[ i ] );
+
+        event.numfields = event_numfields[ i ];
+        event.fields = event.numfields ? &fields[ field ] : NULL;
+        for ( uint32_t j = 0; j < event.numfields; j++, field++ )
+        {
+            event.fields[ j ].key = get_str( field_keys[ field ] );
+            event.fields[ j ].value = get_str( field_values[ field ] );
+        }
+
+        if ( is_valid_id( raw_format[ i ] ) )
+            set_event_raw_record( event, formats[ raw_format[ i ] ], raw_data, raw_size[ i ] );
+        raw_data += raw_size[ i ];
+
+        // Bail if user cancelled
+        if ( cb( event ) )
+            break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GPUVIS_CACHE_H_
+#define GPUVIS_CACHE_H_
+
+// Events read from a trace file are cached in the user's cache directory so
+// reopening an unchanged trace doesn't have to parse it again. The cache
+// is keyed on the trace file path, size, mtime, and load trim options.
+std::string trace_cache_filename( const char *file );
+
+// Returns 0 if events were read from the cache, -1 if no valid cache exists.
+int read_trace_cache( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb );
+
+// Returns 0 if the cache was written. Lazy fields are stored as raw records.
+int write_trace_cache( const char *file, const trace_info_t &trace_info,
+                       const std::vector< trace_event_t > &events, StrPool &strpool );
+
+#endif // GPUVIS_CACHE_H_
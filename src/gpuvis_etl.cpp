@@ -882,6 +882,7 @@ private:
         event.fields[1].key = mStrPool.getstr( "seq" );
         event.fields[1].value = mStrPool.getstrf( "%ull", seq );
         event.flags = TRACE_FLAG_VBLANK;
+        event.type = TRACE_EVENT_drm_vblank_event;
 
         return mCallback( event );
     }
@@ -912,6 +913,7 @@ private:
             // Packet was received by the scheduler
             event.name = mStrPool.getstr( "amdgpu_cs_ioctl" ); // For dat compatibility
             event.flags = TRACE_FLAG_SW_QUEUE;
+            event.type = TRACE_EVENT_amdgpu_cs_ioctl;
             break;
         case EVENT_TRACE_TYPE_INFO:
             // Begin move to HW queue? Use DmaPacket/Start instead
@@ -956,11 +958,13 @@ private:
             // Submit to the HW engine
             event.name = mStrPool.getstr( "amdgpu_sched_run_job" ); // For dat compatibility
             event.flags = TRACE_FLAG_HW_QUEUE;
+            event.type = TRACE_EVENT_amdgpu_sched_run_job;
             break;
         case EVENT_TRACE_TYPE_INFO:
             // Finished processing by the GPU ISR
             event.name = mStrPool.getstr( "fence_signaled" ); // For dat compatibility
             event.flags = TRACE_FLAG_FENCE_SIGNALED;
+            event.type = TRACE_EVENT_fence_signaled;
             break;
         default:
             return 0;
@@ -94,6 +94,9 @@ void FrameMarkers::clear_dlg()
 
     dlg.m_left_plocs = NULL;
     dlg.m_right_plocs = NULL;
+
+    dlg.m_left_progress = 1.0f;
+    dlg.m_right_progress = 1.0f;
 }
 
 void FrameMarkers::set_tooltip()
@@ -172,7 +175,9 @@ bool FrameMarkers::render_dlg( TraceEvents &trace_events )
 
         item_hovered |= ImGui::IsItemHovered();
 
-        if ( !dlg.m_left_filter_err_str.empty() )
+        if ( dlg.m_left_progress < 1.0f )
+            ImGui::Text( "Searching events %.0f%%...", 100.0f * dlg.m_left_progress );
+        else if ( !dlg.m_left_filter_err_str.empty() )
             ImGui::TextColored( ImVec4( 1, 0, 0, 1 ), "%s", dlg.m_left_filter_err_str.c_str() );
         else if ( dlg.m_left_plocs )
             ImGui::TextColored( ImVec4( 0, 1, 0, 1 ), "%lu events found", dlg.m_left_plocs->size() );
@@ -190,7 +195,9 @@ bool FrameMarkers::render_dlg( TraceEvents &trace_events )
 
         item_hovered |= ImGui::IsItemHovered();
 
-        if ( !dlg.m_right_filter_err_str.empty() )
+        if ( dlg.m_right_progress < 1.0f )
+            ImGui::Text( "Searching events %.0f%%...", 100.0f * dlg.m_right_progress );
+        else if ( !dlg.m_right_filter_err_str.empty() )
             ImGui::TextColored( ImVec4( 1, 0, 0, 1 ), "%s", dlg.m_right_filter_err_str.c_str() );
         else if ( dlg.m_right_plocs )
             ImGui::TextColored( ImVec4( 0, 1, 0, 1 ), "%lu events found", dlg.m_right_plocs->size() );
@@ -254,23 +261,28 @@ bool FrameMarkers::render_dlg( TraceEvents &trace_events )
     // "Check filters" or "Set Frame Markers" buttons
     if ( !dlg.m_checked )
     {
-        if ( ImGui::Button( "Check filters", button_size ) || s_actions().get( action_return ) )
+        // Keep checking each frame while background searches are running
+        bool pending = ( dlg.m_left_progress < 1.0f ) || ( dlg.m_right_progress < 1.0f );
+
+        if ( ImGui::Button( "Check filters", button_size ) || s_actions().get( action_return ) || pending )
         {
-            dlg.m_left_plocs = trace_events.get_tdopexpr_locs( dlg.m_left_marker_buf, &dlg.m_left_filter_err_str );
-            dlg.m_right_plocs = trace_events.get_tdopexpr_locs( right_marker_buf, &dlg.m_right_filter_err_str );
+            dlg.m_left_plocs = trace_events.get_tdopexpr_locs( dlg.m_left_marker_buf,
+                    &dlg.m_left_filter_err_str, &dlg.m_left_progress );
+            dlg.m_right_plocs = trace_events.get_tdopexpr_locs( right_marker_buf,
+                    &dlg.m_right_filter_err_str, &dlg.m_right_progress );
 
-            if ( !dlg.m_left_plocs )
+            if ( ( dlg.m_left_progress < 1.0f ) || ( dlg.m_right_progress < 1.0f ) )
             {
-                if ( dlg.m_left_filter_err_str.empty() )
-                    dlg.m_left_filter_err_str = "WARNING: No events found.";
+                // Still searching
             }
-            if ( !dlg.m_right_plocs )
+            else if ( !dlg.m_left_plocs || !dlg.m_right_plocs )
             {
-                if ( dlg.m_right_filter_err_str.empty() )
+                if ( !dlg.m_left_plocs && dlg.m_left_filter_err_str.empty() )
+                    dlg.m_left_filter_err_str = "WARNING: No events found.";
+                if ( !dlg.m_right_plocs && dlg.m_right_filter_err_str.empty() )
                     dlg.m_right_filter_err_str = "WARNING: No events found.";
             }
-
-            if ( dlg.m_left_plocs && dlg.m_right_plocs )
+            else
             {
                 setup_frames( trace_events, false );
                 dlg.m_checked = true;
@@ -306,7 +318,16 @@ bool FrameMarkers::render_dlg( TraceEvents &trace_events )
     // Cancel button
     ImGui::SameLine();
     if ( ImGui::Button( "Cancel", button_size ) || s_actions().get( action_escape ) )
+    {
+        if ( ( dlg.m_left_progress < 1.0f ) || ( dlg.m_right_progress < 1.0f ) )
+        {
+            trace_events.tdopexpr_job_cancel( dlg.m_left_marker_buf );
+            trace_events.tdopexpr_job_cancel( right_marker_buf );
+            clear_dlg();
+        }
+
         ImGui::CloseCurrentPopup();
+    }
 
     ImGui::EndPopup();
 
@@ -330,9 +351,9 @@ int64_t FrameMarkers::get_frame_len( TraceEvents &trace_events, int frame )
 
 void FrameMarkers::setup_frames( TraceEvents &trace_events, bool set_frames )
 {
-    uint32_t idx = 0;
-    const std::vector< uint32_t > &locs_left = *dlg.m_left_plocs;
-    const std::vector< uint32_t > &locs_right = *dlg.m_right_plocs;
+    const IdList &locs_left = *dlg.m_left_plocs;
+    const IdList &locs_right = *dlg.m_right_plocs;
+    IdList::const_iterator left = locs_left.begin();
 
     dlg.m_count = 0;
     dlg.m_tot_ts = 0;
@@ -349,13 +370,15 @@ void FrameMarkers::setup_frames( TraceEvents &trace_events, bool set_frames )
     for ( uint32_t right_eventid : locs_right )
     {
         // Find entryid in left which is < this right eventid
-        while ( locs_left[ idx ] < right_eventid )
+        while ( *left < right_eventid )
         {
+            IdList::const_iterator next = left;
+
             // Check if this is our last left event or the next event is greater.
-            if ( ( idx + 1 >= locs_left.size() ) ||
-                 ( locs_left[ idx + 1 ] >= right_eventid ) )
+            if ( ( ++next == locs_left.end() ) ||
+                 ( *next >= right_eventid ) )
             {
-                const trace_event_t &left_event = trace_events.m_events[ locs_left[ idx ] ];
+                const trace_event_t &left_event = trace_events.m_events[ *left ];
                 const trace_event_t &right_event = trace_events.m_events[ right_eventid ];
                 int64_t ts = right_event.ts - left_event.ts;
 
@@ -366,16 +389,17 @@ void FrameMarkers::setup_frames( TraceEvents &trace_events, bool set_frames )
 
                 if ( set_frames )
                 {
-                    m_left_frames.push_back( locs_left[ idx ] );
+                    m_left_frames.push_back( *left );
                     m_right_frames.push_back( right_eventid );
                 }
 
-                if ( ++idx >= locs_left.size() )
+                if ( next == locs_left.end() )
                     return;
+                left = next;
                 break;
             }
 
-            idx++;
+            left = next;
         }
     }
 }
@@ -565,57 +565,62 @@ void TraceEvents::calculate_event_print_info()
 
         return ( lval->ts < rval->ts );
     };
-    std::sort( m_ftrace.print_locs.begin(), m_ftrace.print_locs.end(), cmp_ts );
+    std::vector< uint32_t > locs( m_ftrace.print_locs.begin(), m_ftrace.print_locs.end() );
 
-    // Sort ftrace print event IDs based on duration
-    auto cmp_dur = [&]( const uint32_t lx, const uint32_t rx )
-    {
-        const trace_event_t &lval = m_events[ lx ];
-        const trace_event_t &rval = m_events[ rx ];
-        int64_t ldur = lval.has_duration() ? lval.duration : 0;
-        int64_t rdur = rval.has_duration() ? rval.duration : 0;
-
-        return ( ldur > rdur );
-    };
-    std::vector< uint32_t > locs_duration = m_ftrace.print_locs;
-    std::sort( locs_duration.begin(), locs_duration.end(), cmp_dur );
+    std::sort( locs.begin(), locs.end(), cmp_ts );
+    m_ftrace.print_locs.assign( locs );
 
     row_pos_t row_pos;
     ftrace_row_info_t *row_info;
     util_umap< int, row_pos_t > row_pos_pid;
     util_umap< int, row_pos_t > row_pos_tgid;
 
-    // Go through all the ftrace print events with largest durations first
-    for ( uint32_t idx : locs_duration )
+    // Add ftrace print event blocks to the global, pid, and tgid rows
+    for ( uint32_t idx : m_ftrace.print_locs )
     {
-        row_pos_t *prow_pos;
-        trace_event_t &event = m_events[ idx ];
-        print_info_t *print_info = m_ftrace.print_info.get_val( event.id );
+        const trace_event_t &event = m_events[ idx ];
+        const print_info_t *print_info = m_ftrace.print_info.get_val( event.id );
         int64_t min_ts = print_info->ts;
         int64_t duration = event.has_duration() ? event.duration : ( 1 * NSECS_PER_MSEC );
         int64_t max_ts = min_ts + duration;
 
-        // Global print row id
-        event.graph_row_id = row_pos.get_row( min_ts, max_ts );
+        row_pos.add( idx, min_ts, max_ts );
+        row_pos_pid.get_val_create( event.pid )->add( idx, min_ts, max_ts );
 
-        // Pid print row id
-        prow_pos = row_pos_pid.get_val_create( event.pid );
-        print_info->graph_row_id_pid = prow_pos->get_row( min_ts, max_ts );
+        if ( print_info->tgid )
+            row_pos_tgid.get_val_create( print_info->tgid )->add( idx, min_ts, max_ts );
+    }
 
-        row_info = get_ftrace_row_info_pid( event.pid, true );
-        row_info->rows = std::max< uint32_t >( row_info->rows, prow_pos->m_rows );
-        row_info->count++;
+    // Global print row ids
+    row_pos.calc_rows( [&]( uint32_t idx, uint32_t row )
+    {
+        m_events[ idx ].graph_row_id = row;
+    } );
 
-        if ( print_info->tgid )
+    // Pid print row ids
+    for ( auto &entry : row_pos_pid.m_map )
+    {
+        entry.second.calc_rows( [&]( uint32_t idx, uint32_t row )
         {
-            // Tgid print row id
-            prow_pos = row_pos_tgid.get_val_create( print_info->tgid );
-            print_info->graph_row_id_tgid = prow_pos->get_row( min_ts, max_ts );
+            m_ftrace.print_info.get_val( idx )->graph_row_id_pid = row;
+        } );
 
-            row_info = get_ftrace_row_info_tgid( print_info->tgid, true );
-            row_info->rows = std::max< uint32_t >( row_info->rows, prow_pos->m_rows );
-            row_info->count++;
-        }
+        row_info = get_ftrace_row_info_pid( entry.first, true );
+        row_info->rows = std::max< uint32_t >( row_info->rows, entry.second.m_rows );
+        row_info->count += entry.second.m_blocks.size();
+    }
+
+    // Tgid print row ids
+    for ( auto &entry : row_pos_tgid.m_map )
+    {
+        entry.second.calc_rows( [&]( uint32_t idx, uint32_t row )
+        {
+            m_ftrace.print_info.get_val( idx )->graph_row_id_tgid = row;
+        } );
+
+        row_info = get_ftrace_row_info_tgid( entry.first, true );
+        row_info->rows = std::max< uint32_t >( row_info->rows, entry.second.m_rows );
+        row_info->count += entry.second.m_blocks.size();
     }
 
     // Add info for special pid=-1 (all ftrace print events)
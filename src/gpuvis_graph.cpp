@@ -66,6 +66,9 @@ public:
     event_renderer_t( graph_info_t &gi, float y_in, float w_in, float h_in );
 
     void add_event( uint32_t eventid, float x, ImU32 color );
+    void add_event_marker( uint32_t eventid, float x );
+    // Add count events between x0 and x1 from an event tile
+    void add_tile( float x0, float x1, uint32_t count, ImU32 color );
     void done();
 
     void draw_event_markers();
@@ -73,6 +76,7 @@ public:
     void set_y( float y_in, float h_in );
 
     bool is_event_filtered( const trace_event_t &event );
+    bool is_event_filtered( uint32_t event_id, int pid );
 
 protected:
     void start( float x, ImU32 color );
@@ -111,7 +115,7 @@ struct row_info_t
     loc_type_t row_type;
     std::string row_name;
     std::string row_filter_expr;
-    const std::vector< uint32_t > *plocs;
+    const IdList *plocs;
 
     float scale_ts = 1.0f;
 
@@ -127,6 +131,9 @@ struct row_info_t
     const tgid_info_t *tgid_info = NULL;
 
     RenderGraphRowCallback render_cb = nullptr;
+
+    // Fraction of events searched while a filter expression row is evaluated
+    float progress = 1.0f;
 };
 
 class graph_info_t
@@ -340,7 +347,7 @@ const char *get_event_field_val( const trace_event_t &event, const char *name, c
         const event_field_t &field = event.fields[ i ];
 
         if ( !strcmp( field.key, name ) )
-            return field.value;
+            return event.get_field_val( i );
     }
 
     return defval;
@@ -353,7 +360,11 @@ event_field_t *get_event_field( trace_event_t &event, const char *name )
         event_field_t &field = event.fields[ i ];
 
         if ( !strcmp( field.key, name ) )
+        {
+            // Callers can read field.value directly, so render it now
+            event.get_field_val( i );
             return &field;
+        }
     }
 
     return NULL;
@@ -385,7 +396,16 @@ event_renderer_t::event_renderer_t( graph_info_t &gi, float y_in, float w_in, fl
 
         m_row_filters = gi.win.m_graph_row_filters.get_val( hashval );
         if ( m_row_filters && m_row_filters->filters.empty() )
+        {
             m_row_filters = NULL;
+        }
+        else if ( m_row_filters && m_row_filters->pending )
+        {
+            // Check on filters still being searched in the background
+            RowFilters rowfilters( gi.win.m_graph_row_filters, gi.prinfo_cur->row_name );
+
+            rowfilters.update_bitvec( gi.win.m_trace_events );
+        }
     }
 
     // Check if we're filtering specific pids
@@ -404,10 +424,8 @@ void event_renderer_t::set_y( float y_in, float h_in )
     }
 }
 
-void event_renderer_t::add_event( uint32_t eventid, float x, ImU32 color )
+void event_renderer_t::add_event_marker( uint32_t eventid, float x )
 {
-    m_num_events++;
-
     if ( ( eventid == m_gi.selected_eventid ) ||
          ( eventid == m_gi.hovered_eventid ) )
     {
@@ -419,6 +437,34 @@ void event_renderer_t::add_event( uint32_t eventid, float x, ImU32 color )
         m_markers.push_back( { ImVec2( x + width / 2, m_y + m_h / 2.0f ),
                                s_clrs().get( colidx ) } );
     }
+}
+
+void event_renderer_t::add_tile( float x0, float x1, uint32_t count, ImU32 color )
+{
+    m_num_events += count;
+
+    if ( ( m_x0 >= 0.0f ) && ( x0 - m_x1 <= 1.0f ) && ( m_event_color == color ) )
+    {
+        // Tile real close to current group with same color
+        m_x1 = std::max< float >( m_x1, x1 );
+        m_count += count;
+        return;
+    }
+
+    if ( m_x0 >= 0.0f )
+        draw();
+
+    // Start a new group with this tile
+    start( x0, color );
+    m_x1 = std::max< float >( m_x1, x1 );
+    m_count = count - 1;
+}
+
+void event_renderer_t::add_event( uint32_t eventid, float x, ImU32 color )
+{
+    m_num_events++;
+
+    add_event_marker( eventid, x );
 
     if ( m_x0 < 0.0f )
     {
@@ -480,19 +526,22 @@ void event_renderer_t::draw()
 }
 
 bool event_renderer_t::is_event_filtered( const trace_event_t &event )
+{
+    return is_event_filtered( event.id, event.pid );
+}
+
+bool event_renderer_t::is_event_filtered( uint32_t event_id, int pid )
 {
     bool filtered = false;
 
     if ( m_cpu_timeline_pids &&
-         ( m_cpu_timeline_pids->find( event.pid ) == m_cpu_timeline_pids->end() ) )
+         ( m_cpu_timeline_pids->find( pid ) == m_cpu_timeline_pids->end() ) )
     {
         // Check for globally filtered pids first...
         filtered = true;
     }
     else if ( m_row_filters && m_row_filters->bitvec )
     {
-        uint32_t event_id = event.id;
-
         if ( event_id >= m_row_filters->bitvec->size() )
             filtered = true;
         else
@@ -595,13 +644,14 @@ void graph_info_t::init_rows( const std::vector< GraphRows::graph_rows_info_t >
     for ( const GraphRows::graph_rows_info_t &grow : graph_rows )
     {
         row_info_t rinfo;
-        const std::vector< uint32_t > *plocs;
+        const IdList *plocs;
         const std::string &row_name = grow.row_name;
 
         if ( grow.hidden )
             continue;
 
-        plocs = win.m_trace_events.get_locs( grow.row_filter_expr.c_str(), &rinfo.row_type );
+        plocs = win.m_trace_events.get_locs( grow.row_filter_expr.c_str(), &rinfo.row_type,
+                                             NULL, &rinfo.progress );
 
         rinfo.row_y = total_graph_height;
         rinfo.row_h = text_h * 2;
@@ -790,7 +840,7 @@ void graph_info_t::init()
     {
         // Find the fence signaled event for this timeline
         uint64_t gfxcontext_hash = win.m_trace_events.get_event_gfxcontext_hash( events[ hovered_eventid ] );
-        const std::vector< uint32_t > *plocs = win.m_trace_events.get_gfxcontext_locs( gfxcontext_hash );
+        const IdList *plocs = win.m_trace_events.get_gfxcontext_locs( gfxcontext_hash );
 
         // Mark it as hovered so it'll have a selection rectangle
         hovered_fence_signaled = plocs->back();
@@ -923,12 +973,12 @@ void graph_info_t::set_selected_i915_ringctxseq( const trace_event_t &event )
 {
     if ( !i915.selected_seqno )
     {
-        const char *ctxstr = get_event_field_val( event, "ctx", "0" );
+        static event_field_slot_t s_ctx( "ctx" );
         uint32_t ringno = TraceLocationsRingCtxSeq::get_i915_ringno( event );
 
         i915.selected_seqno = event.seqno;
         i915.selected_ringno = ringno;
-        i915.selected_ctx = strtoul( ctxstr, NULL, 10 );
+        i915.selected_ctx = ( uint32_t )s_ctx.get_int( event );
     }
 }
 
@@ -936,8 +986,8 @@ bool graph_info_t::is_i915_ringctxseq_selected( const trace_event_t &event )
 {
     if ( i915.selected_seqno == event.seqno )
     {
-        const char *ctxstr = get_event_field_val( event, "ctx", "0" );
-        uint32_t ctx = strtoul( ctxstr, NULL, 10 );
+        static event_field_slot_t s_ctx( "ctx" );
+        uint32_t ctx = ( uint32_t )s_ctx.get_int( event );
         uint32_t ringno = TraceLocationsRingCtxSeq::get_i915_ringno( event );
 
         return ( ( i915.selected_ringno == ringno ) && ( i915.selected_ctx == ctx ) );
@@ -1028,7 +1078,9 @@ bool CreateGraphRowDlg::render_dlg( TraceEvents &trace_events )
         ImGui::SetTooltip( "%s", tooltip.c_str() );
     }
 
-    if ( !m_err_str.empty() )
+    if ( m_progress < 1.0f )
+        ImGui::Text( "Searching events %.0f%%...", 100.0f * m_progress );
+    else if ( !m_err_str.empty() )
         ImGui::TextColored( ImVec4( 1, 0, 0, 1), "%s", m_err_str.c_str() );
 
     if ( ImGui::CollapsingHeader( "Previous Filters", ImGuiTreeNodeFlags_DefaultOpen ) )
@@ -1064,10 +1116,11 @@ bool CreateGraphRowDlg::render_dlg( TraceEvents &trace_events )
 
     ImGui::PopStyleColor();
 
-    if ( do_create && !disabled )
+    // Keep checking each frame while a background search is running
+    if ( ( do_create || ( m_progress < 1.0f ) ) && !disabled )
     {
-        const std::vector< uint32_t > *plocs = trace_events.get_locs(
-                    m_filter_buf, NULL, &m_err_str );
+        const IdList *plocs = trace_events.get_locs(
+                    m_filter_buf, NULL, &m_err_str, &m_progress );
 
         ret = !!plocs;
 
@@ -1087,7 +1140,7 @@ bool CreateGraphRowDlg::render_dlg( TraceEvents &trace_events )
             if ( m_previous_filters.size() > 20 )
                 m_previous_filters.resize( 20 );
         }
-        else if ( m_err_str.empty() )
+        else if ( m_err_str.empty() && ( m_progress >= 1.0f ) )
         {
             m_err_str = "ERROR: No events found.";
         }
@@ -1095,7 +1148,15 @@ bool CreateGraphRowDlg::render_dlg( TraceEvents &trace_events )
 
     ImGui::SameLine();
     if ( ImGui::Button( "Cancel", button_size ) || s_actions().get( action_escape ) || ret )
+    {
+        if ( m_progress < 1.0f )
+        {
+            trace_events.tdopexpr_job_cancel( m_filter_buf );
+            m_progress = 1.0f;
+        }
+
         ImGui::CloseCurrentPopup();
+    }
 
     ImGui::EndPopup();
     return ret;
@@ -1168,7 +1229,9 @@ bool CreateRowFilterDlg::render_dlg( TraceEvents &trace_events )
         ImGui::SetTooltip( "%s", tooltip.c_str() );
     }
 
-    if ( !m_err_str.empty() )
+    if ( m_progress < 1.0f )
+        ImGui::Text( "Searching events %.0f%%...", 100.0f * m_progress );
+    else if ( !m_err_str.empty() )
         ImGui::TextColored( ImVec4( 1, 0, 0, 1), "%s", m_err_str.c_str() );
 
     if ( ImGui::CollapsingHeader( "Previous Filters", ImGuiTreeNodeFlags_DefaultOpen ) )
@@ -1204,10 +1267,11 @@ bool CreateRowFilterDlg::render_dlg( TraceEvents &trace_events )
 
     ImGui::PopStyleColor();
 
-    if ( do_create && !disabled )
+    // Keep checking each frame while a background search is running
+    if ( ( do_create || ( m_progress < 1.0f ) ) && !disabled )
     {
-        const std::vector< uint32_t > *plocs = trace_events.get_locs(
-                    m_filter_buf, NULL, &m_err_str );
+        const IdList *plocs = trace_events.get_locs(
+                    m_filter_buf, NULL, &m_err_str, &m_progress );
 
         ret = !!plocs;
 
@@ -1227,7 +1291,7 @@ bool CreateRowFilterDlg::render_dlg( TraceEvents &trace_events )
             if ( m_previous_filters.size() > 20 )
                 m_previous_filters.resize( 20 );
         }
-        else if ( m_err_str.empty() )
+        else if ( m_err_str.empty() && ( m_progress >= 1.0f ) )
         {
             m_err_str = "ERROR: No events found.";
         }
@@ -1235,7 +1299,15 @@ bool CreateRowFilterDlg::render_dlg( TraceEvents &trace_events )
 
     ImGui::SameLine();
     if ( ImGui::Button( "Cancel", button_size ) || s_actions().get( action_escape ) || ret )
+    {
+        if ( m_progress < 1.0f )
+        {
+            trace_events.tdopexpr_job_cancel( m_filter_buf );
+            m_progress = 1.0f;
+        }
+
         ImGui::CloseCurrentPopup();
+    }
 
     ImGui::EndPopup();
     return ret;
@@ -1274,21 +1346,30 @@ void RowFilters::toggle_filter( TraceEvents &trace_events, size_t idx, const std
         m_row_filters->filters.erase( m_row_filters->filters.begin() + idx );
     }
 
+    update_bitvec( trace_events );
+}
+
+void RowFilters::update_bitvec( TraceEvents &trace_events )
+{
     // Free old bitmask
     delete m_row_filters->bitvec;
     m_row_filters->bitvec = NULL;
+    m_row_filters->pending = false;
 
     // Create new bitmask of valid eventids
-    const std::vector< uint32_t > *plocs_smallest = NULL;
-    std::vector< const std::vector< uint32_t > * > locs;
+    const IdList *plocs_smallest = NULL;
+    std::vector< const IdList * > locs;
 
     // Go through all the filters
     for ( const std::string &filterstr : m_row_filters->filters )
     {
         // Get events for this filter
-        const std::vector< uint32_t > *plocs = trace_events.get_tdopexpr_locs( filterstr.c_str() );
+        float progress;
+        const IdList *plocs = trace_events.get_tdopexpr_locs( filterstr.c_str(), NULL, &progress );
 
-        if ( plocs )
+        if ( progress < 1.0f )
+            m_row_filters->pending = true;
+        else if ( plocs )
         {
             if ( !plocs_smallest || ( plocs->size() < plocs_smallest->size() ) )
                 plocs_smallest = plocs;
@@ -1297,21 +1378,25 @@ void RowFilters::toggle_filter( TraceEvents &trace_events, size_t idx, const std
         }
     }
 
-    if ( plocs_smallest )
+    if ( m_row_filters->pending )
+    {
+        // Hide the row's events until the filter searches finish
+        m_row_filters->bitvec = new BitVec( 1 );
+    }
+    else if ( plocs_smallest )
     {
         // Remove plocs_smallest from array of filter locs
         auto idx0 = std::find( locs.begin(), locs.end(), plocs_smallest );
         locs.erase( idx0 );
 
-        for ( auto it = plocs_smallest->rbegin(); it != plocs_smallest->rend(); it++ )
+        for ( uint32_t eventid : *plocs_smallest )
         {
-            uint32_t eventid = *it;
             bool set_in_all_filters = true;
 
             // Try to find this eventid in all the filters
-            for ( const std::vector< uint32_t > *plocs : locs )
+            for ( const IdList *plocs : locs )
             {
-                if ( !std::binary_search( plocs->begin(), plocs->end(), eventid ) )
+                if ( !plocs->contains( eventid ) )
                 {
                     set_in_all_filters = false;
                     break;
@@ -1321,7 +1406,7 @@ void RowFilters::toggle_filter( TraceEvents &trace_events, size_t idx, const std
             if ( set_in_all_filters )
             {
                 if ( !m_row_filters->bitvec )
-                    m_row_filters->bitvec = new BitVec( eventid + 1 );
+                    m_row_filters->bitvec = new BitVec( plocs_smallest->back() + 1 );
 
                 m_row_filters->bitvec->set( eventid );
             }
@@ -1345,7 +1430,15 @@ uint32_t TraceWin::graph_render_plot( graph_info_t &gi, GraphPlot &plot )
     if ( index1 == ( uint32_t)-1 )
         index1 = plot.m_plotdata.size();
 
-    points.reserve( index1 - index0 + 10 );
+    // If there are more samples than pixels, draw min/max lod buckets instead
+    int lod_level = plot.get_lod_level( index1 - index0, gi.rc.w );
+    size_t lod_span = ( lod_level >= 0 ) ? plot.get_lod_span( lod_level ) : 1;
+    uint32_t num_samples = 0;
+
+    if ( lod_level < 0 )
+        points.reserve( index1 - index0 + 10 );
+    else
+        plotPoints.reserve( 5 * ( ( index1 - index0 ) / lod_span + 2 ) );
 
     uint32_t idx0 = gi.prinfo_cur->plocs->front();
     ImU32 color_line = m_trace_events.m_events[ idx0 ].color ?
@@ -1353,43 +1446,93 @@ uint32_t TraceWin::graph_render_plot( graph_info_t &gi, GraphPlot &plot )
     ImU32 color_point = imgui_col_complement( color_line );
 
     float lastY = 0.0f;
-    for ( size_t idx = index0; idx < plot.m_plotdata.size(); idx++ )
+    if ( lod_level >= 0 )
     {
-        GraphPlot::plotdata_t &data = plot.m_plotdata[ idx ];
-        float x = gi.ts_to_screenx( data.ts );
-        float y = data.valf;
+        const std::vector< GraphPlot::plotlod_t > &lod = plot.m_lod[ lod_level ];
 
-        if ( x <= 0.0f )
+        for ( size_t idx = index0 / lod_span; idx < lod.size(); idx++ )
         {
-            minval = y;
-            maxval = y;
+            const GraphPlot::plotlod_t &bucket = lod[ idx ];
+            float x0 = gi.ts_to_screenx( bucket.ts0 );
+            float x1 = gi.ts_to_screenx( bucket.ts1 );
+            float xmid = 0.5f * ( x0 + x1 );
+
+            if ( x1 <= 0.0f )
+            {
+                minval = bucket.last;
+                maxval = bucket.last;
+            }
+            else
+            {
+                minval = std::min< float >( minval, bucket.minval );
+                maxval = std::max< float >( maxval, bucket.maxval );
+            }
+
+            if ( !plot.m_interpolation && !plotPoints.empty() )
+                plotPoints.push_back( ImVec2( x0, lastY ) );
+
+            plotPoints.push_back( ImVec2( x0, bucket.first ) );
+            plotPoints.push_back( ImVec2( xmid, bucket.minval ) );
+            plotPoints.push_back( ImVec2( xmid, bucket.maxval ) );
+            plotPoints.push_back( ImVec2( x1, bucket.last ) );
+
+            lastY = bucket.last;
+            num_samples += std::min< size_t >( lod_span, plot.m_plotdata.size() - idx * lod_span );
+
+            // Check if we're mouse hovering this bucket
+            if ( gi.mouse_over )
+                gi.add_mouse_hovered_event( x0, get_event( bucket.eventid ) );
+
+            if ( m_graph.mouse_over_row_type == LOC_TYPE_i915PerfFreq &&
+                 gi.mouse_pos_in_rect( { x0 - 5.0f, gi.mouse_pos.y - 5.0f, x1 - x0 + 10.0f, 10.0f } ) )
+                gi.set_i915_perf_frequency( bucket.last );
+
+            if ( x0 >= gi.rc.x + gi.rc.w )
+                break;
         }
+    }
+    else
+    {
+        for ( size_t idx = index0; idx < plot.m_plotdata.size(); idx++ )
+        {
+            GraphPlot::plotdata_t &data = plot.m_plotdata[ idx ];
+            float x = gi.ts_to_screenx( data.ts );
+            float y = data.valf;
 
-        points.push_back( ImVec2( x, y ) );
+            if ( x <= 0.0f )
+            {
+                minval = y;
+                maxval = y;
+            }
 
-        if ( !plot.m_interpolation && idx != index0 )
-            plotPoints.push_back( ImVec2( x, lastY ) );
+            points.push_back( ImVec2( x, y ) );
 
-        lastY = y;
+            if ( !plot.m_interpolation && idx != index0 )
+                plotPoints.push_back( ImVec2( x, lastY ) );
 
-        plotPoints.push_back( ImVec2( x, y ) );
+            lastY = y;
 
-        minval = std::min< float >( minval, y );
-        maxval = std::max< float >( maxval, y );
+            plotPoints.push_back( ImVec2( x, y ) );
 
-        // Check if we're mouse hovering this event
-        if ( gi.mouse_over )
-            gi.add_mouse_hovered_event( x, get_event( data.eventid ) );
+            minval = std::min< float >( minval, y );
+            maxval = std::max< float >( maxval, y );
 
-        if ( m_graph.mouse_over_row_type == LOC_TYPE_i915PerfFreq &&
-             gi.mouse_pos_in_rect( { x - 5.0f, gi.mouse_pos.y - 5.0f, 10.0f, 10.0f } ) )
-            gi.set_i915_perf_frequency( y );
+            // Check if we're mouse hovering this event
+            if ( gi.mouse_over )
+                gi.add_mouse_hovered_event( x, get_event( data.eventid ) );
 
-        if ( x >= gi.rc.x + gi.rc.w )
-            break;
+            if ( m_graph.mouse_over_row_type == LOC_TYPE_i915PerfFreq &&
+                 gi.mouse_pos_in_rect( { x - 5.0f, gi.mouse_pos.y - 5.0f, 10.0f, 10.0f } ) )
+                gi.set_i915_perf_frequency( y );
+
+            if ( x >= gi.rc.x + gi.rc.w )
+                break;
+        }
+
+        num_samples = points.size();
     }
 
-    if ( points.size() )
+    if ( num_samples )
     {
         bool closed = false;
         float thickness = 2.0f;
@@ -1413,6 +1556,7 @@ uint32_t TraceWin::graph_render_plot( graph_info_t &gi, GraphPlot &plot )
         ImGui::GetWindowDrawList()->AddPolyline( plotPoints.data(), plotPoints.size(),
                                                  color_line, closed, thickness );
 
+        // Sample points aren't drawn for lod buckets
         for ( const ImVec2 &pt : points )
         {
             imgui_drawrect_filled( pt.x - imgui_scale( 1.5f ), pt.y - imgui_scale( 1.5f ),
@@ -1421,7 +1565,7 @@ uint32_t TraceWin::graph_render_plot( graph_info_t &gi, GraphPlot &plot )
         }
     }
 
-    return points.size();
+    return num_samples;
 }
 
 uint32_t TraceWin::graph_render_row_plot( graph_info_t &gi )
@@ -1523,40 +1667,114 @@ void row_draw_info_t::set_event( graph_info_t &gi,
     m_event = event;
 }
 
-// Given an array of ftrace print event IDs, do a lower_bound binary search on
-//  m_ftrace.print_info ts values.
-// Note: locs is sorted by ts values in m_ftrace.print_info.
-uint32_t TraceEvents::ts_to_ftrace_print_info_idx( const std::vector< uint32_t > &locs, int64_t ts )
+void interval_index_t::clear()
 {
-    size_t first = 0;
-    size_t count = locs.size();
+    m_ts0.clear();
+    m_ts1.clear();
+    m_eventids.clear();
+    m_maxend.clear();
+    m_leaves = 0;
+    built = false;
+}
 
-    while ( count > 0 )
+void interval_index_t::add( uint32_t eventid, int64_t ts0, int64_t ts1 )
+{
+    m_ts0.push_back( std::min< int64_t >( ts0, ts1 ) );
+    m_ts1.push_back( std::max< int64_t >( ts0, ts1 ) );
+    m_eventids.push_back( eventid );
+}
+
+void interval_index_t::build( size_t size )
+{
+    std::vector< uint32_t > order( m_ts0.size() );
+
+    for ( uint32_t i = 0; i < order.size(); i++ )
+        order[ i ] = i;
+
+    std::stable_sort( order.begin(), order.end(),
+                      [this]( uint32_t a, uint32_t b ) { return m_ts0[ a ] < m_ts0[ b ]; } );
+
+    std::vector< int64_t > ts0( order.size() );
+    std::vector< uint32_t > eventids( order.size() );
+
+    m_leaves = 1;
+    while ( m_leaves < order.size() )
+        m_leaves *= 2;
+
+    // Leaves past the last interval never match
+    m_maxend.assign( 2 * m_leaves, INT64_MIN );
+
+    for ( size_t i = 0; i < order.size(); i++ )
     {
-        size_t step = count / 2;
-        size_t it = first + step;
-        const trace_event_t &event = m_events[ locs[ it ] ];
-        const print_info_t *print_info = get_print_info( event.id );
+        ts0[ i ] = m_ts0[ order[ i ] ];
+        eventids[ i ] = m_eventids[ order[ i ] ];
+        m_maxend[ m_leaves + i ] = m_ts1[ order[ i ] ];
+    }
 
-        //$ TODO mikesart
-        // This can happen when we have a "(print)" row based on filtered events and
-        //   some of those events aren't print_infos. For now we just give up and
-        //   start from the first entry.
-        if ( !print_info )
-            return 0;
+    for ( size_t node = m_leaves - 1; node > 0; node-- )
+        m_maxend[ node ] = std::max< int64_t >( m_maxend[ 2 * node ], m_maxend[ 2 * node + 1 ] );
 
-        if ( print_info->ts < ts )
-        {
-            first = ++it;
-            count -= step + 1;
-        }
-        else
+    m_ts0.swap( ts0 );
+    m_eventids.swap( eventids );
+    m_ts1.clear();
+    m_ts1.shrink_to_fit();
+
+    locs_size = size;
+    built = true;
+}
+
+enum interval_type_t
+{
+    Interval_Duration,  // [ ts - duration, ts ]
+    Interval_Print,     // [ print_info->ts, print_info->ts + duration ]
+    Interval_AmdHw,     // [ ts - duration, ts ] of fence_signaled events
+    Interval_AmdUser,   // [ amdgpu_cs_ioctl ts, fence_signaled ts ]
+    Interval_i915Req,   // [ ts - duration, ts ], or [ ts, ts ] without duration
+
+    // Types are or'd into the low bits of row locs pointers
+    Interval_Max = 8
+};
+
+// Get interval index for a graph row, (re)building it if row locs changed.
+//  get_interval( event, ts0, ts1 ) returns false for events without a bar.
+template < typename T >
+static const interval_index_t &get_row_intervals( util_umap< uint64_t, interval_index_t > &intervals,
+                                                  TraceEvents &trace_events,
+                                                  const IdList &locs,
+                                                  interval_type_t type, T get_interval )
+{
+    uint64_t key = ( uint64_t )( uintptr_t )&locs | type;
+    interval_index_t &index = intervals.m_map[ key ];
+
+    if ( !index.built || ( index.locs_size != locs.size() ) )
+    {
+        GPUVIS_TRACE_BLOCK( __func__ );
+
+        index.clear();
+
+        for ( uint32_t eventid : locs )
         {
-            count = step;
+            int64_t ts0;
+            int64_t ts1;
+
+            if ( get_interval( trace_events.m_events[ eventid ], ts0, ts1 ) )
+                index.add( eventid, ts0, ts1 );
         }
+
+        index.build( locs.size() );
     }
 
-    return first;
+    return index;
+}
+
+static bool get_duration_interval( const trace_event_t &event, int64_t &ts0, int64_t &ts1 )
+{
+    if ( !event.has_duration() )
+        return false;
+
+    ts0 = event.ts - event.duration;
+    ts1 = event.ts;
+    return true;
 }
 
 static uint32_t get_graph_row_id( const trace_event_t &event,
@@ -1602,8 +1820,8 @@ uint32_t TraceWin::graph_render_cpus_timeline( graph_info_t &gi )
     // Display sched_switch events.
     for ( const auto &cpu_locs : m_trace_events.m_sched_switch_cpu_locs.m_locs.m_map )
     {
-        const std::vector< uint32_t > &locs = cpu_locs.second;
-        uint32_t cpu = get_event( locs[ 0 ] ).cpu;
+        const IdList &locs = cpu_locs.second;
+        uint32_t cpu = get_event( locs.front() ).cpu;
         float y = gi.rc.y + cpu * row_h;
 
         // Skip row if it's above or below visible window
@@ -1614,24 +1832,23 @@ uint32_t TraceWin::graph_render_cpus_timeline( graph_info_t &gi )
 
         event_renderer_t event_renderer( gi, y + imgui_scale( 2.0f ), gi.rc.w, row_h - imgui_scale( 3.0f ) );
 
-        for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-              idx < locs.size();
-              idx++ )
+        // psci idle bars can overlap sched_switch bars, so go through the
+        //  interval index instead of bailing at the first bar past gi.ts1.
+        const interval_index_t &intervals = get_row_intervals( m_graph.intervals, m_trace_events,
+                locs, Interval_Duration, get_duration_interval );
+
+        intervals.find( gi.ts0, gi.ts1, [&]( uint32_t eventid )
         {
-            const trace_event_t &sched_switch = get_event( locs[ idx ] );
-            bool is_psci_exit = !strcmp( sched_switch.name, "psci_domain_idle_exit" );
+            const trace_event_t &sched_switch = get_event( eventid );
+            bool is_psci_exit = ( sched_switch.type == TRACE_EVENT_psci_domain_idle_exit );
             float x0 = gi.ts_to_screenx( sched_switch.ts - sched_switch.duration );
             float x1 = gi.ts_to_screenx( sched_switch.ts );
 
-            // Bail if we're off the right side of our graph
-            if ( x0 > gi.rc.x + gi.rc.w )
-                break;
-
             if ( hide_system_events && ( sched_switch.flags & TRACE_FLAG_SCHED_SWITCH_SYSTEM_EVENT ) )
-                continue;
+                return;
 
             if ( event_renderer.is_event_filtered( sched_switch ) )
-                continue;
+                return;
 
             count++;
             if ( ( x1 - x0 ) < imgui_scale( 3.0f ) )
@@ -1659,7 +1876,8 @@ uint32_t TraceWin::graph_render_cpus_timeline( graph_info_t &gi )
                 if ( visible_bg_and_text && !alt_down && ( x1 - x0 > text_size.x ) )
                 {
                     float y_text = y + ( row_h - text_size.y ) / 2 - imgui_scale( 1.0f );
-                    const char *prev_comm = get_event_field_val( sched_switch, "prev_comm" );
+                    static event_field_slot_t s_prev_comm( "prev_comm" );
+                    const char *prev_comm = s_prev_comm.get_val( sched_switch );
                     if ( is_psci_exit )
                         prev_comm = "psci-idle";
 
@@ -1685,7 +1903,7 @@ uint32_t TraceWin::graph_render_cpus_timeline( graph_info_t &gi )
                                     s_clrs().get( col_Graph_BarSelRect ) );
                 }
             }
-        }
+        } );
 
         event_renderer.done();
     }
@@ -1694,8 +1912,8 @@ uint32_t TraceWin::graph_render_cpus_timeline( graph_info_t &gi )
     for ( const auto &cpu_locs :
             m_trace_events.m_linux_perf_locs.m_locs.m_map )
     {
-        const std::vector< uint32_t > &locs = cpu_locs.second;
-        uint32_t cpu = get_event( locs[ 0 ] ).cpu;
+        const IdList &locs = cpu_locs.second;
+        uint32_t cpu = get_event( locs.front() ).cpu;
         float y = gi.rc.y + cpu * row_h;
 
         // Skip row if it's above or below visible window
@@ -1707,11 +1925,9 @@ uint32_t TraceWin::graph_render_cpus_timeline( graph_info_t &gi )
         event_renderer_t event_renderer( gi, y + imgui_scale( 2.0f ), gi.rc.w,
                 row_h - imgui_scale( 3.0f ) );
 
-        for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-              idx < locs.size();
-              idx++ )
+        for ( auto it = locs.lower_bound( gi.eventstart ); it != locs.end(); ++it )
         {
-            const trace_event_t &perf = get_event( locs[ idx ] );
+            const trace_event_t &perf = get_event( *it );
             float x0 = gi.ts_to_screenx( perf.ts - perf.duration );
             float x1 = gi.ts_to_screenx( perf.ts );
 
@@ -1809,32 +2025,37 @@ uint32_t TraceWin::graph_render_print_timeline( graph_info_t &gi )
     bool timeline_labels = s_opts().getb( OPT_PrintTimelineLabels ) &&
             !ImGui::GetIO().KeyAlt;
 
-    int64_t ts_duration_max = m_trace_events.m_ftrace.print_ts_max;
+    // Labels can start up to ts_text_max before the left edge and still be visible
     int64_t ts_text_max = timeline_labels ? gi.dx_to_ts( m_trace_events.m_ftrace.text_size_max ) : 0;
-    int64_t ts_offset = std::max< int64_t >( ts_duration_max, ts_text_max );
-    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    const IdList &locs = *gi.prinfo_cur->plocs;
+    const interval_index_t &intervals = get_row_intervals( m_graph.intervals, m_trace_events,
+            locs, Interval_Print,
+            [this]( const trace_event_t &event, int64_t &ts0, int64_t &ts1 )
+    {
+        const print_info_t *print_info = m_trace_events.get_print_info( event.id );
+
+        if ( !print_info )
+            return false;
+
+        ts0 = print_info->ts;
+        ts1 = print_info->ts + ( event.has_duration() ? event.duration : 0 );
+        return true;
+    } );
 
     uint32_t max_row_id = 1;
-    for ( size_t idx = m_trace_events.ts_to_ftrace_print_info_idx( locs, gi.ts0 - ts_offset );
-          idx < locs.size();
-          idx++ )
+    intervals.find( gi.ts0 - ts_text_max, gi.ts1, [&]( uint32_t eventid )
     {
         uint32_t row_id;
-        const trace_event_t &event = get_event( locs[ idx ] );
+        const trace_event_t &event = get_event( eventid );
         const print_info_t *print_info = m_trace_events.get_print_info( event.id );
 
-        if ( !print_info )
-            continue;
-
-        if ( print_info->ts > gi.ts1 )
-            break;
-        else if ( gi.graph_only_filtered && event.is_filtered_out )
-            continue;
+        if ( gi.graph_only_filtered && event.is_filtered_out )
+            return;
 
         row_id = get_graph_row_id( event, ftrace_row_info, print_info );
         if ( row_id != ( uint32_t )-1 )
             max_row_id = std::max< uint32_t >( max_row_id, row_id );
-    }
+    } );
 
     uint32_t row_count = std::min< uint32_t >( max_row_id + 1, ftrace_row_info->rows );
     std::vector< row_draw_info_t > row_draw_info( row_count );
@@ -1846,30 +2067,22 @@ uint32_t TraceWin::graph_render_print_timeline( graph_info_t &gi )
 
     event_renderer_t event_renderer( gi, gi.rc.y, gi.rc.w, gi.rc.h );
 
-    for ( size_t idx = m_trace_events.ts_to_ftrace_print_info_idx( locs, gi.ts0 - ts_offset );
-          idx < locs.size();
-          idx++ )
+    intervals.find( gi.ts0 - ts_text_max, gi.ts1, [&]( uint32_t eventid )
     {
         uint32_t row_id;
-        const trace_event_t &event = get_event( locs[ idx ] );
+        const trace_event_t &event = get_event( eventid );
         const print_info_t *print_info = m_trace_events.get_print_info( event.id );
-
-        if ( !print_info )
-            continue;
-
         int64_t event_start_ts = print_info->ts;
 
-        if ( event_start_ts > gi.ts1 )
-            break;
-        else if ( gi.graph_only_filtered && event.is_filtered_out )
-            continue;
+        if ( gi.graph_only_filtered && event.is_filtered_out )
+            return;
 
         if ( event_renderer.is_event_filtered( event ) )
-            continue;
+            return;
 
         row_id = get_graph_row_id( event, ftrace_row_info, print_info );
         if ( row_id == ( uint32_t )-1 )
-            continue;
+            return;
 
         float x = gi.ts_to_screenx( event_start_ts );
         float y = gi.rc.y + ( row_count - row_id - 1 ) * h + dy;
@@ -1925,7 +2138,7 @@ uint32_t TraceWin::graph_render_print_timeline( graph_info_t &gi )
                 gi.add_mouse_hovered_event( x1, event1, true );
             }
         }
-    }
+    } );
 
     if ( is_valid_id( hovinfo.eventid ) )
     {
@@ -1970,76 +2183,78 @@ uint32_t TraceWin::graph_render_amdhw_timeline( graph_info_t &gi )
     float y = gi.rc.y;
     ImU32 last_color = 0;
     bool draw_label = !ImGui::GetIO().KeyAlt;
-    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    const IdList &locs = *gi.prinfo_cur->plocs;
+    const interval_index_t &intervals = get_row_intervals( m_graph.intervals, m_trace_events,
+            locs, Interval_AmdHw,
+            []( const trace_event_t &event, int64_t &ts0, int64_t &ts1 )
+    {
+        if ( !event.is_fence_signaled() || !is_valid_id( event.id_start ) )
+            return false;
 
-    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-          idx < locs.size();
-          idx++ )
+        return get_duration_interval( event, ts0, ts1 );
+    } );
+
+    intervals.find( gi.ts0, gi.ts1, [&]( uint32_t eventid )
     {
-        const trace_event_t &fence_signaled = get_event( locs.at( idx ) );
+        const trace_event_t &fence_signaled = get_event( eventid );
+
+        float x0 = gi.ts_to_screenx( fence_signaled.ts - fence_signaled.duration );
+        float x1 = gi.ts_to_screenx( fence_signaled.ts );
 
-        if ( fence_signaled.is_fence_signaled() &&
-             is_valid_id( fence_signaled.id_start ) &&
-             ( fence_signaled.ts - fence_signaled.duration < gi.ts1 ) )
+        imgui_drawrect_filled( x0, y, x1 - x0, row_h, fence_signaled.color );
+
+        // Draw a label if we have room.
+        if ( draw_label )
         {
-            float x0 = gi.ts_to_screenx( fence_signaled.ts - fence_signaled.duration );
-            float x1 = gi.ts_to_screenx( fence_signaled.ts );
+            const char *label = fence_signaled.user_comm;
+            ImVec2 size = ImGui::CalcTextSize( label );
 
-            imgui_drawrect_filled( x0, y, x1 - x0, row_h, fence_signaled.color );
+            if ( size.x + imgui_scale( 4 ) >= x1 - x0 )
+            {
+                // No room for the comm, try just the pid.
+                label = strrchr( label, '-' );
+                if ( label )
+                    size = ImGui::CalcTextSize( ++label );
+            }
 
-            // Draw a label if we have room.
-            if ( draw_label )
+            if ( size.x + imgui_scale( 4 ) < x1 - x0 )
             {
-                const char *label = fence_signaled.user_comm;
-                ImVec2 size = ImGui::CalcTextSize( label );
+                ImU32 color = s_clrs().get( col_Graph_BarText );
+                const tgid_info_t *tgid_info = m_trace_events.tgid_from_commstr( fence_signaled.user_comm );
 
-                if ( size.x + imgui_scale( 4 ) >= x1 - x0 )
-                {
-                    // No room for the comm, try just the pid.
-                    label = strrchr( label, '-' );
-                    if ( label )
-                        size = ImGui::CalcTextSize( ++label );
-                }
+                imgui_draw_text( x0 + imgui_scale( 2.0f ), y + imgui_scale( 2.0f ),
+                                 color, label );
 
-                if ( size.x + imgui_scale( 4 ) < x1 - x0 )
+                if ( tgid_info )
                 {
-                    ImU32 color = s_clrs().get( col_Graph_BarText );
-                    const tgid_info_t *tgid_info = m_trace_events.tgid_from_commstr( fence_signaled.user_comm );
-
-                    imgui_draw_text( x0 + imgui_scale( 2.0f ), y + imgui_scale( 2.0f ),
-                                     color, label );
-
-                    if ( tgid_info )
-                    {
-                        imgui_push_cliprect( { x0, y, x1 - x0, row_h } );
+                    imgui_push_cliprect( { x0, y, x1 - x0, row_h } );
 
-                        imgui_draw_textf( x0 + imgui_scale( 2.0f ), y + size.y + imgui_scale( 2.0f ),
-                                     color, "(%s)", tgid_info->commstr );
+                    imgui_draw_textf( x0 + imgui_scale( 2.0f ), y + size.y + imgui_scale( 2.0f ),
+                                 color, "(%s)", tgid_info->commstr );
 
-                        imgui_pop_cliprect();
-                    }
+                    imgui_pop_cliprect();
                 }
             }
+        }
 
-            // If we drew the same color last time, draw a separator.
-            if ( last_color == fence_signaled.color )
-                imgui_drawrect_filled( x0, y, 1.0, row_h, col_event );
-            else
-                last_color = fence_signaled.color;
-
-            // Check if this fence_signaled is selected / hovered
-            if ( ( gi.hovered_fence_signaled == fence_signaled.id ) ||
-                 gi.mouse_pos_in_rect( { x0, y, x1 - x0, row_h } ) )
-            {
-                hov_rect = { x0, y, x1 - x0, row_h };
+        // If we drew the same color last time, draw a separator.
+        if ( last_color == fence_signaled.color )
+            imgui_drawrect_filled( x0, y, 1.0, row_h, col_event );
+        else
+            last_color = fence_signaled.color;
 
-                if ( !is_valid_id( gi.hovered_fence_signaled ) )
-                    gi.hovered_fence_signaled = fence_signaled.id;
-            }
+        // Check if this fence_signaled is selected / hovered
+        if ( ( gi.hovered_fence_signaled == fence_signaled.id ) ||
+             gi.mouse_pos_in_rect( { x0, y, x1 - x0, row_h } ) )
+        {
+            hov_rect = { x0, y, x1 - x0, row_h };
 
-            num_events++;
+            if ( !is_valid_id( gi.hovered_fence_signaled ) )
+                gi.hovered_fence_signaled = fence_signaled.id;
         }
-    }
+
+        num_events++;
+    } );
 
     imgui_drawrect( hov_rect, s_clrs().get( col_Graph_BarSelRect ) );
 
@@ -2059,7 +2274,7 @@ uint32_t TraceWin::graph_render_amd_timeline( graph_info_t &gi )
     ImU32 col_userspace = s_clrs().get( col_Graph_BarUserspace );
     ImU32 col_userspace_hovered = s_clrs().get( col_Graph_BarUserspaceHovered );
     ImU32 col_hwqueue = s_clrs().get( col_Graph_BarHwQueue );
-    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    const IdList &locs = *gi.prinfo_cur->plocs;
     bool render_timeline_events = s_opts().getb( OPT_TimelineEvents );
     bool render_timeline_labels = s_opts().getb( OPT_TimelineLabels ) &&
             !ImGui::GetIO().KeyAlt;
@@ -2068,23 +2283,28 @@ uint32_t TraceWin::graph_render_amd_timeline( graph_info_t &gi )
 
     event_renderer.m_maxwidth = 1.0f;
 
-    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-          idx < locs.size();
-          idx++ )
+    const interval_index_t &intervals = get_row_intervals( m_graph.intervals, m_trace_events,
+            locs, Interval_AmdUser,
+            [this]( const trace_event_t &fence_signaled, int64_t &ts0, int64_t &ts1 )
     {
-        const trace_event_t &fence_signaled = get_event( locs[ idx ] );
-
         if ( !fence_signaled.is_fence_signaled() || !is_valid_id( fence_signaled.id_start ) )
-            continue;
+            return false;
 
         const trace_event_t &sched_run_job = get_event( fence_signaled.id_start );
         const trace_event_t &cs_ioctl = is_valid_id( sched_run_job.id_start ) ?
                     get_event( sched_run_job.id_start ) : sched_run_job;
 
-        //$ TODO mikesart: can we bail out of this loop at some point if
-        //  our start times for all the graphs are > gi.ts1?
-        if ( cs_ioctl.ts >= gi.ts1 )
-            continue;
+        ts0 = cs_ioctl.ts;
+        ts1 = fence_signaled.ts;
+        return true;
+    } );
+
+    intervals.find( gi.ts0, gi.ts1, [&]( uint32_t eventid )
+    {
+        const trace_event_t &fence_signaled = get_event( eventid );
+        const trace_event_t &sched_run_job = get_event( fence_signaled.id_start );
+        const trace_event_t &cs_ioctl = is_valid_id( sched_run_job.id_start ) ?
+                    get_event( sched_run_job.id_start ) : sched_run_job;
 
         bool hovered = false;
         float y = gi.rc.y + ( fence_signaled.graph_row_id % timeline_row_count ) * gi.text_h;
@@ -2191,7 +2411,7 @@ uint32_t TraceWin::graph_render_amd_timeline( graph_info_t &gi )
         }
 
         num_events++;
-    }
+    } );
 
     event_renderer.done();
     event_renderer.draw_event_markers();
@@ -2203,39 +2423,225 @@ uint32_t TraceWin::graph_render_amd_timeline( graph_info_t &gi )
     return num_events;
 }
 
+// Width of level 0 event tiles is 1 << s_tile_shift0 ns, each level above is 4x wider
+static const uint32_t s_tile_shift0 = 10;
+
+// Frames a row's event tiles are kept around after it was last drawn from them
+static const int s_event_tiles_max_age = 300;
+
+// Most events looked at when hovering zoomed out rows
+static const uint32_t s_tile_hover_max = 4096;
+
+static void build_event_tiles( event_tiles_t &tiles, const TraceEvents &trace_events,
+                               const IdList &locs, bool hide_sched_switch )
+{
+    std::vector< event_tile_t > level;
+    int64_t key = INT64_MIN;
+
+    tiles.levels.clear();
+    tiles.locs_size = locs.size();
+    tiles.colors_gen = trace_events.m_event_colors_gen;
+
+    for ( auto it = locs.begin(); it != locs.end(); ++it )
+    {
+        uint32_t i = ( uint32_t )it.index();
+        const trace_event_t &event = trace_events.m_events[ *it ];
+
+        if ( hide_sched_switch && event.is_sched_switch() )
+            continue;
+
+        if ( level.empty() || ( ( event.ts >> s_tile_shift0 ) != key ) )
+        {
+            key = event.ts >> s_tile_shift0;
+            level.push_back( { event.ts, event.ts, i, i + 1, 1, event.color } );
+        }
+        else
+        {
+            event_tile_t &tile = level.back();
+
+            tile.ts1 = event.ts;
+            tile.locs1 = i + 1;
+            tile.count++;
+            tile.color = event.color;
+        }
+    }
+
+    tiles.levels.push_back( std::move( level ) );
+
+    // Merge groups of 4 buckets until we're down to a single tile
+    for ( uint32_t shift = s_tile_shift0 + 2;
+          ( tiles.levels.back().size() > 1 ) && ( shift < 62 );
+          shift += 2 )
+    {
+        std::vector< event_tile_t > above;
+
+        for ( const event_tile_t &tile : tiles.levels.back() )
+        {
+            if ( above.empty() || ( ( above.back().ts0 >> shift ) != ( tile.ts0 >> shift ) ) )
+            {
+                above.push_back( tile );
+            }
+            else
+            {
+                event_tile_t &merged = above.back();
+
+                merged.ts1 = tile.ts1;
+                merged.locs1 = tile.locs1;
+                merged.count += tile.count;
+                merged.color = tile.color;
+            }
+        }
+
+        tiles.levels.push_back( std::move( above ) );
+    }
+}
+
+bool TraceWin::graph_render_row_event_tiles( graph_info_t &gi, event_renderer_t &event_renderer,
+                                             bool hide_sched_switch )
+{
+    const IdList &locs = *gi.prinfo_cur->plocs;
+
+    // Tiles don't know about per event filters
+    if ( gi.graph_only_filtered ||
+         event_renderer.m_row_filters ||
+         event_renderer.m_cpu_timeline_pids )
+    {
+        return false;
+    }
+
+    // Draw events one at a time unless there are a lot more events than pixels
+    size_t idx0 = vec_find_eventid( locs, gi.eventstart );
+    size_t idx1 = vec_find_eventid( locs, gi.eventend );
+    double pixel_ts = gi.tsdx / std::max< double >( 1.0, gi.rc.w );
+
+    if ( ( idx1 - idx0 < 4 * gi.rc.w ) || ( pixel_ts < ( 1 << s_tile_shift0 ) ) )
+        return false;
+
+    uint64_t key = ( uint64_t )( uintptr_t )&locs | hide_sched_switch;
+    event_tiles_t &tiles = m_graph.event_tiles.m_map[ key ];
+
+    if ( tiles.levels.empty() ||
+         ( tiles.locs_size != locs.size() ) ||
+         ( tiles.colors_gen != m_trace_events.m_event_colors_gen ) )
+    {
+        build_event_tiles( tiles, m_trace_events, locs, hide_sched_switch );
+    }
+    tiles.last_frame = ImGui::GetFrameCount();
+
+    // Use widest tiles that still fit in a pixel
+    size_t level = 0;
+    while ( ( level + 1 < tiles.levels.size() ) &&
+            ( ( int64_t )1 << ( s_tile_shift0 + 2 * ( level + 1 ) ) ) <= pixel_ts )
+    {
+        level++;
+    }
+
+    const std::vector< event_tile_t > &level_tiles = tiles.levels[ level ];
+    auto it = std::lower_bound( level_tiles.begin(), level_tiles.end(), gi.ts0,
+                                []( const event_tile_t &tile, int64_t ts ) { return tile.ts1 < ts; } );
+
+    for ( ; it != level_tiles.end(); it++ )
+    {
+        const event_tile_t &tile = *it;
+
+        if ( tile.ts0 > gi.ts1 )
+            break;
+
+        float x0 = gi.ts_to_screenx( tile.ts0 );
+        float x1 = gi.ts_to_screenx( tile.ts1 );
+
+        event_renderer.add_tile( x0, x1, tile.count, tile.color );
+    }
+
+    // Check if we're mouse hovering events. Tiles can hold thousands of events
+    //  per pixel, so only look up the ones right around the mouse.
+    if ( gi.mouse_over )
+    {
+        float hover_dx = imgui_scale( 8.0f );
+        int64_t hover_ts0 = gi.screenx_to_ts( gi.mouse_pos.x - hover_dx );
+        int64_t hover_ts1 = gi.screenx_to_ts( gi.mouse_pos.x + hover_dx );
+        uint32_t count = 0;
+
+        for ( auto lit = locs.lower_bound( ts_to_eventid( hover_ts0 ) );
+              ( lit != locs.end() ) && ( count < s_tile_hover_max ); ++lit )
+        {
+            const trace_event_t &event = get_event( *lit );
+
+            if ( event.ts > hover_ts1 )
+                break;
+            if ( hide_sched_switch && event.is_sched_switch() )
+                continue;
+
+            gi.add_mouse_hovered_event( gi.ts_to_screenx( event.ts ), event );
+            count++;
+        }
+    }
+
+    // Selected and hovered event markers
+    uint32_t marker_ids[ 2 ] = { gi.selected_eventid, gi.hovered_eventid };
+
+    for ( size_t i = 0; i < ARRAY_SIZE( marker_ids ); i++ )
+    {
+        uint32_t eventid = marker_ids[ i ];
+
+        if ( ( eventid < gi.eventstart ) || ( eventid > gi.eventend ) ||
+             ( i && ( eventid == marker_ids[ 0 ] ) ) ||
+             !locs.contains( eventid ) )
+        {
+            continue;
+        }
+
+        const trace_event_t &event = get_event( eventid );
+
+        if ( !hide_sched_switch || !event.is_sched_switch() )
+            event_renderer.add_event_marker( eventid, gi.ts_to_screenx( event.ts ) );
+    }
+
+    return true;
+}
+
 uint32_t TraceWin::graph_render_row_events( graph_info_t &gi )
 {
     if ( strstr( gi.prinfo_cur->row_name.c_str(), "(print)" ) )
         return graph_render_print_timeline( gi );
 
-    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    const IdList &locs = *gi.prinfo_cur->plocs;
     event_renderer_t event_renderer( gi, gi.rc.y + 4, gi.rc.w, gi.rc.h - 8 );
     bool hide_sched_switch = s_opts().getb( OPT_HideSchedSwitchEvents );
+    const int64_t *events_ts = m_trace_events.m_events_ts.data();
+    const uint32_t *events_flags = m_trace_events.m_events_flags.data();
+    const int *events_pid = m_trace_events.m_events_pid.data();
+    const int64_t *events_duration = m_trace_events.m_events_duration.data();
 
-    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-          idx < locs.size();
-          idx++ )
+    // Draw from event tiles when zoomed way out, otherwise event by event.
+    //  Skipped events are checked with the packed columns, so only drawn
+    //  events touch trace_event_t (for their color).
+    if ( !graph_render_row_event_tiles( gi, event_renderer, hide_sched_switch ) )
     {
-        uint32_t eventid = locs[ idx ];
-        const trace_event_t &event = get_event( eventid );
+        for ( auto it = locs.lower_bound( gi.eventstart ); it != locs.end(); ++it )
+        {
+            uint32_t eventid = *it;
 
-        if ( eventid > gi.eventend )
-            break;
-        else if ( gi.graph_only_filtered && event.is_filtered_out )
-            continue;
-        else if ( hide_sched_switch && event.is_sched_switch() )
-            continue;
+            if ( eventid > gi.eventend )
+                break;
+            else if ( hide_sched_switch && ( events_flags[ eventid ] & TRACE_FLAG_SCHED_SWITCH ) )
+                continue;
+            else if ( event_renderer.is_event_filtered( eventid, events_pid[ eventid ] ) )
+                continue;
 
-        if ( event_renderer.is_event_filtered( event ) )
-            continue;
+            const trace_event_t &event = get_event( eventid );
 
-        float x = gi.ts_to_screenx( event.ts );
+            if ( gi.graph_only_filtered && event.is_filtered_out )
+                continue;
 
-        // Check if we're mouse hovering this event
-        if ( gi.mouse_over )
-            gi.add_mouse_hovered_event( x, event );
+            float x = gi.ts_to_screenx( events_ts[ eventid ] );
 
-        event_renderer.add_event( event.id, x, event.color );
+            // Check if we're mouse hovering this event
+            if ( gi.mouse_over )
+                gi.add_mouse_hovered_event( x, event );
+
+            event_renderer.add_event( eventid, x, event.color );
+        }
     }
 
     event_renderer.done();
@@ -2244,7 +2650,7 @@ uint32_t TraceWin::graph_render_row_events( graph_info_t &gi )
     if ( gi.prinfo_cur->pid >= 0 )
     {
         // Grab all the sched_switch events that have our comm listed as prev_comm
-        const std::vector< uint32_t > *plocs = m_trace_events.get_sched_switch_locs(
+        const IdList *plocs = m_trace_events.get_sched_switch_locs(
                     gi.prinfo_cur->pid, TraceEvents::SCHED_SWITCH_PREV );
 
         if ( plocs )
@@ -2256,20 +2662,19 @@ uint32_t TraceWin::graph_render_row_events( graph_info_t &gi )
             };
             bool sched_switch_bars_empty = gi.sched_switch_bars.empty();
 
-            for ( size_t idx = vec_find_eventid( *plocs, gi.eventstart );
-                  idx < plocs->size();
-                  idx++ )
+            for ( auto it = plocs->lower_bound( gi.eventstart ); it != plocs->end(); ++it )
             {
-                const trace_event_t &sched_switch = get_event( plocs->at( idx ) );
+                uint32_t id = *it;
+                int64_t duration = events_duration[ id ];
 
-                if ( sched_switch.has_duration() )
+                if ( duration != INT64_MAX )
                 {
                     float row_h = gi.text_h;
                     float y = gi.rc.y + ( gi.rc.h - row_h ) / 2;
                     bool drawrect = false;
-                    float x0 = gi.ts_to_screenx( sched_switch.ts - sched_switch.duration );
-                    float x1 = gi.ts_to_screenx( sched_switch.ts );
-                    int running = !!( sched_switch.flags & TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING );
+                    float x0 = gi.ts_to_screenx( events_ts[ id ] - duration );
+                    float x1 = gi.ts_to_screenx( events_ts[ id ] );
+                    int running = !!( events_flags[ id ] & TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING );
 
                     // Bail if we're off the right side of our graph
                     if ( x0 > gi.rc.x + gi.rc.w )
@@ -2280,9 +2685,9 @@ uint32_t TraceWin::graph_render_row_events( graph_info_t &gi )
                     if ( gi.mouse_pos_in_rect( { x0, y, x1 - x0, row_h } ) )
                     {
                         drawrect = true;
-                        gi.sched_switch_bars.push_back( sched_switch.id );
+                        gi.sched_switch_bars.push_back( id );
                     }
-                    else if ( !sched_switch_bars_empty && ( gi.sched_switch_bars[ 0 ] == sched_switch.id ) )
+                    else if ( !sched_switch_bars_empty && ( gi.sched_switch_bars[ 0 ] == id ) )
                     {
                         drawrect = true;
                     }
@@ -2300,7 +2705,7 @@ uint32_t TraceWin::graph_render_row_events( graph_info_t &gi )
 uint32_t TraceWin::graph_render_i915_reqwait_events( graph_info_t &gi )
 {
     const trace_event_t *pevent_sel = NULL;
-    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    const IdList &locs = *gi.prinfo_cur->plocs;
     event_renderer_t event_renderer( gi, gi.rc.y + 4, gi.rc.w, gi.rc.h - 8 );
     ImU32 barcolor = s_clrs().get( col_Graph_Bari915ReqWait );
     ImU32 textcolor = s_clrs().get( col_Graph_BarText );
@@ -2319,22 +2724,20 @@ uint32_t TraceWin::graph_render_i915_reqwait_events( graph_info_t &gi )
         timeline_labels = false;
 #endif
 
-    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-          idx < locs.size();
-          idx++ )
+    const interval_index_t &intervals = get_row_intervals( m_graph.intervals, m_trace_events,
+            locs, Interval_Duration, get_duration_interval );
+
+    intervals.find( gi.ts0, gi.ts1, [&]( uint32_t eventid )
     {
         float y;
         bool do_selrect = false;
-        const trace_event_t &event = get_event( locs[ idx ] );
+        const trace_event_t &event = get_event( eventid );
         const trace_event_t &event_begin = get_event( event.id_start );
         float x0 = gi.ts_to_screenx( event_begin.ts );
         float x1 = gi.ts_to_screenx( event.ts );
 
-        if ( ( x0 > gi.rc.x + gi.rc.w ) || ( x1 < gi.rc.x ) )
-            continue;
-
         if ( event_renderer.is_event_filtered( event ) )
-            continue;
+            return;
 
         y = gi.rc.y + ( event.graph_row_id % row_count ) * row_h;
 
@@ -2347,8 +2750,9 @@ uint32_t TraceWin::graph_render_i915_reqwait_events( graph_info_t &gi )
 
         if ( timeline_labels && ( x1 - x0 >= imgui_scale( 16.0f ) ) )
         {
+            static event_field_slot_t s_ctx( "ctx" );
             const char *label = "";
-            const char *ctxstr = get_event_field_val( event, "ctx", "0" );
+            const char *ctxstr = s_ctx.get_val( event, "0" );
             float ty = y + ( row_h / 2.0f ) - ( gi.text_h / 2.0f ) - imgui_scale( 2.0f );
 
             // Find the i915_request_queue event for this ring/ctx/seqno
@@ -2397,7 +2801,7 @@ uint32_t TraceWin::graph_render_i915_reqwait_events( graph_info_t &gi )
 
             imgui_drawrect( x0, y, x1 - x0, row_h, s_clrs().get( col_Graph_BarSelRect ) );
         }
-    }
+    } );
 
     event_renderer.done();
     event_renderer.draw_event_markers();
@@ -2411,7 +2815,7 @@ uint32_t TraceWin::graph_render_i915_reqwait_events( graph_info_t &gi )
 uint32_t TraceWin::graph_render_i915_req_events( graph_info_t &gi )
 {
     ImU32 textcolor = s_clrs().get( col_Graph_BarText );
-    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    const IdList &locs = *gi.prinfo_cur->plocs;
     event_renderer_t event_renderer( gi, gi.rc.y, gi.rc.w, gi.rc.h );
 
     uint64_t hashval = hashstr64( gi.prinfo_cur->row_name );
@@ -2439,21 +2843,26 @@ uint32_t TraceWin::graph_render_i915_req_events( graph_info_t &gi )
     };
     util_umap< uint64_t, barinfo_t > rendered_bars;
 
-    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-          idx < locs.size();
-          idx++ )
+    // Events without a duration are drawn as ticks, so index those as [ ts, ts ]
+    const interval_index_t &intervals = get_row_intervals( m_graph.intervals, m_trace_events,
+            locs, Interval_i915Req,
+            []( const trace_event_t &event, int64_t &ts0, int64_t &ts1 )
+    {
+        if ( !get_duration_interval( event, ts0, ts1 ) )
+            ts0 = ts1 = event.ts;
+        return true;
+    } );
+
+    intervals.find( gi.ts0, gi.ts1, [&]( uint32_t eventid )
     {
         float y;
-        const trace_event_t &event = get_event( locs[ idx ] );
+        const trace_event_t &event = get_event( eventid );
         bool has_duration = event.has_duration();
         float x1 = gi.ts_to_screenx( event.ts );
         float x0 = has_duration ? gi.ts_to_screenx( event.ts - event.duration ) : x1;
 
-        if ( ( x0 > gi.rc.x + gi.rc.w ) || ( x1 < gi.rc.x ) )
-            continue;
-
         if ( event_renderer.is_event_filtered( event ) )
-            continue;
+            return;
 
         y = gi.rc.y + event.graph_row_id * row_h;
 
@@ -2466,7 +2875,7 @@ uint32_t TraceWin::graph_render_i915_req_events( graph_info_t &gi )
         if ( has_duration )
         {
             const trace_event_t &event0 = get_event( event.id_start );
-            const trace_event_t *pevent = !strcmp( event.name, "intel_engine_notify" ) ?
+            const trace_event_t *pevent = ( event.type == TRACE_EVENT_intel_engine_notify ) ?
                         &event0 : &event;
 
             // Draw bar
@@ -2476,8 +2885,8 @@ uint32_t TraceWin::graph_render_i915_req_events( graph_info_t &gi )
                 gi.set_selected_i915_ringctxseq( *pevent );
 
             // Add bar information: ctx, seqno, and size
-            const char *ctxstr = get_event_field_val( *pevent, "ctx", "0" );
-            uint64_t ctx = strtoull( ctxstr, NULL, 10 );
+            static event_field_slot_t s_ctx( "ctx" );
+            uint64_t ctx = ( uint64_t )s_ctx.get_int( *pevent );
             uint64_t key = ( ctx << 32 ) | pevent->seqno;
             barinfo_t *barinfo = rendered_bars.get_val( key );
 
@@ -2486,7 +2895,7 @@ uint32_t TraceWin::graph_render_i915_req_events( graph_info_t &gi )
             else
                 barinfo->x1 = x1;
         }
-    }
+    } );
 
     for ( const auto &bar : rendered_bars.m_map )
     {
@@ -2571,16 +2980,14 @@ uint32_t TraceWin::graph_render_i915_req_events( graph_info_t &gi )
 uint32_t TraceWin::graph_render_i915_perf_events( graph_info_t &gi )
 {
     ImU32 textcolor = s_clrs().get( col_Graph_BarText );
-    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    const IdList &locs = *gi.prinfo_cur->plocs;
     float row_h = gi.rc.h / 2;
     event_renderer_t event_renderer( gi, gi.rc.y + row_h, gi.rc.w, row_h );
     uint32_t count = 0;
 
-    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
-          idx < locs.size();
-          idx++ )
+    for ( auto it = locs.lower_bound( gi.eventstart ); it != locs.end(); ++it )
     {
-        uint32_t eventid = locs[ idx ];
+        uint32_t eventid = *it;
         const trace_event_t &_event = get_event( eventid );
         if ( !_event.has_duration() )
         {
@@ -2748,17 +3155,15 @@ void TraceWin::graph_render_time_ticks( graph_info_t &gi, float h0, float h1 )
     }
 }
 
-static float get_vblank_xdiffs( TraceWin &win, graph_info_t &gi, const std::vector< uint32_t > *vblank_locs )
+static float get_vblank_xdiffs( TraceWin &win, graph_info_t &gi, const IdList *vblank_locs )
 {
     float xdiff = 0.0f;
     float xlast = 0.0f;
     uint32_t count = 0;
 
-    for ( size_t idx = vec_find_eventid( *vblank_locs, gi.eventstart );
-          idx < vblank_locs->size();
-          idx++ )
+    for ( auto it = vblank_locs->lower_bound( gi.eventstart ); it != vblank_locs->end(); ++it )
     {
-        uint32_t id = vblank_locs->at( idx );
+        uint32_t id = *it;
         trace_event_t &event = win.get_event( id );
 
         if ( s_opts().getcrtc( event.crtc ) )
@@ -2780,7 +3185,9 @@ static float get_vblank_xdiffs( TraceWin &win, graph_info_t &gi, const std::vect
 void TraceWin::graph_render_vblanks( graph_info_t &gi )
 {
     // Draw vblank events on every graph.
-    const std::vector< uint32_t > *vblank_locs = m_trace_events.get_tdopexpr_locs( "$name=drm_vblank_event" );
+    // Traces without vblanks get searched once in the background instead of stalling the frame
+    float progress;
+    const IdList *vblank_locs = m_trace_events.get_tdopexpr_locs( "$name=drm_vblank_event", NULL, &progress );
 
     if ( vblank_locs )
     {
@@ -2795,11 +3202,9 @@ void TraceWin::graph_render_vblanks( graph_info_t &gi )
         float xdiff = get_vblank_xdiffs( *this, gi, vblank_locs ) / imgui_scale( 1.0f );
         uint32_t alpha = std::min< uint32_t >( 255, 50 + 2 * xdiff );
 
-        for ( size_t idx = vec_find_eventid( *vblank_locs, gi.eventstart );
-              idx < vblank_locs->size();
-              idx++ )
+        for ( auto it = vblank_locs->lower_bound( gi.eventstart ); it != vblank_locs->end(); ++it )
         {
-            uint32_t id = vblank_locs->at( idx );
+            uint32_t id = *it;
 
             if ( id > gi.eventend )
                 break;
@@ -3017,6 +3422,11 @@ static void render_row_label( float x, float y, row_info_t &ri )
         label = string_format( "%u event%s", ri.num_events, suffix );
         imgui_draw_text( x, y, color, label.c_str(), true );
     }
+    else if ( ri.progress < 1.0f )
+    {
+        label = string_format( "searching events %.0f%%...", 100.0f * ri.progress );
+        imgui_draw_text( x, y, color, label.c_str(), true );
+    }
 }
 
 void TraceWin::graph_render_row_labels( graph_info_t &gi )
@@ -3536,6 +3946,23 @@ void TraceWin::graph_render()
 
     graph_info_t gi( *this );
 
+    // Drop row caches built before events were reloaded
+    if ( m_graph.init_gen != m_trace_events.m_init_gen )
+    {
+        m_graph.event_tiles.m_map.clear();
+        m_graph.intervals.m_map.clear();
+        m_graph.init_gen = m_trace_events.m_init_gen;
+    }
+
+    // Free event tiles of rows that are hidden, scrolled away, or zoomed in
+    for ( auto it = m_graph.event_tiles.m_map.begin(); it != m_graph.event_tiles.m_map.end(); )
+    {
+        if ( ImGui::GetFrameCount() - it->second.last_frame > s_event_tiles_max_age )
+            it = m_graph.event_tiles.m_map.erase( it );
+        else
+            it++;
+    }
+
     // Initialize our row size, location, etc information based on our graph row list
     gi.init_rows( m_graph.rows.m_graph_rows_list );
 
@@ -4303,7 +4730,8 @@ void TraceWin::graph_mouse_tooltip_rowinfo( std::string &ttip, graph_info_t &gi,
 
 void TraceWin::graph_mouse_tooltip_vblanks( std::string &ttip, graph_info_t &gi, int64_t mouse_ts )
 {
-    const std::vector< uint32_t > *vblank_locs = m_trace_events.get_tdopexpr_locs( "$name=drm_vblank_event" );
+    float progress;
+    const IdList *vblank_locs = m_trace_events.get_tdopexpr_locs( "$name=drm_vblank_event", NULL, &progress );
 
     if ( vblank_locs )
     {
@@ -4315,7 +4743,7 @@ void TraceWin::graph_mouse_tooltip_vblanks( std::string &ttip, graph_info_t &gi,
 
         for ( idx = ( idx > 10 ) ? ( idx - 10 ) : 0; idx < idxmax; idx++ )
         {
-            trace_event_t &event = get_event( vblank_locs->at( idx ) );
+            trace_event_t &event = get_event( ( *vblank_locs )[ idx ] );
 
             if ( s_opts().getcrtc( event.crtc ) )
             {
@@ -4370,7 +4798,8 @@ void TraceWin::graph_mouse_tooltip_sched_switch( std::string &ttip, graph_info_t
         if ( prev_comm )
         {
             int prev_pid = event.pid;
-            int prev_state = atoi( get_event_field_val( event, "prev_state" ) );
+            static event_field_slot_t s_prev_state( "prev_state" );
+            int prev_state = ( int )s_prev_state.get_int( event );
             int task_state = prev_state & ( TASK_REPORT_MAX - 1 );
             const std::string task_state_str = task_state_to_str( task_state );
             std::string timestr = ts_to_timestr( event.duration, 4 );
@@ -4423,7 +4852,7 @@ void TraceWin::graph_mouse_tooltip_hovered_amd_fence_signaled( std::string &ttip
 
     const trace_event_t &event_hov = get_event( gi.hovered_fence_signaled );
     uint64_t gfxcontext_hash = m_trace_events.get_event_gfxcontext_hash( event_hov );
-    const std::vector< uint32_t > *plocs = m_trace_events.get_gfxcontext_locs( gfxcontext_hash );
+    const IdList *plocs = m_trace_events.get_gfxcontext_locs( gfxcontext_hash );
 
     ttip += string_format( "\n\n%s",
                                m_trace_events.tgidcomm_from_commstr( event_hov.user_comm ) );
@@ -4502,10 +4931,10 @@ void TraceWin::graph_mouse_tooltip_hovered_items( std::string &ttip, graph_info_
         if ( !event.is_ftrace_print() )
             ttip += std::string( " " ) + event.name;
 
-        if ( !did_show_backtrace && event.backtrace.size() > 0 )
+        if ( !did_show_backtrace && is_valid_id( event.backtrace_id ) )
         {
             ttip += "\n\nCPU stack trace:";
-            for ( const char *&bt : event.backtrace )
+            for ( const char *bt : m_trace_events.m_backtraces[ event.backtrace_id ] )
                 ttip += string_format("\n\t%s", bt);
             ttip += "\n\n";
             did_show_backtrace = true;
@@ -258,7 +258,7 @@ void GraphRows::init( TraceEvents &trace_events )
 
     // Order: gfx -> compute -> gfx hw -> compute hw -> sdma -> sdma hw
     loc_type_t type;
-    const std::vector< uint32_t > *plocs;
+    const IdList *plocs;
 
     // AMD gpu events
     {
@@ -490,7 +490,7 @@ void GraphRows::init( TraceEvents &trace_events )
 
         for ( auto &req_locs : trace_events.m_i915.req_locs.m_locs.m_map )
         {
-            std::vector< uint32_t > &locs = req_locs.second;
+            const IdList &locs = req_locs.second;
             const char *name = trace_events.m_strpool.findstr( req_locs.first );
 
             push_row( name, LOC_TYPE_i915Request, locs.size() );
@@ -498,7 +498,7 @@ void GraphRows::init( TraceEvents &trace_events )
 
         for ( auto &req_locs : trace_events.m_i915.reqwait_end_locs.m_locs.m_map )
         {
-            std::vector< uint32_t > &locs = req_locs.second;
+            const IdList &locs = req_locs.second;
             const char *name = trace_events.m_strpool.findstr( req_locs.first );
 
             push_row( name, LOC_TYPE_i915RequestWait, locs.size() );
@@ -715,7 +715,7 @@ void GraphRows::add_row( const std::string &name_in, const std::string &filter_e
 {
     loc_type_t type;
     std::string name = name_in;
-    const std::vector< uint32_t > *plocs = m_trace_events->get_locs( filter_expr.c_str(), &type );
+    const IdList *plocs = m_trace_events->get_locs( filter_expr.c_str(), &type );
     size_t event_count = plocs ? plocs->size() : 0;
 
     if ( type == LOC_TYPE_Tdopexpr )
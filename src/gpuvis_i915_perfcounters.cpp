@@ -347,7 +347,7 @@ I915PerfCounters::get_process( const trace_event_t &i915_perf_event )
         process.event = req_event;
 
 
-        const std::vector< uint32_t > *sched_plocs =
+        const IdList *sched_plocs =
             m_trace_events->get_sched_switch_locs( req_event->pid,
                                                    TraceEvents::SCHED_SWITCH_PREV );
         if ( sched_plocs )
@@ -105,6 +105,13 @@ char *strtok_r( char *str, const char *delim, char **saveptr );
 #if defined( __cplusplus )
 
 #include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <iterator>
+#include <algorithm>
 
 template < typename K, typename V >
 class util_umap
@@ -191,6 +198,7 @@ public:
     std::vector< char * > m_chunks;
 };
 
+// Thread safe string interning. Returned strings live as long as the pool.
 class StrPool
 {
 public:
@@ -204,9 +212,50 @@ public:
     uint64_t getu64( const char *str, size_t len = ( size_t )-1 );
     uint64_t getu64f( const char *fmt, ... ) ATTRIBUTE_PRINTF( 2, 3 );
 
-public:
-    StrAlloc m_alloc;
-    util_umap< uint64_t, const char * > m_pool;
+    // Call func( hashval, str ) for each string. Not safe while other
+    //  threads are adding strings.
+    template < typename T >
+    void for_each( T func ) const
+    {
+        for ( const shard_t &shard : m_shards )
+        {
+            for ( const auto &it : shard.pool.m_map )
+                func( it.first, it.second );
+        }
+    }
+
+    size_t get_chunk_count() const;
+    size_t get_alloc_size() const;
+
+private:
+    // Strings are spread over shards by hash value so threads interning
+    //  at the same time rarely wait on each other.
+    struct shard_t
+    {
+        std::mutex lock;
+        util_umap< uint64_t, const char * > pool;
+    };
+    static const uint32_t SHARD_BITS = 5;
+
+    // New strings are copied into per-thread arenas, so one thread's strings
+    //  share chunks and the copy happens outside the shard lock. Arenas are
+    //  only shared by threads past ARENA_COUNT.
+    struct arena_t
+    {
+        std::mutex lock;
+        StrAlloc alloc;
+    };
+    static const uint32_t ARENA_COUNT = 64;
+
+    // Top bits pick the shard, bottom bits are left for the hash buckets
+    shard_t &get_shard( uint64_t hashval ) { return m_shards[ hashval >> ( 64 - SHARD_BITS ) ]; }
+    arena_t &get_arena();
+
+    const char *intern( uint64_t hashval, const char *str, size_t len );
+
+private:
+    shard_t m_shards[ 1 << SHARD_BITS ];
+    arena_t m_arenas[ ARENA_COUNT ];
 };
 
 class BitVec
@@ -235,6 +284,208 @@ private:
     uint8_t *m_bits = nullptr;
 };
 
+// Append only list of ids stored as blocks of BLOCK_SIZE ids. Each block keeps
+//  its first id and bit packs the deltas to the following ids at the width of
+//  its largest delta, so ascending event ids take a few bits each instead of 32.
+//  Ids past the last full block stay unpacked until shrink_to_fit().
+//  Iterate or use lower_bound() - operator[] decodes from the start of a block.
+class IdList
+{
+public:
+    typedef uint32_t value_type;
+    static const uint32_t BLOCK_SIZE = 128;
+
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef uint32_t value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const uint32_t *pointer;
+        typedef const uint32_t &reference;
+
+        const_iterator() {}
+
+        const uint32_t &operator*() const   { return m_val; }
+
+        const_iterator &operator++()
+        {
+            m_idx++;
+
+            if ( m_idx < m_block_end )
+                m_val += next_delta();
+            else if ( m_idx < m_list->packed_size() )
+                set_block( m_idx / BLOCK_SIZE );
+            else if ( m_idx < m_list->m_size )
+                m_val = m_list->m_tail[ m_idx - m_list->packed_size() ];
+            return *this;
+        }
+        const_iterator operator++( int )
+        {
+            const_iterator ret = *this;
+
+            ++*this;
+            return ret;
+        }
+
+        bool operator==( const const_iterator &rhs ) const { return m_idx == rhs.m_idx; }
+        bool operator!=( const const_iterator &rhs ) const { return m_idx != rhs.m_idx; }
+
+        // Position of this id in the list
+        size_t index() const                { return m_idx; }
+
+    private:
+        friend class IdList;
+
+        void set_block( size_t block )
+        {
+            const block_t &b = m_list->m_packed->blocks[ block ];
+
+            m_val = b.first;
+            m_words = m_list->m_packed->words.data() + b.offset;
+            m_width = b.width;
+            m_bitpos = 0;
+            m_block_end = std::min< size_t >( ( block + 1 ) * BLOCK_SIZE, m_list->packed_size() );
+        }
+
+        uint32_t next_delta()
+        {
+            uint32_t shift = m_bitpos & 63;
+            const uint64_t *word = m_words + ( m_bitpos >> 6 );
+            uint64_t val = word[ 0 ] >> shift;
+
+            if ( shift + m_width > 64 )
+                val |= word[ 1 ] << ( 64 - shift );
+
+            m_bitpos += m_width;
+            return ( uint32_t )( val & ( ( 1ULL << m_width ) - 1 ) );
+        }
+
+    private:
+        const IdList *m_list = nullptr;
+        size_t m_idx = 0;
+        uint32_t m_val = 0;
+
+        // Decode state for the current packed block
+        size_t m_block_end = 0;
+        const uint64_t *m_words = nullptr;
+        uint32_t m_bitpos = 0;
+        uint32_t m_width = 0;
+    };
+
+public:
+    IdList() {}
+    ~IdList() {}
+
+    IdList( const IdList &rhs )             { *this = rhs; }
+    IdList &operator=( const IdList &rhs );
+    IdList( IdList &&rhs )                  { swap( rhs ); }
+    IdList &operator=( IdList &&rhs )       { clear(); swap( rhs ); return *this; }
+
+    // Ids must be added in ascending order for lower_bound() to work. Other
+    //  orders are stored correctly, they just pack poorly.
+    void push_back( uint32_t id )
+    {
+        // Last block was packed short by shrink_to_fit()
+        if ( m_tail.empty() && ( m_size % BLOCK_SIZE ) )
+            unpack_block();
+
+        m_tail.push_back( id );
+        m_back = id;
+        m_size++;
+
+        if ( m_tail.size() == BLOCK_SIZE )
+            pack_block();
+    }
+    void assign( const std::vector< uint32_t > &ids );
+
+    void clear();
+    void swap( IdList &rhs );
+    // Pack remaining ids and release excess capacity once the list is done growing
+    void shrink_to_fit();
+
+    size_t size() const                     { return m_size; }
+    bool empty() const                      { return !m_size; }
+
+    uint32_t front() const                  { return m_packed ? m_packed->blocks[ 0 ].first : m_tail[ 0 ]; }
+    uint32_t back() const                   { return m_back; }
+    uint32_t operator[]( size_t idx ) const;
+
+    const_iterator begin() const            { return iter_at( 0 ); }
+    const_iterator end() const              { return iter_at( m_size ); }
+
+    // First id not less than id, or end()
+    const_iterator lower_bound( uint32_t id ) const;
+    bool contains( uint32_t id ) const
+    {
+        const_iterator it = lower_bound( id );
+
+        return ( it != end() ) && ( *it == id );
+    }
+
+    // Last id for which pred( id ) returns true, or ( uint32_t )-1. Walks
+    //  back from the end a block at a time and stops at the first match.
+    template < typename T >
+    uint32_t find_last_if( T pred ) const
+    {
+        for ( size_t i = m_tail.size(); i-- > 0; )
+        {
+            if ( pred( m_tail[ i ] ) )
+                return m_tail[ i ];
+        }
+
+        if ( m_packed )
+        {
+            uint32_t ids[ BLOCK_SIZE ];
+
+            for ( size_t block = m_packed->blocks.size(); block-- > 0; )
+            {
+                for ( size_t i = decode_block( block, ids ); i-- > 0; )
+                {
+                    if ( pred( ids[ i ] ) )
+                        return ids[ i ];
+                }
+            }
+        }
+        return ( uint32_t )-1;
+    }
+
+    size_t get_alloc_size() const;
+
+private:
+    size_t packed_size() const              { return m_size - m_tail.size(); }
+
+    // Decode packed block into ids and return its count
+    size_t decode_block( size_t block, uint32_t *ids ) const;
+
+    // Iterator at idx, which must be a block start, in the tail, or the end
+    const_iterator iter_at( size_t idx ) const;
+    void pack_block();
+    void unpack_block();
+
+private:
+    struct block_t
+    {
+        uint32_t first;     // First id in block
+        uint32_t offset;    // Start of packed deltas in words
+        uint32_t width;     // Bits per delta
+    };
+    struct packed_t
+    {
+        std::vector< block_t > blocks;
+        // Packed deltas plus a zero word at the end, so decoding can
+        //  always read the word after the current one
+        std::vector< uint64_t > words;
+    };
+
+    // Packed blocks, allocated with the first one. All but the last are full.
+    std::unique_ptr< packed_t > m_packed;
+    // Ids past the last full block
+    std::vector< uint32_t > m_tail;
+    uint32_t m_size = 0;
+    uint32_t m_back = 0;
+};
+
 uint32_t hashstr32( const char *str, size_t len = ( size_t )-1, uint32_t hval = 0xB0F57EE3 );
 uint32_t hashstr32( const std::string &str, uint32_t hval = 0xB0F57EE3 );
 
@@ -248,6 +499,11 @@ std::string get_realpath( const char *filename );
 
 bool copy_file( const char *filename, const char *newfilename );
 
+// Create an anonymous, memory backed file. Returns fd and sets path to a name
+//  it can be opened with like a regular file, or -1 if not supported.
+int memfile_create( const char *name, std::string &path );
+void memfile_close( int fd );
+
 std::string string_format( const char *fmt, ... ) ATTRIBUTE_PRINTF( 1, 2 );
 
 std::string string_strftime();
@@ -372,6 +628,30 @@ char *strcat_safe( char ( &dest )[ T ], const char *src )
     return dest;
 }
 
+// Call func( i ) for i in [0, count) spread across hardware threads.
+//   Blocks until all calls have completed. The calling thread does work as well.
+template < typename T >
+void parallel_for( size_t count, T func )
+{
+    size_t nthreads = std::min< size_t >( count, std::max< size_t >( 1, std::thread::hardware_concurrency() ) );
+    std::atomic< size_t > next( 0 );
+    std::vector< std::thread > threads;
+
+    auto worker = [ & ]()
+    {
+        for ( size_t i = next++; i < count; i = next++ )
+            func( i );
+    };
+
+    for ( size_t i = 1; i < nthreads; i++ )
+        threads.emplace_back( worker );
+
+    worker();
+
+    for ( std::thread &thread : threads )
+        thread.join();
+}
+
 #define STATIC_ASSERT( _x ) static_assert( _x, #_x )
 
 #else
@@ -60,7 +60,7 @@ static std::string createEventString( const trace_event_t &event )
     for ( uint32_t i = 0; i < event.numfields; i++ )
     {
         const event_field_t &field = event.fields[ i ];
-        buf += std::string( field.key ) + "=" + std::string( field.value ) + " ";
+        buf += std::string( field.key ) + "=" + std::string( event.get_field_val( i ) ) + " ";
     }
     return buf;
 }
@@ -215,7 +215,9 @@ bool CreatePlotDlg::render_dlg( TraceEvents &trace_events )
 
     imgui_input_text( "Plot Filter:", m_plot_filter_buf, x, w );
 
-    if ( !m_plot_err_str.empty() )
+    if ( m_plot_progress < 1.0f )
+        ImGui::Text( "Searching events %.0f%%...", 100.0f * m_plot_progress );
+    else if ( !m_plot_err_str.empty() )
         ImGui::TextColored( ImVec4( 1, 0, 0, 1), "%s", m_plot_err_str.c_str() );
 
     imgui_input_text( "Plot Scan Str:", m_plot_scanf_buf, x, w );
@@ -227,12 +229,17 @@ bool CreatePlotDlg::render_dlg( TraceEvents &trace_events )
     if ( disabled )
         ImGui::PushStyleColor( ImGuiCol_Text, ImGui::GetStyleColorVec4( ImGuiCol_TextDisabled ) );
 
-    if ( ImGui::Button( "Create", button_size ) && !disabled )
+    // Keep checking each frame while a background search is running
+    if ( ( ImGui::Button( "Create", button_size ) || ( m_plot_progress < 1.0f ) ) && !disabled )
     {
-        const std::vector< uint32_t > *plocs = trace_events.get_tdopexpr_locs(
-                    m_plot_filter_buf, &m_plot_err_str );
+        const IdList *plocs = trace_events.get_tdopexpr_locs(
+                    m_plot_filter_buf, &m_plot_err_str, &m_plot_progress );
 
-        if ( !plocs && m_plot_err_str.empty() )
+        if ( m_plot_progress < 1.0f )
+        {
+            // Still searching
+        }
+        else if ( !plocs && m_plot_err_str.empty() )
         {
             m_plot_err_str = "WARNING: No events found.";
         }
@@ -261,7 +268,15 @@ bool CreatePlotDlg::render_dlg( TraceEvents &trace_events )
 
     ImGui::SameLine();
     if ( ImGui::Button( "Cancel", button_size ) || s_actions().get( action_escape ) )
+    {
+        if ( m_plot_progress < 1.0f )
+        {
+            trace_events.tdopexpr_job_cancel( m_plot_filter_buf );
+            m_plot_progress = 1.0f;
+        }
+
         ImGui::CloseCurrentPopup();
+    }
 
     ImGui::EndPopup();
 
@@ -280,11 +295,11 @@ bool GraphPlot::init( TraceEvents &trace_events, const std::string &name,
     m_plotdata.clear();
 
     std::string errstr;
-    const std::vector< uint32_t > *plocs = trace_events.get_tdopexpr_locs( m_filter_str.c_str(), &errstr );
+    const IdList *plocs = trace_events.get_tdopexpr_locs( m_filter_str.c_str(), &errstr );
 
     if ( plocs )
     {
-        const trace_event_t &event0 = trace_events.m_events[ ( *plocs )[ 0 ] ];
+        const trace_event_t &event0 = trace_events.m_events[ plocs->front() ];
         if ( scanf_str == "$duration" )
         {
             for ( uint32_t idx : *plocs )
@@ -350,6 +365,8 @@ bool GraphPlot::init( TraceEvents &trace_events, const std::string &name,
         }
     }
 
+    build_lod();
+
     return !m_plotdata.empty();
 }
 
@@ -362,6 +379,9 @@ void GraphPlot::init_empty( const std::string &name )
     m_minval = FLT_MAX;
     m_maxval = FLT_MIN;
     m_plotdata.clear();
+
+    m_lod.clear();
+    m_lod_size = 0;
 }
 
 void GraphPlot::add_item( uint32_t eventid, int64_t ts, float value )
@@ -387,6 +407,103 @@ uint32_t GraphPlot::find_ts_index( int64_t ts0 )
     return ( uint32_t )-1;
 }
 
+// Number of buckets (or samples) from the level below in each lod bucket
+static const size_t s_lod_fanout = 4;
+
+void GraphPlot::build_lod()
+{
+    m_lod.clear();
+    m_lod_size = m_plotdata.size();
+
+    if ( m_plotdata.size() <= s_lod_fanout )
+        return;
+
+    // Level 0: buckets of samples
+    m_lod.emplace_back();
+    m_lod[ 0 ].reserve( ( m_plotdata.size() + s_lod_fanout - 1 ) / s_lod_fanout );
+
+    for ( size_t i = 0; i < m_plotdata.size(); i += s_lod_fanout )
+    {
+        size_t end = std::min< size_t >( m_plotdata.size(), i + s_lod_fanout );
+        plotlod_t lod;
+
+        lod.ts0 = m_plotdata[ i ].ts;
+        lod.ts1 = m_plotdata[ end - 1 ].ts;
+        lod.eventid = m_plotdata[ i ].eventid;
+        lod.first = m_plotdata[ i ].valf;
+        lod.last = m_plotdata[ end - 1 ].valf;
+        lod.minval = lod.first;
+        lod.maxval = lod.first;
+
+        for ( size_t j = i + 1; j < end; j++ )
+        {
+            lod.minval = std::min< float >( lod.minval, m_plotdata[ j ].valf );
+            lod.maxval = std::max< float >( lod.maxval, m_plotdata[ j ].valf );
+        }
+
+        m_lod[ 0 ].push_back( lod );
+    }
+
+    // Levels above: buckets of buckets until we're down to a handful
+    while ( m_lod.back().size() > s_lod_fanout )
+    {
+        m_lod.emplace_back();
+
+        const std::vector< plotlod_t > &below = m_lod[ m_lod.size() - 2 ];
+        std::vector< plotlod_t > &level = m_lod.back();
+
+        level.reserve( ( below.size() + s_lod_fanout - 1 ) / s_lod_fanout );
+
+        for ( size_t i = 0; i < below.size(); i += s_lod_fanout )
+        {
+            size_t end = std::min< size_t >( below.size(), i + s_lod_fanout );
+            plotlod_t lod = below[ i ];
+
+            lod.ts1 = below[ end - 1 ].ts1;
+            lod.last = below[ end - 1 ].last;
+
+            for ( size_t j = i + 1; j < end; j++ )
+            {
+                lod.minval = std::min< float >( lod.minval, below[ j ].minval );
+                lod.maxval = std::max< float >( lod.maxval, below[ j ].maxval );
+            }
+
+            level.push_back( lod );
+        }
+    }
+}
+
+int GraphPlot::get_lod_level( size_t count, float width )
+{
+    // Samples added with add_item() since last build
+    if ( m_lod_size != m_plotdata.size() )
+        build_lod();
+
+    size_t buckets = std::max< size_t >( 1, ( size_t )width );
+
+    // Draw all samples if there's room for a couple per pixel
+    if ( count <= 2 * buckets )
+        return -1;
+
+    // Find first level with about one bucket per pixel
+    for ( size_t level = 0; level < m_lod.size(); level++ )
+    {
+        if ( count / get_lod_span( level ) <= buckets )
+            return ( int )level;
+    }
+
+    return m_lod.empty() ? -1 : ( int )( m_lod.size() - 1 );
+}
+
+size_t GraphPlot::get_lod_span( int level )
+{
+    size_t span = s_lod_fanout;
+
+    for ( int i = 0; i < level; i++ )
+        span *= s_lod_fanout;
+    return span;
+}
+
 bool ParsePlotStr::init( const char *scanf_str )
 {
     const char *pct_f = strstr( scanf_str, "%f" );
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// StrAlloc and StrPool live on their own so tools like sample/bench can
+//  build them without SDL and imgui.
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "gpuvis_macros.h"
+
+char *StrAlloc::allocmem( size_t len )
+{
+    char *ptr;
+
+    if ( len >= 512 )
+    {
+        ptr = ( char * )malloc( len );
+
+        m_chunks.push_back( ptr );
+        return ptr;
+    }
+
+    if ( !m_ptr || ( len > m_avail ) )
+    {
+        m_avail = 64 * 1024;
+        m_ptr = ( char * )malloc( m_avail );
+
+        m_chunks.push_back( m_ptr );
+    }
+
+    ptr = m_ptr;
+    m_avail -= len;
+    m_ptr += len;
+
+    m_totsize += len;
+    return ptr;
+}
+
+char *StrAlloc::dupestr( const char *str, size_t len )
+{
+    char *ptr = allocmem( len + 1 );
+
+    memcpy( ptr, str, len );
+    ptr[ len ] = 0;
+    return ptr;
+}
+
+StrAlloc::~StrAlloc()
+{
+    for ( char *ptr : m_chunks )
+        free( ptr );
+    m_chunks.clear();
+
+    m_ptr = nullptr;
+    m_avail = 0;
+}
+
+/*
+ * StrPool
+ */
+StrPool::arena_t &StrPool::get_arena()
+{
+    // Threads are handed arena slots round robin the first time they intern
+    static std::atomic< uint32_t > s_next_slot( 0 );
+    static thread_local uint32_t s_slot = s_next_slot++ % ARENA_COUNT;
+
+    return m_arenas[ s_slot ];
+}
+
+const char *StrPool::intern( uint64_t hashval, const char *str, size_t len )
+{
+    shard_t &shard = get_shard( hashval );
+
+    {
+        std::lock_guard< std::mutex > lock( shard.lock );
+        const char **ret = shard.pool.get_val( hashval );
+
+        if ( ret )
+            return *ret;
+    }
+
+    // Copy new strings into this thread's arena without holding the shard
+    //  lock. If another thread added it meanwhile, theirs wins and our
+    //  copy is just a few wasted arena bytes.
+    char *str2;
+    {
+        arena_t &arena = get_arena();
+        std::lock_guard< std::mutex > lock( arena.lock );
+
+        str2 = arena.alloc.dupestr( str, len );
+    }
+
+    std::lock_guard< std::mutex > lock( shard.lock );
+    return *shard.pool.get_val( hashval, str2 );
+}
+
+const char *StrPool::getstr( const char *str, size_t len )
+{
+    if ( len == ( size_t )-1 )
+        len = strlen( str );
+
+    return intern( hashstr64( str, len ), str, len );
+}
+
+const char *StrPool::getstrf( const char *fmt, ... )
+{
+    va_list args;
+    char buf[ 512 ];
+
+    va_start( args, fmt );
+    vsnprintf_safe( buf, fmt, args );
+    va_end( args );
+
+    return getstr( buf );
+}
+
+uint64_t StrPool::getu64( const char *str, size_t len )
+{
+    if ( len == ( size_t )-1 )
+        len = strlen( str );
+
+    uint64_t hashval = hashstr64( str, len );
+
+    intern( hashval, str, len );
+    return hashval;
+}
+
+uint64_t StrPool::getu64f( const char *fmt, ... )
+{
+    va_list args;
+    char buf[ 512 ];
+
+    va_start( args, fmt );
+    vsnprintf_safe( buf, fmt, args );
+    va_end( args );
+
+    return getu64( buf );
+}
+
+const char *StrPool::findstr( uint64_t hashval )
+{
+    shard_t &shard = get_shard( hashval );
+    std::lock_guard< std::mutex > lock( shard.lock );
+    const char **str = shard.pool.get_val( hashval );
+
+    return str ? *str : NULL;
+}
+
+size_t StrPool::get_chunk_count() const
+{
+    size_t count = 0;
+
+    for ( const arena_t &arena : m_arenas )
+        count += arena.alloc.m_chunks.size();
+    return count;
+}
+
+size_t StrPool::get_alloc_size() const
+{
+    size_t size = 0;
+
+    for ( const arena_t &arena : m_arenas )
+        size += arena.alloc.m_totsize;
+    return size;
+}
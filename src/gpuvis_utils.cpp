@@ -26,6 +26,7 @@
 
 #ifndef WIN32
 #include <unistd.h>
+#include <sys/mman.h>
 #else
 #define WIN32_LEAN_AND_MEAN 1
 #include <windows.h>
@@ -533,6 +534,30 @@ bool copy_file( const char *filename, const char *newfilename )
     return success;
 }
 
+int memfile_create( const char *name, std::string &path )
+{
+#if defined( MFD_CLOEXEC )
+    int fd = memfd_create( name, MFD_CLOEXEC );
+
+    if ( fd >= 0 )
+    {
+        path = string_format( "/proc/self/fd/%d", fd );
+        return fd;
+    }
+
+    logf( "[Warning] memfd_create(%s) failed: %d", name, errno );
+#endif
+
+    return -1;
+}
+
+void memfile_close( int fd )
+{
+#if defined( MFD_CLOEXEC )
+    close( fd );
+#endif
+}
+
 // Parse a "comp_[1-2].[0-3].[0-8]" string. Returns true on success.
 bool comp_str_parse( const char *comp, uint32_t &a, uint32_t &b, uint32_t &c )
 {
@@ -1581,121 +1606,206 @@ const std::string Actions::hotkey_str( action_t action )
     return "";
 }
 
-char *StrAlloc::allocmem( size_t len )
+/*
+ * IdList
+ */
+IdList &IdList::operator=( const IdList &rhs )
 {
-    char *ptr;
-
-    if ( len >= 512 )
+    if ( this != &rhs )
     {
-        ptr = ( char * )malloc( len );
-
-        m_chunks.push_back( ptr );
-        return ptr;
+        m_packed.reset( rhs.m_packed ? new packed_t( *rhs.m_packed ) : nullptr );
+        m_tail = rhs.m_tail;
+        m_size = rhs.m_size;
+        m_back = rhs.m_back;
     }
+    return *this;
+}
 
-    if ( !m_ptr || ( len > m_avail ) )
-    {
-        m_avail = 64 * 1024;
-        m_ptr = ( char * )malloc( m_avail );
+void IdList::assign( const std::vector< uint32_t > &ids )
+{
+    clear();
 
-        m_chunks.push_back( m_ptr );
-    }
+    for ( uint32_t id : ids )
+        push_back( id );
+}
 
-    ptr = m_ptr;
-    m_avail -= len;
-    m_ptr += len;
+void IdList::clear()
+{
+    m_packed.reset();
+    m_tail.clear();
+    m_size = 0;
+    m_back = 0;
+}
 
-    m_totsize += len;
-    return ptr;
+void IdList::swap( IdList &rhs )
+{
+    m_packed.swap( rhs.m_packed );
+    m_tail.swap( rhs.m_tail );
+    std::swap( m_size, rhs.m_size );
+    std::swap( m_back, rhs.m_back );
 }
 
-char *StrAlloc::dupestr( const char *str, size_t len )
+void IdList::shrink_to_fit()
 {
-    char *ptr = allocmem( len + 1 );
+    // Short lists are smaller left unpacked
+    if ( m_tail.size() >= BLOCK_SIZE / 4 )
+        pack_block();
 
-    memcpy( ptr, str, len );
-    ptr[ len ] = 0;
-    return ptr;
+    if ( m_packed )
+    {
+        m_packed->blocks.shrink_to_fit();
+        m_packed->words.shrink_to_fit();
+    }
+    m_tail.shrink_to_fit();
 }
 
-StrAlloc::~StrAlloc()
+uint32_t IdList::operator[]( size_t idx ) const
 {
-    for ( char *ptr : m_chunks )
-        free( ptr );
-    m_chunks.clear();
+    if ( idx >= packed_size() )
+        return m_tail[ idx - packed_size() ];
+
+    const_iterator it = iter_at( idx - ( idx % BLOCK_SIZE ) );
 
-    m_ptr = nullptr;
-    m_avail = 0;
+    while ( it.m_idx < idx )
+    {
+        it.m_val += it.next_delta();
+        it.m_idx++;
+    }
+    return it.m_val;
 }
 
-/*
- * StrPool
- */
-const char *StrPool::getstr( const char *str, size_t len )
+IdList::const_iterator IdList::lower_bound( uint32_t id ) const
 {
-    if ( len == ( size_t )-1 )
-        len = strlen( str );
+    if ( m_packed )
+    {
+        const std::vector< block_t > &blocks = m_packed->blocks;
+        auto it = std::lower_bound( blocks.begin(), blocks.end(), id,
+                                    []( const block_t &block, uint32_t val )
+                                        { return block.first < val; } );
+        size_t block = it - blocks.begin();
+
+        // All ids are >= id
+        if ( !block )
+            return begin();
+
+        // Blocks from here on start at or past id, so walk the one before
+        //  it. Stepping off its end lands on the next block or the tail.
+        const_iterator ret = iter_at( ( block - 1 ) * BLOCK_SIZE );
+        size_t block_end = std::min< size_t >( block * BLOCK_SIZE, packed_size() );
+
+        do
+        {
+            ++ret;
+        } while ( ( ret.m_idx < block_end ) && ( ret.m_val < id ) );
 
-    uint64_t hashval = hashstr64( str, len );
-    const char **ret = m_pool.get_val( hashval );
+        if ( ( ret.m_idx < block_end ) || ( block < blocks.size() ) )
+            return ret;
+    }
 
-    if ( !ret )
-    {
-        char *str2 = m_alloc.dupestr( str, len );
+    auto it = std::lower_bound( m_tail.begin(), m_tail.end(), id );
+
+    return iter_at( packed_size() + ( it - m_tail.begin() ) );
+}
+
+size_t IdList::get_alloc_size() const
+{
+    size_t size = m_tail.capacity() * sizeof( uint32_t );
 
-        ret = m_pool.get_val( hashval, str2 );
+    if ( m_packed )
+    {
+        size += sizeof( packed_t );
+        size += m_packed->blocks.capacity() * sizeof( block_t );
+        size += m_packed->words.capacity() * sizeof( uint64_t );
     }
+    return size;
+}
+
+size_t IdList::decode_block( size_t block, uint32_t *ids ) const
+{
+    const_iterator it = iter_at( block * BLOCK_SIZE );
+    size_t count = it.m_block_end - it.m_idx;
 
-    return *ret;
+    ids[ 0 ] = it.m_val;
+    for ( size_t i = 1; i < count; i++ )
+        ids[ i ] = ids[ i - 1 ] + it.next_delta();
+    return count;
 }
 
-const char *StrPool::getstrf( const char *fmt, ... )
+IdList::const_iterator IdList::iter_at( size_t idx ) const
 {
-    va_list args;
-    char buf[ 512 ];
+    const_iterator it;
 
-    va_start( args, fmt );
-    vsnprintf_safe( buf, fmt, args );
-    va_end( args );
+    it.m_list = this;
+    it.m_idx = idx;
 
-    return getstr( buf );
+    if ( idx < packed_size() )
+        it.set_block( idx / BLOCK_SIZE );
+    else if ( idx < m_size )
+        it.m_val = m_tail[ idx - packed_size() ];
+    return it;
 }
 
-uint64_t StrPool::getu64( const char *str, size_t len )
+void IdList::pack_block()
 {
-    if ( len == ( size_t )-1 )
-        len = strlen( str );
+    uint32_t bits = 0;
+    block_t block;
+
+    if ( !m_packed )
+    {
+        m_packed.reset( new packed_t );
+        m_packed->words.push_back( 0 );
+    }
+
+    std::vector< uint64_t > &words = m_packed->words;
+
+    // Deltas wrap for descending ids, which still decode fine
+    for ( size_t i = 1; i < m_tail.size(); i++ )
+        bits |= m_tail[ i ] - m_tail[ i - 1 ];
+
+    // Start in the trailing zero word and add a new one past our deltas
+    block.first = m_tail[ 0 ];
+    block.offset = ( uint32_t )words.size() - 1;
+    block.width = 0;
+    while ( ( block.width < 32 ) && ( bits >> block.width ) )
+        block.width++;
+
+    words.resize( words.size() + ( block.width * ( m_tail.size() - 1 ) + 63 ) / 64 );
 
-    uint64_t hashval = hashstr64( str, len );
-    const char **ret = m_pool.get_val( hashval );
+    uint64_t *dst = words.data() + block.offset;
+    uint32_t bitpos = 0;
 
-    if ( !ret )
+    for ( size_t i = 1; i < m_tail.size(); i++ )
     {
-        char *str2 = m_alloc.dupestr( str, len );
+        uint64_t delta = m_tail[ i ] - m_tail[ i - 1 ];
+        uint32_t shift = bitpos & 63;
 
-        m_pool.get_val( hashval, str2 );
+        dst[ bitpos >> 6 ] |= delta << shift;
+        if ( shift + block.width > 64 )
+            dst[ ( bitpos >> 6 ) + 1 ] |= delta >> ( 64 - shift );
+
+        bitpos += block.width;
     }
 
-    return hashval;
+    m_packed->blocks.push_back( block );
+    m_tail.clear();
 }
 
-uint64_t StrPool::getu64f( const char *fmt, ... )
+void IdList::unpack_block()
 {
-    va_list args;
-    char buf[ 512 ];
+    std::vector< uint32_t > ids;
 
-    va_start( args, fmt );
-    vsnprintf_safe( buf, fmt, args );
-    va_end( args );
+    // Move ids in the short last block back to the tail and drop its words
+    for ( const_iterator it = iter_at( m_size - ( m_size % BLOCK_SIZE ) ); it != end(); ++it )
+        ids.push_back( *it );
 
-    return getu64( buf );
-}
+    m_packed->words.resize( m_packed->blocks.back().offset + 1 );
+    m_packed->words.back() = 0;
+    m_packed->blocks.pop_back();
 
-const char *StrPool::findstr( uint64_t hashval )
-{
-    const char **str = m_pool.get_val( hashval );
+    if ( m_packed->blocks.empty() )
+        m_packed.reset();
 
-    return str ? *str : NULL;
+    m_tail.swap( ids );
 }
 
 #if defined( WIN32 )
@@ -3850,25 +3850,64 @@ static int events_id_cmp(const void *a, const void *b);
  */
 struct tep_event *tep_find_event(struct tep_handle *tep, int id)
 {
-	struct tep_event **eventptr;
-	struct tep_event key;
-	struct tep_event *pkey = &key;
+	struct tep_event *event;
 
 	/* Check cache first */
 	if (tep->last_event && tep->last_event->id == id)
 		return tep->last_event;
 
+	event = tep_find_event_nocache(tep, id);
+	if (event)
+		tep->last_event = event;
+
+	return event;
+}
+
+/*
+ * gpuvis change!
+ * tep_find_event_nocache - find an event by given id without using last_event
+ * @tep: a handle to the trace event parser context
+ * @id: the id of the event
+ *
+ * Does not read or write tep->last_event, so records can be parsed
+ * on several threads at once.
+ */
+struct tep_event *tep_find_event_nocache(struct tep_handle *tep, int id)
+{
+	struct tep_event **eventptr;
+	struct tep_event key;
+	struct tep_event *pkey = &key;
+
 	key.id = id;
 
 	eventptr = bsearch(&pkey, tep->events, tep->nr_events,
 			   sizeof(*tep->events), events_id_cmp);
 
-	if (eventptr) {
-		tep->last_event = *eventptr;
-		return *eventptr;
-	}
+	return eventptr ? *eventptr : NULL;
+}
 
-	return NULL;
+/*
+ * gpuvis change!
+ * tep_init_lazy_maps - build the lookup tables libtraceevent creates on first use
+ * @tep: a handle to the trace event parser context
+ *
+ * The cmdline, function and printk maps and the common type / pid field
+ * locations are normally created the first time they are needed. Create
+ * them up front so records can then be parsed from multiple threads.
+ */
+void tep_init_lazy_maps(struct tep_handle *tep)
+{
+	if (!tep->cmdlines && tep->cmdline_count)
+		cmdline_init(tep);
+	if (!tep->func_map)
+		func_map_init(tep);
+	if (!tep->printk_map)
+		printk_map_init(tep);
+
+	if (!tep->type_size)
+		get_common_info(tep, "common_type", &tep->type_offset, &tep->type_size);
+	if (!tep->pid_size)
+		get_common_info(tep, "common_pid", &tep->pid_offset, &tep->pid_size);
 }
 
 /**
@@ -538,6 +538,7 @@ int tep_read_number_field(struct tep_format_field *field, const void *data,
 struct tep_event *tep_get_first_event(struct tep_handle *tep);
 int tep_get_events_count(struct tep_handle *tep);
 struct tep_event *tep_find_event(struct tep_handle *tep, int id);
+struct tep_event *tep_find_event_nocache(struct tep_handle *tep, int id); /* gpuvis change! */
 
 struct tep_event *
 tep_find_event_by_name(struct tep_handle *tep, const char *sys, const char *name);
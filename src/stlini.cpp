@@ -420,21 +420,20 @@ void CIniFile::ClearSection( const char *section )
         m_inifile.erase( iSection );
 }
 
-std::string util_get_config_dir( const char *dirname )
+#ifndef WIN32
+// $<xdg_var>/dirname, or $HOME/<home_dir>/dirname if xdg_var isn't set
+static std::string get_xdg_dir( const char *xdg_var, const char *home_dir, const char *dirname )
 {
-#ifdef WIN32
-    return SDL_GetPrefPath( "gpuvis", "gpuvis" );
-#else
-    std::string config_dir;
-    static const char *xdg_config_home = getenv( "XDG_CONFIG_HOME" );
+    std::string dir;
+    const char *xdg_dir = getenv( xdg_var );
 
-    if ( xdg_config_home && xdg_config_home[ 0 ] )
+    if ( xdg_dir && xdg_dir[ 0 ] )
     {
-        config_dir = xdg_config_home;
+        dir = xdg_dir;
     }
     else 
     {
-        static const char *home = getenv( "HOME" );
+        const char *home = getenv( "HOME" );
 
         if ( !home || !home[ 0 ] )
         {
@@ -444,22 +443,42 @@ std::string util_get_config_dir( const char *dirname )
 
         if ( home && home[ 0 ] )
         {
-            config_dir = home;
-            config_dir += "/.config";
+            dir = home;
+            dir += home_dir;
         }
     }
 
-    if ( !config_dir.size() )
+    if ( !dir.size() )
     {
         // Egads, can't find home dir - just fall back to using tmp dir.
-        config_dir = P_tmpdir;
+        dir = P_tmpdir;
     }
 
-    config_dir += "/";
-    config_dir += dirname;
+    mkdir( dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO );
+
+    dir += "/";
+    dir += dirname;
+
+    mkdir( dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO );
+    return dir;
+}
+#endif
+
+std::string util_get_config_dir( const char *dirname )
+{
+#ifdef WIN32
+    return SDL_GetPrefPath( "gpuvis", "gpuvis" );
+#else
+    return get_xdg_dir( "XDG_CONFIG_HOME", "/.config", dirname );
+#endif
+}
 
-    mkdir( config_dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO );
-    return config_dir;
+std::string util_get_cache_dir( const char *dirname )
+{
+#ifdef WIN32
+    return SDL_GetPrefPath( "gpuvis", "cache" );
+#else
+    return get_xdg_dir( "XDG_CACHE_HOME", "/.cache", dirname );
 #endif
 }
 
@@ -27,6 +27,7 @@ typedef std::map< std::string, std::string, StlIniCompareStringNoCase > INISecti
 typedef std::map< std::string, INISection, StlIniCompareStringNoCase > INIFile;
 
 std::string util_get_config_dir( const char *dirname );
+std::string util_get_cache_dir( const char *dirname );
 
 class CIniFile
 {
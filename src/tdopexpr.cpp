@@ -52,7 +52,19 @@ enum tdop_tok_type_t
     TOK_INFIX_OP
 };
 
-typedef const char * ( TDOP_INFIX_FUNC )( const char *a, const char *b );
+enum tdop_op_t
+{
+    OP_NULL,
+    OP_AND,
+    OP_OR,
+    OP_NOTEQUAL,
+    OP_CONTAINS,
+    OP_EQUAL,
+    OP_GE,
+    OP_GT,
+    OP_LE,
+    OP_LT
+};
 
 struct tdop_state_token
 {
@@ -60,7 +72,7 @@ struct tdop_state_token
     tdop_tok_type_t type;
 
     const char *variable;
-    TDOP_INFIX_FUNC *function;
+    tdop_op_t op;
     char value_buf[ 64 ];
 
     void set_value_buf( const char *val, size_t val_len )
@@ -82,86 +94,206 @@ struct tdop_state
     tdop_get_key_func get_key_func;
 };
 
-static int num_compare( const char *a, const char *b, int defval )
+// Constant operand. Numeric interpretations are parsed once at compile time.
+struct tdop_const_t
 {
-    char *endptr;
+    char str[ 64 ];
 
-    if ( !a[ 0 ] || !b[ 0 ] )
-        return defval;
+    bool is_float;      // num_compare() compares this as a double
+    bool is_int;        // str is exactly "%lld" of ival
+    double dval;
+    uint64_t uval;
+    int64_t ival;
+};
 
-    if ( a[ 0 ] == '-' || b[ 0 ] == '-' ||
-         strchr( a, '.' ) || strchr( b, '.' ) )
-    {
-        double val_a = strtod( a, &endptr );
-        double val_b = strtod( b, &endptr );
+// Compiled program is postfix: push operands, then apply op to top two.
+enum tdop_inst_type_t
+{
+    INST_CONST,
+    INST_VAR,
+    INST_OP
+};
 
-        if ( val_a == val_b )
-            return 0;
-        else if ( val_a < val_b )
-            return -1;
-        return 1;
-    }
-    else
-    {
-        int base_a = ( a[ 0 ] == '0' && a[ 1 ] == 'x' ) ? 16 : 10;
-        int base_b = ( b[ 0 ] == '0' && b[ 1 ] == 'x' ) ? 16 : 10;
+struct tdop_inst_t
+{
+    tdop_inst_type_t type;
+    tdop_op_t op;
+    uint32_t index;     // Index into m_consts or m_vars
+};
 
-        uint64_t val_a = strtoull( a, &endptr, base_a );
-        uint64_t val_b = strtoull( b, &endptr, base_b );
+// Evaluation stack entry
+struct tdop_slot_t
+{
+    tdop_val_t val;
+    const tdop_const_t *pconst;
+    char buf[ 64 ];
+};
 
-        if ( val_a == val_b )
-            return 0;
-        else if ( val_a < val_b )
-            return -1;
-        return 1;
+static bool is_float_str( const char *str )
+{
+    return ( str[ 0 ] == '-' ) || strchr( str, '.' );
+}
+
+static uint64_t parse_uint( const char *str )
+{
+    int base = ( str[ 0 ] == '0' && str[ 1 ] == 'x' ) ? 16 : 10;
+
+    return strtoull( str, NULL, base );
+}
+
+static const char *slot_str( tdop_slot_t &slot )
+{
+    if ( !slot.val.str )
+    {
+        if ( slot.val.type == TDOP_VAL_INT )
+            snprintf_safe( slot.buf, "%lld", ( long long )slot.val.i );
+        else
+            snprintf_safe( slot.buf, "%.6f", slot.val.f );
+
+        slot.val.str = slot.buf;
     }
+
+    return slot.val.str;
 }
 
-static const char *func_gt( const char *a, const char *b )
+static bool slot_is_true( const tdop_slot_t &slot )
 {
-    return ( num_compare( a, b, -1 ) > 0 ) ? "1" : "";
+    return ( slot.val.type != TDOP_VAL_STRING ) || slot.val.str[ 0 ];
 }
 
-static const char *func_ge( const char *a, const char *b )
+static bool slot_is_empty( const tdop_slot_t &slot )
 {
-    return ( num_compare( a, b, -1 ) >= 0 ) ? "1" : "";
+    return ( slot.val.type == TDOP_VAL_STRING ) && !slot.val.str[ 0 ];
 }
 
-static const char *func_lt( const char *a, const char *b )
+static bool slot_is_float( const tdop_slot_t &slot )
 {
-    return ( num_compare( a, b, 1 ) < 0 ) ? "1" : "";
+    if ( slot.pconst )
+        return slot.pconst->is_float;
+    else if ( slot.val.type == TDOP_VAL_INT )
+        return ( slot.val.i < 0 );
+    else if ( slot.val.type == TDOP_VAL_FLOAT )
+        return true;
+
+    return is_float_str( slot.val.str );
 }
 
-static const char *func_le( const char *a, const char *b )
+static double slot_dval( const tdop_slot_t &slot )
 {
-    return ( num_compare( a, b, 1 ) <= 0 ) ? "1" : "";
+    if ( slot.pconst )
+        return slot.pconst->dval;
+    else if ( slot.val.type == TDOP_VAL_INT )
+        return ( double )slot.val.i;
+    else if ( slot.val.type == TDOP_VAL_FLOAT )
+        return slot.val.f;
+
+    return strtod( slot.val.str, NULL );
 }
 
-static const char *func_and( const char *a, const char *b )
+static uint64_t slot_uval( const tdop_slot_t &slot )
 {
-    return a[ 0 ] && b[ 0 ] ? "1" : "";
+    if ( slot.pconst )
+        return slot.pconst->uval;
+    else if ( slot.val.type == TDOP_VAL_INT )
+        return ( uint64_t )slot.val.i;
+
+    // Floats always take the slot_dval() path
+    return parse_uint( slot.val.str );
 }
 
-static const char *func_or( const char *a, const char *b )
+static bool slot_ival( const tdop_slot_t &slot, int64_t &val )
 {
-    return a[ 0 ] || b[ 0 ] ? "1" : "";
+    if ( slot.pconst )
+    {
+        val = slot.pconst->ival;
+        return slot.pconst->is_int;
+    }
+    else if ( slot.val.type == TDOP_VAL_INT )
+    {
+        val = slot.val.i;
+        return true;
+    }
+
+    return false;
 }
 
-static const char *func_equal( const char *a, const char *b )
+static int num_compare( const tdop_slot_t &a, const tdop_slot_t &b, int defval )
 {
-    return !strcasecmp( a, b ) ? "1" : "";
+    if ( slot_is_empty( a ) || slot_is_empty( b ) )
+        return defval;
+
+    if ( slot_is_float( a ) || slot_is_float( b ) )
+    {
+        double val_a = slot_dval( a );
+        double val_b = slot_dval( b );
+
+        if ( val_a == val_b )
+            return 0;
+        else if ( val_a < val_b )
+            return -1;
+        return 1;
+    }
+    else
+    {
+        uint64_t val_a = slot_uval( a );
+        uint64_t val_b = slot_uval( b );
+
+        if ( val_a == val_b )
+            return 0;
+        else if ( val_a < val_b )
+            return -1;
+        return 1;
+    }
 }
 
-static const char *func_notequal( const char *a, const char *b )
+static bool slot_equal( tdop_slot_t &a, tdop_slot_t &b )
 {
-    return strcasecmp( a, b ) ? "1" : "";
+    int64_t val_a, val_b;
+
+    // Integers print the same iff they're equal, so skip formatting them
+    if ( slot_ival( a, val_a ) && slot_ival( b, val_b ) )
+        return ( val_a == val_b );
+
+    const char *str_a = slot_str( a );
+    const char *str_b = slot_str( b );
+
+    // Strings from the same pool compare equal by pointer
+    return ( str_a == str_b ) || !strcasecmp( str_a, str_b );
 }
 
-/* $line =~ [[:space:]]* */
-/* contains operator: "12345678 =~ 345" is true */
-static const char *func_contains( const char * a, const char * b )
+static bool eval_op( tdop_op_t op, tdop_slot_t &a, tdop_slot_t &b )
 {
-    return ( b[ 0 ] && strcasestr( a, b ) ) ? "1" : "";
+    switch ( op )
+    {
+    case OP_AND:
+        return slot_is_true( a ) && slot_is_true( b );
+    case OP_OR:
+        return slot_is_true( a ) || slot_is_true( b );
+    case OP_EQUAL:
+        return slot_equal( a, b );
+    case OP_NOTEQUAL:
+        return !slot_equal( a, b );
+    case OP_CONTAINS:
+    {
+        /* $line =~ [[:space:]]* */
+        /* contains operator: "12345678 =~ 345" is true */
+        const char *str_b = slot_str( b );
+
+        return str_b[ 0 ] && strcasestr( slot_str( a ), str_b );
+    }
+    case OP_GT:
+        return ( num_compare( a, b, -1 ) > 0 );
+    case OP_GE:
+        return ( num_compare( a, b, -1 ) >= 0 );
+    case OP_LT:
+        return ( num_compare( a, b, 1 ) < 0 );
+    case OP_LE:
+        return ( num_compare( a, b, 1 ) <= 0 );
+    case OP_NULL:
+        break;
+    }
+
+    return false;
 }
 
 static void next_token( tdop_state *s )
@@ -169,7 +301,7 @@ static void next_token( tdop_state *s )
     s->tok.lbp = 0;
     s->tok.type = TOK_NULL;
     s->tok.variable = NULL;
-    s->tok.function = NULL;
+    s->tok.op = OP_NULL;
     s->tok.value_buf[ 0 ] = 0;
 
     while ( s->tok.type == TOK_NULL )
@@ -256,21 +388,21 @@ static void next_token( tdop_state *s )
             struct op_t
             {
                 const char *opstr;
-                TDOP_INFIX_FUNC *function;
+                tdop_op_t op;
                 int lbp;
             };
             static const op_t s_ops[] =
             {
-                { "&&", func_and, 10 },
-                { "||", func_or, 10 },
-                { "!=", func_notequal, 20 },
-                { "=~", func_contains, 20 },
-                { "==", func_equal, 20 },
-                { "=", func_equal, 20 },
-                { ">=", func_ge, 20 },
-                { ">", func_gt, 20 },
-                { "<=", func_le, 20 },
-                { "<", func_lt, 20 },
+                { "&&", OP_AND, 10 },
+                { "||", OP_OR, 10 },
+                { "!=", OP_NOTEQUAL, 20 },
+                { "=~", OP_CONTAINS, 20 },
+                { "==", OP_EQUAL, 20 },
+                { "=", OP_EQUAL, 20 },
+                { ">=", OP_GE, 20 },
+                { ">", OP_GT, 20 },
+                { "<=", OP_LE, 20 },
+                { "<", OP_LT, 20 },
             };
 
             const char *n = s->next++;
@@ -309,7 +441,7 @@ static void next_token( tdop_state *s )
 
                         s->tok.type = TOK_INFIX_OP;
                         s->tok.lbp = op.lbp;
-                        s->tok.function = op.function;
+                        s->tok.op = op.op;
                         break;
                     }
                 }
@@ -326,19 +458,27 @@ public:
     ~TdopExpr() {}
 
     int compile( const char *expression, tdop_get_key_func &get_key_func, std::string &errstr );
-    const char *exec( tdop_get_keyval_func &get_keyval_func );
+    const char *exec( tdop_get_keyval_func &get_keyval_func ) const;
 
 protected:
     tdop_state_token *get_next_token();
-    const char *tdop_infix( tdop_state_token *self, const char *left );
-    const char *tdop_expression( int rbp );
+    void tdop_expression( int rbp );
+
+    void emit( tdop_inst_type_t type, tdop_op_t op, uint32_t index );
+    void add_const( const char *str );
 
 public:
-    tdop_get_keyval_func m_get_keyval_func;
+    // Compile state
     tdop_state_token *m_token = nullptr;
-
     size_t m_token_index = 0;
     std::vector< tdop_state_token > m_vec_tokens;
+
+    // Compiled program
+    std::vector< tdop_inst_t > m_program;
+    std::vector< tdop_const_t > m_consts;
+    std::vector< const char * > m_vars;
+    size_t m_depth = 0;
+    size_t m_max_depth = 0;
 };
 
 class TdopExpr *tdopexpr_compile( const char *expression, tdop_get_key_func &get_key_func, std::string &errstr )
@@ -372,32 +512,56 @@ tdop_state_token *TdopExpr::get_next_token()
     return &m_vec_tokens[ m_token_index++ ];
 }
 
-const char *TdopExpr::tdop_infix( tdop_state_token *self, const char *left )
+void TdopExpr::emit( tdop_inst_type_t type, tdop_op_t op, uint32_t index )
 {
-    const char *right = tdop_expression( self->lbp );
+    m_program.push_back( { type, op, index } );
 
-    return self->function( left, right );
+    // Operands push one slot, ops pop two and push their result
+    if ( type == INST_OP )
+        m_depth--;
+    else
+        m_depth++;
+
+    m_max_depth = std::max< size_t >( m_max_depth, m_depth );
 }
 
-const char *TdopExpr::tdop_expression( int rbp )
+void TdopExpr::add_const( const char *str )
 {
-    const char *left;
+    tdop_const_t c;
+    char buf[ 64 ];
+
+    strcpy_safe( c.str, str );
+
+    c.is_float = is_float_str( c.str );
+    c.dval = strtod( c.str, NULL );
+    c.uval = parse_uint( c.str );
+    c.ival = strtoll( c.str, NULL, 10 );
+
+    snprintf_safe( buf, "%lld", ( long long )c.ival );
+    c.is_int = !strcmp( buf, c.str );
+
+    m_consts.push_back( c );
+    emit( INST_CONST, OP_NULL, m_consts.size() - 1 );
+}
 
+void TdopExpr::tdop_expression( int rbp )
+{
     if ( m_token->type == TOK_LPAREN )
     {
         m_token = get_next_token();
-        left = tdop_expression( 0 );
+        tdop_expression( 0 );
 
         // m_token should be TOK_RPAREN right now
     }
     else if ( m_token->type == TOK_VARIABLE )
     {
-        left = m_get_keyval_func( m_token->variable, m_token->value_buf );
+        m_vars.push_back( m_token->variable );
+        emit( INST_VAR, OP_NULL, m_vars.size() - 1 );
     }
     else
     {
         // m_token should be TOK_STRING / TOK_NUMBER
-        left = m_token->value_buf;
+        add_const( m_token->value_buf );
     }
 
     m_token = get_next_token();
@@ -409,20 +573,52 @@ const char *TdopExpr::tdop_expression( int rbp )
 
         m_token = get_next_token();
 
-        left = tdop_infix( tok, left );
+        tdop_expression( tok->lbp );
+        emit( INST_OP, tok->op, 0 );
     }
-
-    return left;
 }
 
-const char *TdopExpr::exec( tdop_get_keyval_func &get_keyval_func )
+const char *TdopExpr::exec( tdop_get_keyval_func &get_keyval_func ) const
 {
-    m_get_keyval_func = get_keyval_func;
+    tdop_slot_t stack_buf[ 16 ];
+    std::vector< tdop_slot_t > heap_buf;
+    tdop_slot_t *stack = stack_buf;
+    size_t sp = 0;
 
-    m_token_index = 0;
-    m_token = get_next_token();
+    if ( m_max_depth > ARRAY_SIZE( stack_buf ) )
+    {
+        heap_buf.resize( m_max_depth );
+        stack = heap_buf.data();
+    }
+
+    for ( const tdop_inst_t &inst : m_program )
+    {
+        if ( inst.type == INST_CONST )
+        {
+            tdop_slot_t &slot = stack[ sp++ ];
+
+            slot.pconst = &m_consts[ inst.index ];
+            slot.val = tdop_val_str( slot.pconst->str );
+        }
+        else if ( inst.type == INST_VAR )
+        {
+            tdop_slot_t &slot = stack[ sp++ ];
 
-    return tdop_expression( 0 );
+            slot.pconst = NULL;
+            slot.val = get_keyval_func( m_vars[ inst.index ] );
+        }
+        else
+        {
+            tdop_slot_t &b = stack[ --sp ];
+            tdop_slot_t &a = stack[ sp - 1 ];
+            bool ret = eval_op( inst.op, a, b );
+
+            a.pconst = NULL;
+            a.val = tdop_val_str( ret ? "1" : "" );
+        }
+    }
+
+    return ( sp && slot_is_true( stack[ 0 ] ) ) ? "1" : "";
 }
 
 static bool is_arg( tdop_tok_type_t type )
@@ -527,6 +723,23 @@ int TdopExpr::compile( const char *expression, tdop_get_key_func &get_key_func,
     }
 
     errstr = validate_info_tokens( m_vec_tokens );
+    if ( !errstr.empty() )
+        return -1;
+
+    // Compile tokens to postfix program
+    m_program.clear();
+    m_consts.clear();
+    m_vars.clear();
+    m_depth = 0;
+    m_max_depth = 0;
+
+    m_token_index = 0;
+    m_token = get_next_token();
+    tdop_expression( 0 );
+
+    // Tokens aren't needed to execute the program
+    m_vec_tokens.clear();
+    m_token = nullptr;
 
-    return errstr.empty() ? 0 : -1;
+    return 0;
 }
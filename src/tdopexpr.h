@@ -24,10 +24,44 @@
 #ifndef TDOPEXPR_H_
 #define TDOPEXPR_H_
 
+// Value of a variable returned by tdop_get_keyval_func. Numeric values are
+//  only formatted to strings ("%lld" / "%.6f") if an operator needs the string.
+enum tdop_val_type_t
+{
+    TDOP_VAL_STRING,
+    TDOP_VAL_INT,
+    TDOP_VAL_FLOAT
+};
+
+struct tdop_val_t
+{
+    tdop_val_type_t type;
+    const char *str;
+    int64_t i;
+    double f;
+};
+
+inline tdop_val_t tdop_val_str( const char *str )
+{
+    return { TDOP_VAL_STRING, str, 0, 0.0 };
+}
+inline tdop_val_t tdop_val_int( int64_t i )
+{
+    return { TDOP_VAL_INT, NULL, i, 0.0 };
+}
+inline tdop_val_t tdop_val_float( double f )
+{
+    return { TDOP_VAL_FLOAT, NULL, 0, f };
+}
+
+// Variables are resolved once at compile time: the key returned by get_key_func
+//  is what gets passed to get_keyval_func when the expression is executed.
 typedef std::function< const char * ( const char *name, size_t len ) > tdop_get_key_func;
-typedef std::function< const char * ( const char *name, char ( &buf )[ 64 ] ) > tdop_get_keyval_func;
+typedef std::function< tdop_val_t ( const char *key ) > tdop_get_keyval_func;
 
 class TdopExpr *tdopexpr_compile( const char *expression, tdop_get_key_func &get_key_func, std::string &errstr );
+// Returns "1" if expression is true, "" otherwise. Safe to call from multiple
+//  threads with the same TdopExpr as long as get_keyval_func is.
 const char *tdopexpr_exec( class TdopExpr *tdop_expr, tdop_get_keyval_func &get_keyval_func );
 void tdopexpr_delete( class TdopExpr *tdop_expr );
 
@@ -32,6 +32,12 @@
 #include <unordered_set>
 #include <algorithm>
 #include <future>
+#include <thread>
+#include <queue>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 #ifdef WIN32
 #include <io.h>
@@ -52,6 +58,7 @@
 
 #if !defined(__linux__) && !defined(__sun)
 #define lseek64 lseek
+#define pread64 pread
 #define off64_t off_t
 #endif
 
@@ -77,6 +84,20 @@ extern "C"
     };
 
     /* Taken from the old event-parse.h */
+    static inline unsigned short
+    __data2host2(struct tep_handle *pevent, unsigned short data)
+    {
+        unsigned short swap;
+
+        if (tep_is_bigendian() == tep_is_file_bigendian(pevent))
+            return data;
+
+        swap = ((data & 0xffULL) << 8) |
+            ((data & (0xffULL << 8)) >> 8);
+
+        return swap;
+    }
+
     static inline unsigned int
     __data2host4(struct tep_handle *pevent, unsigned int data)
     {
@@ -115,8 +136,13 @@ extern "C"
 }
 
 #include "../gpuvis_macros.h"
+#include "../miniz.h"
 #include "trace-read.h"
 
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 enum
 {
     TRACECMD_OPTION_DONE,
@@ -129,9 +155,36 @@ enum
     TRACECMD_OPTION_OFFSET,
     TRACEMCD_OPTION_CPUCOUNT,
     TRACECMD_OPTION_VERSION,
+    TRACECMD_OPTION_PROCMAPS,
+    TRACECMD_OPTION_TRACEID,
+    TRACECMD_OPTION_TIME_SHIFT,
+    TRACECMD_OPTION_GUEST,
+    TRACECMD_OPTION_TSC2NSEC,
+    TRACECMD_OPTION_STRINGS,
+    TRACECMD_OPTION_HEADER_INFO,
+    TRACECMD_OPTION_FTRACE_EVENTS,
+    TRACECMD_OPTION_EVENT_FORMATS,
+    TRACECMD_OPTION_KALLSYMS,
+    TRACECMD_OPTION_PRINTK,
+    TRACECMD_OPTION_CMDLINES,
+    TRACECMD_OPTION_BUFFER_TEXT,
     TRACECMD_OPTION_SAVED_TGIDS = 32,
 };
 
+/* trace.dat v7 section header flags */
+enum
+{
+    TRACECMD_SEC_FL_COMPRESS = ( 1 << 0 ),
+};
+
+/* trace.dat v7 compression algorithms */
+enum
+{
+    TRACECMD_COMPRESS_NONE,
+    TRACECMD_COMPRESS_ZLIB,
+    TRACECMD_COMPRESS_ZSTD,
+};
+
 enum
 {
     TRACECMD_FL_BUFFER_INSTANCE = ( 1 << 1 ),
@@ -151,6 +204,25 @@ typedef struct file_info
     pevent_record_t *record;
 } file_info_t;
 
+/* Compressed chunk of trace.dat v7 cpu data */
+typedef struct zchunk
+{
+    /* location of the compressed data in the file */
+    off64_t zoffset;
+    unsigned int zsize;
+    /* location of the decompressed data in the cpu data */
+    unsigned long long offset;
+    unsigned int size;
+} zchunk_t;
+
+/* Decompressed chunk, ready once a zchunk_workers_t thread is done with it */
+struct zchunk_data_t
+{
+    size_t index = 0;
+    std::vector< char > data;
+    std::shared_future< bool > ready;
+};
+
 typedef struct page
 {
     off64_t offset;
@@ -174,14 +246,126 @@ typedef struct cpu_data
     kbuffer_t *kbuf = nullptr;
 
     pevent_record_t event_record;
+
+    /* trace.dat v7 compressed chunks and recently used decompressed ones */
+    std::vector< zchunk_t > zchunks;
+    std::deque< std::shared_ptr< zchunk_data_t > > zcache;
+    size_t zchunk_last = ( size_t )-1;
+
+#ifdef USE_MMAP
+    /* entire cpu data section mapped at once (or NULL) */
+    char *map = nullptr;
+    size_t map_size = 0;
+    off64_t map_offset = 0;
+    /* current page when the data section is mapped */
+    page_t map_page = {};
+#endif
 } cpu_data_t;
 
+// Min-heap of ( timestamp, cursor index ) used to merge cpu buffers, buffer
+//  instances, etc. in timestamp order. Ties pop the lowest cursor index first.
+typedef std::pair< unsigned long long, size_t > ts_cursor_t;
+typedef std::priority_queue< ts_cursor_t, std::vector< ts_cursor_t >, std::greater< ts_cursor_t > > ts_cursor_heap_t;
+
+/* Where a cpu's data lives in a trace.dat v7 buffer */
+typedef struct buffer_cpu
+{
+    int cpu;
+    unsigned long long offset;
+    unsigned long long size;
+} buffer_cpu_t;
+
 typedef struct input_buffer_instance
 {
-    char *name;
-    size_t offset;
+    std::string name;
+    size_t offset = 0;
+
+    /* trace.dat v7 buffers carry their clock and cpu data locations */
+    std::string clock;
+    std::vector< buffer_cpu_t > cpu_data;
 } input_buffer_instance_t;
 
+// Small pool of threads decompressing trace.dat v7 chunks ahead of the readers
+class zchunk_workers_t
+{
+public:
+    zchunk_workers_t( size_t count )
+    {
+        for ( size_t i = 0; i < count; i++ )
+            m_threads.emplace_back( [ this ]() { run(); } );
+    }
+
+    ~zchunk_workers_t()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_exit = true;
+        }
+        m_cond.notify_all();
+
+        for ( std::thread &thread : m_threads )
+            thread.join();
+    }
+
+    void push( std::function< void() > func )
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_queue.push_back( std::move( func ) );
+        }
+        m_cond.notify_one();
+    }
+
+private:
+    void run()
+    {
+        for ( ;; )
+        {
+            std::function< void() > func;
+
+            {
+                std::unique_lock< std::mutex > lock( m_mutex );
+
+                m_cond.wait( lock, [ this ]() { return m_exit || !m_queue.empty(); } );
+
+                // Queue gets drained before exiting
+                if ( m_queue.empty() )
+                    return;
+
+                func = std::move( m_queue.front() );
+                m_queue.pop_front();
+            }
+
+            func();
+        }
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque< std::function< void() > > m_queue;
+    std::vector< std::thread > m_threads;
+    bool m_exit = false;
+};
+
+// Pool shared by every handle reading compressed chunks. It runs on top of
+//  the parallel cpu decode threads, so keep it small: min( 4, cores ).
+static std::shared_ptr< zchunk_workers_t > get_zchunk_workers()
+{
+    static std::mutex s_mutex;
+    static std::weak_ptr< zchunk_workers_t > s_workers;
+
+    std::lock_guard< std::mutex > lock( s_mutex );
+    std::shared_ptr< zchunk_workers_t > workers = s_workers.lock();
+
+    if ( !workers && ( std::thread::hardware_concurrency() > 1 ) )
+    {
+        workers = std::make_shared< zchunk_workers_t >( std::min< unsigned int >( 4, std::thread::hardware_concurrency() ) );
+        s_workers = workers;
+    }
+    return workers;
+}
+
 typedef struct tracecmd_input
 {
     pevent_t *pevent = nullptr;
@@ -192,14 +376,34 @@ typedef struct tracecmd_input
     unsigned long page_size = 0;
     int cpus = 0;
     int ref = 0;
-    int nr_buffers = 0; /* buffer instances */
+    int file_version = 0;
     bool use_trace_clock = false;
 #ifdef USE_MMAP
     bool read_page = false;
 #endif
+    /* trace.dat v7 compression and whether this buffer's cpu data uses it */
+    int compression = TRACECMD_COMPRESS_NONE;
+    bool compressed = false;
+    std::shared_ptr< zchunk_workers_t > zworkers;
     cpu_data_t *cpu_data = nullptr;
+    /* next record ts for each cpu, used by tracecmd_peek_next_data. Entries
+       go stale when a cpu is read and get refreshed when they reach the top. */
+    ts_cursor_heap_t cpu_heap;
+    bool cpu_heap_init = false;
     unsigned long long ts_offset = 0;
-    input_buffer_instance_t *buffers = nullptr;
+    input_buffer_instance_t top_buffer; /* trace.dat v7 */
+    std::vector< input_buffer_instance_t > buffers; /* buffer instances */
+
+    /* trace.dat v7 options and section locations */
+    unsigned long long options_start = 0;
+    unsigned long long sections[ TRACECMD_OPTION_BUFFER_TEXT + 1 ] = {};
+
+    /* trace.dat v7 compressed section being read from memory. Handle owned
+       so die() doesn't longjmp over them. */
+    std::vector< char > section_zbuf;
+    std::vector< char > section_buf;
+    size_t section_pos = 0;
+    bool in_section = false;
 
     std::string file;
     std::string uname;
@@ -218,6 +422,10 @@ typedef struct tracecmd_input
 
 void logf( const char *fmt, ... ) ATTRIBUTE_PRINTF( 1, 2 );
 
+// Set on parallel decode worker threads so die() jumps back to the worker
+//  instead of the handle jump_buffer owned by the loading thread.
+static thread_local std::jmp_buf *s_worker_jump_buffer = nullptr;
+
 [[noreturn]] static void die( tracecmd_input_t *handle, const char *fmt, ... ) ATTRIBUTE_PRINTF( 2, 3 );
 [[noreturn]] static void die( tracecmd_input_t *handle, const char *fmt, ... )
 {
@@ -235,7 +443,7 @@ void logf( const char *fmt, ... ) ATTRIBUTE_PRINTF( 1, 2 );
         free( buf );
     }
 
-    std::longjmp( handle->jump_buffer, -1 );
+    std::longjmp( s_worker_jump_buffer ? *s_worker_jump_buffer : handle->jump_buffer, -1 );
 }
 
 static void *trace_malloc( tracecmd_input_t *handle, size_t size )
@@ -260,6 +468,16 @@ static size_t do_read( tracecmd_input_t *handle, void *data, size_t size )
 {
     ssize_t ret;
 
+    /* Reading a decompressed section */
+    if ( handle->in_section )
+    {
+        size = std::min( size, handle->section_buf.size() - handle->section_pos );
+
+        memcpy( data, handle->section_buf.data() + handle->section_pos, size );
+        handle->section_pos += size;
+        return size;
+    }
+
     ret = TEMP_FAILURE_RETRY( read( handle->fd, data, size ) );
     if ( ret < 0 )
     {
@@ -282,6 +500,52 @@ static void do_read_check( tracecmd_input_t *handle, void *data, size_t size )
     }
 }
 
+static off64_t do_seek_cur( tracecmd_input_t *handle, off64_t offset )
+{
+    if ( handle->in_section )
+    {
+        if ( ( offset < -( off64_t )handle->section_pos ) ||
+             ( offset > ( off64_t )( handle->section_buf.size() - handle->section_pos ) ) )
+            return -1;
+
+        handle->section_pos += offset;
+        return handle->section_pos;
+    }
+
+    return lseek64( handle->fd, offset, SEEK_CUR );
+}
+
+/*
+ * Read from an absolute file offset without moving the file position.
+ * Thread safe where pread is available.
+ */
+static bool read_at( int fd, void *data, size_t size, off64_t offset )
+{
+#ifdef WIN32
+    off64_t save_seek = lseek64( fd, 0, SEEK_CUR );
+    bool ret = ( lseek64( fd, offset, SEEK_SET ) == offset ) &&
+               ( ( size_t )read( fd, data, size ) == size );
+
+    lseek64( fd, save_seek, SEEK_SET );
+    return ret;
+#else
+    char *ptr = ( char * )data;
+
+    while ( size )
+    {
+        ssize_t ret = TEMP_FAILURE_RETRY( pread64( fd, ptr, size, offset ) );
+
+        if ( ret <= 0 )
+            return false;
+
+        ptr += ret;
+        size -= ret;
+        offset += ret;
+    }
+    return true;
+#endif
+}
+
 static char *read_string( tracecmd_input_t *handle )
 {
     char *str = NULL;
@@ -319,7 +583,7 @@ static char *read_string( tracecmd_input_t *handle )
 
     /* move the file descriptor to the end of the string */
     off64_t val;
-    val = lseek64( handle->fd, -( int )( r - ( i + 1 ) ), SEEK_CUR );
+    val = do_seek_cur( handle, -( int )( r - ( i + 1 ) ) );
     if ( val < 0 )
         goto fail;
 
@@ -346,6 +610,16 @@ fail:
     return NULL;
 }
 
+static unsigned short read2( tracecmd_input_t *handle )
+{
+    unsigned short data;
+    pevent_t *pevent = handle->pevent;
+
+    do_read_check( handle, &data, 2 );
+
+    return __data2host2( pevent, data );
+}
+
 static unsigned int read4( tracecmd_input_t *handle )
 {
     unsigned int data;
@@ -375,6 +649,128 @@ static void read_data_and_size( tracecmd_input_t *handle,
     do_read_check( handle, *data, *size );
 }
 
+static inline bool has_sections( tracecmd_input_t *handle )
+{
+    return handle->file_version >= 7;
+}
+
+/*
+ * Decompressed sizes come straight from the file. Check size is something
+ * zsize bytes of zdata could hold before allocating it: zstd frames carry
+ * their content size, deflate can't expand by more than ~1032:1.
+ */
+static bool zsize_valid( int compression, const char *zdata, size_t zsize, size_t size )
+{
+#ifdef USE_ZSTD
+    if ( compression == TRACECMD_COMPRESS_ZSTD )
+    {
+        unsigned long long len = ZSTD_getFrameContentSize( zdata, zsize );
+
+        if ( len != ZSTD_CONTENTSIZE_UNKNOWN )
+            return len == size;
+    }
+#endif
+
+    return size / 1032 <= zsize;
+}
+
+static bool zdecompress( int compression, const char *zdata, size_t zsize, char *data, size_t size )
+{
+    switch ( compression )
+    {
+    case TRACECMD_COMPRESS_ZLIB:
+    {
+        mz_ulong len = size;
+
+        return ( mz_uncompress( ( unsigned char * )data, &len,
+                                ( const unsigned char * )zdata, zsize ) == MZ_OK ) && ( len == size );
+    }
+#ifdef USE_ZSTD
+    case TRACECMD_COMPRESS_ZSTD:
+    {
+        size_t len = ZSTD_decompress( data, size, zdata, zsize );
+
+        return !ZSTD_isError( len ) && ( len == size );
+    }
+#endif
+    }
+
+    return false;
+}
+
+/*
+ * Read a v7 section header at offset and check it's the section we want.
+ * Leaves the file position at the start of the section data.
+ */
+static unsigned short read_section_header( tracecmd_input_t *handle,
+                                           unsigned long long offset, unsigned short id,
+                                           unsigned long long *size = NULL )
+{
+    unsigned short section_id;
+    unsigned short flags;
+
+    if ( lseek64( handle->fd, offset, SEEK_SET ) < 0 )
+        die( handle, "%s: could not seek to section %u at %llu.\n", __func__, id, offset );
+
+    section_id = read2( handle );
+    flags = read2( handle );
+
+    /* section description string id and section size */
+    read4( handle );
+    unsigned long long section_size = read8( handle );
+
+    if ( section_id != id )
+        die( handle, "%s: expected section %u at %llu, found %u.\n", __func__, id, offset, section_id );
+
+    if ( size )
+        *size = section_size;
+    return flags;
+}
+
+/*
+ * Start reading the v7 section at offset. Compressed sections get
+ * decompressed and read from memory until section_end().
+ */
+static void section_begin( tracecmd_input_t *handle, unsigned long long offset, unsigned short id )
+{
+    unsigned long long section_size;
+    unsigned short flags = read_section_header( handle, offset, id, &section_size );
+
+    if ( flags & TRACECMD_SEC_FL_COMPRESS )
+    {
+        unsigned int zsize = read4( handle );
+        unsigned int size = read4( handle );
+        off64_t pos = lseek64( handle->fd, 0, SEEK_CUR );
+
+        if ( ( zsize > section_size ) || ( pos < 0 ) || ( ( unsigned long long )pos + zsize > handle->total_file_size ) )
+            die( handle, "%s: section %u compressed size %u is past the end of the file.\n", __func__, id, zsize );
+
+        handle->section_zbuf.resize( zsize );
+        do_read_check( handle, handle->section_zbuf.data(), zsize );
+
+        if ( !zsize_valid( handle->compression, handle->section_zbuf.data(), zsize, size ) )
+            die( handle, "%s: section %u size %u is too big for %u compressed bytes.\n", __func__, id, size, zsize );
+
+        handle->section_buf.resize( size );
+        if ( !zdecompress( handle->compression, handle->section_zbuf.data(), zsize, handle->section_buf.data(), size ) )
+            die( handle, "%s: failed to decompress section %u.\n", __func__, id );
+
+        handle->section_zbuf.clear();
+        handle->section_zbuf.shrink_to_fit();
+
+        handle->section_pos = 0;
+        handle->in_section = true;
+    }
+}
+
+static void section_end( tracecmd_input_t *handle )
+{
+    handle->in_section = false;
+    handle->section_pos = 0;
+    handle->section_buf.clear();
+    handle->section_buf.shrink_to_fit();
+}
+
 static void read_header_files( tracecmd_input_t *handle )
 {
     pevent_t *pevent = handle->pevent;
@@ -384,8 +780,6 @@ static void read_header_files( tracecmd_input_t *handle )
 
     do_read_check( handle, buf, 12 );
 
-    //$$$ TODO: need to add "zstd" support?
-    // https://github.com/mikesart/gpuvis/issues/50
     if ( memcmp( buf, "header_page", 12 ) != 0 )
         die( handle, "%s: header_page not found.\n", __func__ );
 
@@ -678,8 +1072,51 @@ static void parse_trace_clock( tracecmd_input_t *handle, char *file )
  * format of the ring buffer, event formats, ftrace formats, kallsyms
  * and printk.
  */
+static int handle_options( tracecmd_input_t *handle );
+
+static void read_section( tracecmd_input_t *handle, unsigned short id,
+                          void ( *read_func )( tracecmd_input_t *handle ) )
+{
+    if ( !handle->sections[ id ] )
+        return;
+
+    section_begin( handle, handle->sections[ id ], id );
+    read_func( handle );
+    section_end( handle );
+}
+
+/*
+ * trace.dat v7 files start with options, which point to the
+ * (possibly compressed) sections holding the rest of the headers.
+ */
+static void tracecmd_read_headers_v7( tracecmd_input_t *handle )
+{
+    section_begin( handle, handle->options_start, TRACECMD_OPTION_DONE );
+
+    if ( handle_options( handle ) < 0 )
+        die( handle, "%s: handle_options failed.\n", __func__ );
+
+    if ( !handle->sections[ TRACECMD_OPTION_HEADER_INFO ] )
+        die( handle, "%s: header_page not found.\n", __func__ );
+
+    read_section( handle, TRACECMD_OPTION_HEADER_INFO, read_header_files );
+    read_section( handle, TRACECMD_OPTION_FTRACE_EVENTS, read_ftrace_files );
+    read_section( handle, TRACECMD_OPTION_EVENT_FORMATS, read_event_files );
+    read_section( handle, TRACECMD_OPTION_KALLSYMS, read_proc_kallsyms );
+    read_section( handle, TRACECMD_OPTION_PRINTK, read_ftrace_printk );
+    read_section( handle, TRACECMD_OPTION_CMDLINES, read_and_parse_cmdlines );
+
+    tep_set_long_size( handle->pevent, handle->long_size );
+}
+
 static void tracecmd_read_headers( tracecmd_input_t *handle )
 {
+    if ( has_sections( handle ) )
+    {
+        tracecmd_read_headers_v7( handle );
+        return;
+    }
+
     read_header_files( handle );
 
     read_ftrace_files( handle );
@@ -695,12 +1132,150 @@ static void tracecmd_read_headers( tracecmd_input_t *handle )
     tep_set_long_size( handle->pevent, handle->long_size );
 }
 
+// Runs on the zchunk workers, so errors are returned instead of die()'ing.
+//  load_zchunks() already checked the chunk lies inside the file.
+static bool read_zchunk( int fd, int compression, const zchunk_t &chunk, std::vector< char > &data )
+{
+    std::vector< char > zdata( chunk.zsize );
+
+    if ( !read_at( fd, zdata.data(), chunk.zsize, chunk.zoffset ) ||
+         !zsize_valid( compression, zdata.data(), chunk.zsize, chunk.size ) )
+    {
+        return false;
+    }
+
+    data.resize( chunk.size );
+    return zdecompress( compression, zdata.data(), chunk.zsize, data.data(), chunk.size );
+}
+
+// Decompress chunk index on a worker thread, or right here if async is false
+static std::shared_ptr< zchunk_data_t > queue_zchunk( tracecmd_input_t *handle, int cpu, size_t index, bool async )
+{
+    int fd = handle->fd;
+    int compression = handle->compression;
+    zchunk_t chunk = handle->cpu_data[ cpu ].zchunks[ index ];
+    std::shared_ptr< zchunk_data_t > data = std::make_shared< zchunk_data_t >();
+    std::shared_ptr< std::promise< bool > > promise = std::make_shared< std::promise< bool > >();
+    auto func = [ fd, compression, chunk, data, promise ]()
+    {
+        promise->set_value( read_zchunk( fd, compression, chunk, data->data ) );
+    };
+
+    data->index = index;
+    data->ready = promise->get_future().share();
+
+    if ( async && handle->zworkers )
+        handle->zworkers->push( func );
+    else
+        func();
+
+    return data;
+}
+
+/*
+ * Get decompressed chunk index for a cpu. Sequential reads queue the
+ * next few chunks on the worker threads so they're ready when we get
+ * there. Only the ZCHUNK_CACHE_SIZE most recently used chunks are kept.
+ */
+#define ZCHUNK_READAHEAD 3
+#define ZCHUNK_CACHE_SIZE ( ZCHUNK_READAHEAD + 3 )
+
+static zchunk_data_t *get_zchunk( tracecmd_input_t *handle, int cpu, size_t index )
+{
+    cpu_data_t *cpu_data = &handle->cpu_data[ cpu ];
+    std::deque< std::shared_ptr< zchunk_data_t > > &zcache = cpu_data->zcache;
+    std::shared_ptr< zchunk_data_t > data;
+    size_t end = index + 1;
+
+    auto find_chunk = [ &zcache ]( size_t i )
+    {
+        return std::find_if( zcache.begin(), zcache.end(),
+                             [ i ]( const std::shared_ptr< zchunk_data_t > &chunk ) { return chunk->index == i; } );
+    };
+
+    auto it = find_chunk( index );
+    if ( it != zcache.end() )
+    {
+        data = *it;
+        zcache.erase( it );
+    }
+    else
+    {
+        // We'd just be waiting on it, so decompress it on this thread
+        data = queue_zchunk( handle, cpu, index, false );
+    }
+
+    if ( index == cpu_data->zchunk_last + 1 )
+    {
+        end = std::min< size_t >( index + 1 + ZCHUNK_READAHEAD, cpu_data->zchunks.size() );
+
+        for ( size_t i = index + 1; i < end; i++ )
+        {
+            if ( find_chunk( i ) == zcache.end() )
+                zcache.push_back( queue_zchunk( handle, cpu, i, true ) );
+        }
+    }
+    cpu_data->zchunk_last = index;
+
+    zcache.push_back( data );
+
+    // Drop least recently used chunks outside the read ahead window. Wait
+    //  for any still in flight since the worker reads from our fd.
+    for ( it = zcache.begin(); ( zcache.size() > ZCHUNK_CACHE_SIZE ) && ( it != zcache.end() ); )
+    {
+        if ( ( *it )->index >= index && ( *it )->index < end )
+        {
+            ++it;
+            continue;
+        }
+
+        ( *it )->ready.wait();
+        it = zcache.erase( it );
+    }
+
+    if ( !data->ready.get() )
+        return NULL;
+
+    return data.get();
+}
+
+/*
+ * Copy a page out of the decompressed chunk holding it. Offsets are
+ * in the decompressed cpu data.
+ */
+static int read_zpage( tracecmd_input_t *handle, off64_t offset, int cpu, void *map )
+{
+    std::vector< zchunk_t > &zchunks = handle->cpu_data[ cpu ].zchunks;
+    auto it = std::upper_bound( zchunks.begin(), zchunks.end(), ( unsigned long long )offset,
+                                []( unsigned long long off, const zchunk_t &chunk ) { return off < chunk.offset; } );
+
+    if ( it == zchunks.begin() )
+        return -1;
+
+    --it;
+    if ( offset + handle->page_size > it->offset + it->size )
+        die( handle, "%s: cpu %d page at %llu not in a single chunk.\n", __func__, cpu, ( unsigned long long )offset );
+
+    zchunk_data_t *data = get_zchunk( handle, cpu, it - zchunks.begin() );
+    if ( !data )
+    {
+        die( handle, "%s: failed to decompress cpu %d chunk %lu.\n", __func__, cpu,
+             ( unsigned long )( it - zchunks.begin() ) );
+    }
+
+    memcpy( map, data->data.data() + ( offset - it->offset ), handle->page_size );
+    return 0;
+}
+
 static int read_page( tracecmd_input_t *handle, off64_t offset,
                       int cpu, void *map )
 {
     off64_t ret;
     off64_t save_seek;
 
+    if ( handle->compressed )
+        return read_zpage( handle, offset, cpu, map );
+
     /* other parts of the code may expect the pointer to not move */
     save_seek = lseek64( handle->fd, 0, SEEK_CUR );
 
@@ -717,12 +1292,67 @@ static int read_page( tracecmd_input_t *handle, off64_t offset,
     return 0;
 }
 
-static page_t *allocate_page( tracecmd_input_t *handle, int cpu, off64_t offset )
+#ifdef USE_MMAP
+/*
+ * Map the entire data section for a cpu so pages can be used in place.
+ */
+static void map_cpu_data( tracecmd_input_t *handle, int cpu )
 {
-    int ret;
     cpu_data_t *cpu_data = &handle->cpu_data[ cpu ];
+    off64_t mask = ( off64_t )sysconf( _SC_PAGESIZE ) - 1;
+    off64_t offset = cpu_data->file_offset & ~mask;
+    size_t size = cpu_data->file_offset + cpu_data->file_size - offset;
+    void *map;
 
-    for ( page_t *page : cpu_data->pages )
+    if ( ( mask < 0 ) || ( size != cpu_data->file_offset + cpu_data->file_size - offset ) )
+        return;
+
+    map = mmap( NULL, size, PROT_READ, MAP_PRIVATE, handle->fd, offset );
+    if ( map == MAP_FAILED )
+        return;
+
+    madvise( map, size, MADV_SEQUENTIAL );
+
+    cpu_data->map = ( char * )map;
+    cpu_data->map_size = size;
+    cpu_data->map_offset = offset;
+    cpu_data->map_page.handle = handle;
+}
+
+static void unmap_cpu_data( tracecmd_input_t *handle, int cpu )
+{
+    cpu_data_t *cpu_data = &handle->cpu_data[ cpu ];
+
+    if ( cpu_data->map )
+    {
+        munmap( cpu_data->map, cpu_data->map_size );
+        cpu_data->map = NULL;
+        cpu_data->map_size = 0;
+    }
+}
+
+static inline bool is_mapped_page( tracecmd_input_t *handle, int cpu, page_t *page )
+{
+    return ( page == &handle->cpu_data[ cpu ].map_page );
+}
+#endif
+
+static page_t *allocate_page( tracecmd_input_t *handle, int cpu, off64_t offset )
+{
+    int ret;
+    cpu_data_t *cpu_data = &handle->cpu_data[ cpu ];
+
+#ifdef USE_MMAP
+    /* Data section is mapped: point into it, no allocation or page list */
+    if ( cpu_data->map )
+    {
+        cpu_data->map_page.offset = offset;
+        cpu_data->map_page.map = cpu_data->map + ( offset - cpu_data->map_offset );
+        return &cpu_data->map_page;
+    }
+#endif
+
+    for ( page_t *page : cpu_data->pages )
     {
         if ( page->offset == offset )
         {
@@ -739,7 +1369,7 @@ static page_t *allocate_page( tracecmd_input_t *handle, int cpu, off64_t offset
     page->handle = handle;
 
 #ifdef USE_MMAP
-    if ( handle->read_page )
+    if ( handle->read_page || handle->compressed )
 #endif
     {
         page->map = trace_malloc( handle, handle->page_size );
@@ -775,6 +1405,12 @@ static page_t *allocate_page( tracecmd_input_t *handle, int cpu, off64_t offset
 
 static void __free_page( tracecmd_input_t *handle, int cpu, page_t *page )
 {
+#ifdef USE_MMAP
+    /* Mapped pages live until the data section is unmapped */
+    if ( is_mapped_page( handle, cpu, page ) )
+        return;
+#endif
+
     if ( !page->ref_count )
         die( handle, "%s: Page ref count is zero.\n", __func__ );
 
@@ -783,7 +1419,7 @@ static void __free_page( tracecmd_input_t *handle, int cpu, page_t *page )
         return;
 
 #ifdef USE_MMAP
-    if ( handle->read_page )
+    if ( handle->read_page || handle->compressed )
 #endif
         free( page->map );
 #ifdef USE_MMAP
@@ -1010,9 +1646,15 @@ read_again:
     record->locked = 1;
     record->priv = page;
 
-    handle->cpu_data[ cpu ].next_record = record;
+#ifdef USE_MMAP
+    /* Record data points into the cpu mapping, no page reference needed */
+    if ( is_mapped_page( handle, cpu, page ) )
+        record->priv = NULL;
+    else
+#endif
+        page->ref_count++;
 
-    page->ref_count++;
+    handle->cpu_data[ cpu ].next_record = record;
 
     kbuffer_next_event( kbuf, NULL );
 
@@ -1043,6 +1685,54 @@ static pevent_record_t *tracecmd_read_data( tracecmd_input_t *handle, int cpu )
     return record;
 }
 
+/**
+ * tracecmd_seek_cpu_ts - move the cpu iterator close to a timestamp
+ * @handle: input handle for the trace.dat file
+ * @cpu: the CPU to move
+ * @ts: timestamp to move to
+ *
+ * Binary searches the cpu data pages by their header timestamps and moves
+ * the CPU iterator to the start of the page holding the first record at
+ * or after @ts. Records on skipped pages are never read. Must be called
+ * before the CPU iterator is used with tracecmd_peek_next_data.
+ */
+static void tracecmd_seek_cpu_ts( tracecmd_input_t *handle, int cpu, unsigned long long ts )
+{
+    cpu_data_t *cpu_data = &handle->cpu_data[ cpu ];
+    unsigned long long file_offset = cpu_data->file_offset;
+    size_t lo = 0;
+    size_t hi = cpu_data->file_size / handle->page_size;
+
+    if ( !cpu_data->page || ( hi < 2 ) )
+        return;
+
+    free_next( handle, cpu );
+
+    // Find the last page with a header timestamp before ts. Free the
+    //  current page each time so get_page() reloads the page header.
+    while ( hi - lo > 1 )
+    {
+        size_t mid = lo + ( hi - lo ) / 2;
+
+        free_page( handle, cpu );
+        if ( get_page( handle, cpu, file_offset + mid * handle->page_size ) < 0 )
+            die( handle, "%s: failed to read cpu %d page %lu.\n", __func__, cpu, ( unsigned long )mid );
+
+        if ( cpu_data->timestamp < ts )
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    // Back up a page in case records at ts start on the previous one
+    if ( lo )
+        lo--;
+
+    free_page( handle, cpu );
+    if ( get_page( handle, cpu, file_offset + lo * handle->page_size ) < 0 )
+        die( handle, "%s: failed to read cpu %d page %lu.\n", __func__, cpu, ( unsigned long )lo );
+}
+
 /**
  * tracecmd_peek_next_data - return the next record
  * @handle: input handle to the trace.dat file
@@ -1056,33 +1746,45 @@ static pevent_record_t *tracecmd_read_data( tracecmd_input_t *handle, int cpu )
  */
 static pevent_record_t *tracecmd_peek_next_data( tracecmd_input_t *handle, int *rec_cpu )
 {
-    int cpu;
-    int next_cpu;
-    unsigned long long ts;
-    pevent_record_t *record, *next_record = NULL;
-
     if ( rec_cpu )
         *rec_cpu = -1;
 
-    next_cpu = -1;
-    ts = 0;
-
-    for ( cpu = 0; cpu < handle->cpus; cpu++ )
+    if ( !handle->cpu_heap_init )
     {
-        record = tracecmd_peek_data( handle, cpu );
-        if ( record && ( !next_record || record->ts < ts ) )
+        for ( int cpu = 0; cpu < handle->cpus; cpu++ )
         {
-            ts = record->ts;
-            next_cpu = cpu;
-            next_record = record;
+            pevent_record_t *record = tracecmd_peek_data( handle, cpu );
+
+            if ( record )
+                handle->cpu_heap.push( { record->ts, cpu } );
         }
+
+        handle->cpu_heap_init = true;
     }
 
-    if ( next_record )
+    /*
+     * Each cpu has a single event_record, so we can't peek the next one
+     * until the caller is done with the last one read. Reads only move
+     * cpu cursors forward, so a stale entry's ts is never later than its
+     * cpu's next record: check the top against the cpu and fix it up until
+     * they agree. This also covers tracecmd_read_data() calls made
+     * directly between peeks.
+     */
+    while ( !handle->cpu_heap.empty() )
     {
-        if ( rec_cpu )
-            *rec_cpu = next_cpu;
-        return next_record;
+        ts_cursor_t top = handle->cpu_heap.top();
+        pevent_record_t *record = tracecmd_peek_data( handle, top.second );
+
+        if ( record && ( record->ts == top.first ) )
+        {
+            if ( rec_cpu )
+                *rec_cpu = top.second;
+            return record;
+        }
+
+        handle->cpu_heap.pop();
+        if ( record )
+            handle->cpu_heap.push( { record->ts, top.second } );
     }
 
     return NULL;
@@ -1117,6 +1819,7 @@ static pevent_record_t *tracecmd_read_next_data( tracecmd_input_t *handle, int *
     if ( rec_cpu )
         *rec_cpu = next_cpu;
 
+    // Next peek refreshes this cpu's heap entry
     return tracecmd_read_data( handle, next_cpu );
 }
 
@@ -1134,6 +1837,12 @@ static int init_cpu( tracecmd_input_t *handle, int cpu )
         return 0;
     }
 
+#ifdef USE_MMAP
+    /* Compressed pages get copied out of decompressed chunks */
+    if ( !handle->read_page && !handle->compressed )
+        map_cpu_data( handle, cpu );
+#endif
+
     cpu_data->page = allocate_page( handle, cpu, cpu_data->offset );
 #ifdef USE_MMAP
     if ( !cpu_data->page && !handle->read_page )
@@ -1186,6 +1895,70 @@ static void tracecmd_parse_tgids(pevent_t *pevent,
     }
 }
 
+/*
+ * v6 buffer options are the offset of the buffer's flyrecord data and its name.
+ * v7 adds the buffer clock and where each cpu's data lives. The unnamed v7
+ * buffer is the top level one.
+ */
+static void handle_buffer_option( tracecmd_input_t *handle, const char *buf, unsigned int size )
+{
+    input_buffer_instance_t buffer;
+    unsigned long long offset;
+    unsigned int cpus;
+    size_t pos;
+
+    if ( size < 9 )
+        die( handle, "%s: buffer option too small.\n", __func__ );
+
+    memcpy( &offset, buf, 8 );
+    buffer.offset = __data2host8( handle->pevent, offset );
+    buffer.name = buf + 8;
+
+    if ( !has_sections( handle ) )
+    {
+        handle->buffers.push_back( buffer );
+        return;
+    }
+
+    pos = 8 + buffer.name.size() + 1;
+    if ( pos < size )
+    {
+        buffer.clock = buf + pos;
+        pos += buffer.clock.size() + 1;
+    }
+
+    /* page size, then cpu count */
+    if ( pos + 8 > size )
+        die( handle, "%s: buffer option truncated.\n", __func__ );
+
+    memcpy( &cpus, buf + pos + 4, 4 );
+    cpus = __data2host4( handle->pevent, cpus );
+    pos += 8;
+
+    if ( pos + cpus * 20ULL > size )
+        die( handle, "%s: buffer option truncated.\n", __func__ );
+
+    for ( unsigned int i = 0; i < cpus; i++, pos += 20 )
+    {
+        buffer_cpu_t cpu_data;
+        unsigned int cpu;
+
+        memcpy( &cpu, buf + pos, 4 );
+        memcpy( &cpu_data.offset, buf + pos + 4, 8 );
+        memcpy( &cpu_data.size, buf + pos + 12, 8 );
+
+        cpu_data.cpu = __data2host4( handle->pevent, cpu );
+        cpu_data.offset = __data2host8( handle->pevent, cpu_data.offset );
+        cpu_data.size = __data2host8( handle->pevent, cpu_data.size );
+
+        buffer.cpu_data.push_back( cpu_data );
+    }
+
+    if ( buffer.name.empty() )
+        handle->top_buffer = buffer;
+    else
+        handle->buffers.push_back( buffer );
+}
 
 static int handle_options( tracecmd_input_t *handle )
 {
@@ -1196,18 +1969,27 @@ static int handle_options( tracecmd_input_t *handle )
         unsigned short option;
         unsigned long long offset;
 
-        do_read_check( handle, &option, 2 );
+        option = read2( handle );
 
-        if ( option == TRACECMD_OPTION_DONE )
+        if ( option == TRACECMD_OPTION_DONE && !has_sections( handle ) )
             break;
 
         /* next 4 bytes is the size of the option */
-        do_read_check( handle, &size, 4 );
+        size = read4( handle );
 
-        size = __data2host4( handle->pevent, size );
-        buf = ( char * )trace_malloc( handle, size );
+        buf = ( char * )trace_malloc( handle, size + 1 );
 
         do_read_check( handle, buf, size );
+        buf[ size ] = 0;
+
+        /* v7 sections: offset of the section the option describes */
+        if ( option >= TRACECMD_OPTION_HEADER_INFO && option <= TRACECMD_OPTION_CMDLINES && size >= 8 )
+        {
+            memcpy( &offset, buf, 8 );
+            handle->sections[ option ] = __data2host8( handle->pevent, offset );
+            free( buf );
+            continue;
+        }
 
         switch ( option )
         {
@@ -1235,28 +2017,34 @@ static int handle_options( tracecmd_input_t *handle )
         case TRACECMD_OPTION_CPUSTAT:
             handle->cpustats.push_back( buf );
             break;
-        case TRACECMD_OPTION_BUFFER:
+        case TRACECMD_OPTION_DONE:
         {
-            input_buffer_instance_t *buffer;
-
+            /* v7: offset of the next options section, or zero */
+            offset = 0;
+            if ( size >= 8 )
+                memcpy( &offset, buf, 8 );
+            offset = __data2host8( handle->pevent, offset );
+            free( buf );
+
+            section_end( handle );
+            if ( !offset )
+                return 0;
+
+            section_begin( handle, offset, TRACECMD_OPTION_DONE );
+            continue;
+        }
+        case TRACECMD_OPTION_BUFFER:
             /* A buffer instance is saved at the end of the file */
-            handle->nr_buffers++;
-            handle->buffers = ( input_buffer_instance_t * )trace_realloc( handle, handle->buffers,
-                                       sizeof( *handle->buffers ) * handle->nr_buffers );
-            buffer = &handle->buffers[ handle->nr_buffers - 1 ];
-            buffer->name = strdup( buf + 8 );
-            if ( !buffer->name )
-            {
-                free( handle->buffers );
-                handle->buffers = NULL;
-                return -ENOMEM;
-            }
-
-            offset = *( unsigned long long * )buf;
-            buffer->offset = __data2host8( handle->pevent, offset );
+            handle_buffer_option( handle, buf, size );
+            break;
+        case TRACECMD_OPTION_BUFFER_TEXT:
+            /* v7 latency trace */
+            handle->flags |= TRACECMD_FL_LATENCY;
             break;
-        }
         case TRACECMD_OPTION_TRACECLOCK:
+            /* v7 stores the trace_clock file here instead of after the cpu data */
+            if ( size )
+                parse_trace_clock( handle, buf );
             handle->use_trace_clock = true;
             break;
         case TRACECMD_OPTION_UNAME:
@@ -1269,6 +2057,8 @@ static int handle_options( tracecmd_input_t *handle )
         case TRACEMCD_OPTION_CPUCOUNT:
             if ( size > sizeof( uint64_t ) )
                 tracecmd_parse_tgids(handle->pevent, buf, size);
+            else if ( size == 4 && has_sections( handle ) )
+                handle->cpus = __data2host4( handle->pevent, *( unsigned int * )buf );
             break;
         case TRACECMD_OPTION_SAVED_TGIDS:
             tracecmd_parse_tgids(handle->pevent, buf, size);
@@ -1287,12 +2077,144 @@ static int handle_options( tracecmd_input_t *handle )
     return 0;
 }
 
-static void read_cpu_data( tracecmd_input_t *handle )
+static void alloc_cpu_data( tracecmd_input_t *handle )
 {
-    char buf[ 10 ];
     enum kbuffer_endian endian;
     enum kbuffer_long_size long_size;
 
+    handle->cpu_data = new ( std::nothrow ) cpu_data_t [ handle->cpus ];
+    if ( !handle->cpu_data )
+        die( handle, "%s: new cpu_data_t failed.\n", __func__ );
+
+    long_size = ( handle->long_size == 8 ) ? KBUFFER_LSIZE_8 : KBUFFER_LSIZE_4;
+
+    endian = tep_is_file_bigendian( handle->pevent ) ?
+                KBUFFER_ENDIAN_BIG : KBUFFER_ENDIAN_LITTLE;
+
+    for ( int cpu = 0; cpu < handle->cpus; cpu++ )
+    {
+        handle->cpu_data[ cpu ].kbuf = kbuffer_alloc( long_size, endian );
+        if ( !handle->cpu_data[ cpu ].kbuf )
+            die( handle, "%s: kbuffer_alloc failed.\n", __func__ );
+
+        if ( tep_is_old_format( handle->pevent ) )
+            kbuffer_set_old_format( handle->cpu_data[ cpu ].kbuf );
+    }
+}
+
+/*
+ * Compressed v7 cpu data is a chunk count followed by chunks, each
+ * with its compressed and decompressed size. Record where they are and
+ * switch the cpu over to offsets in the decompressed data.
+ */
+static void load_zchunks( tracecmd_input_t *handle, int cpu, unsigned long long offset )
+{
+    cpu_data_t *cpu_data = &handle->cpu_data[ cpu ];
+    unsigned long long size = 0;
+    unsigned int count;
+
+    if ( !read_at( handle->fd, &count, 4, offset ) )
+        die( handle, "%s: failed to read cpu %d chunk count.\n", __func__, cpu );
+
+    count = __data2host4( handle->pevent, count );
+    offset += 4;
+
+    // Every chunk has at least its 8 byte header
+    if ( ( offset > handle->total_file_size ) || ( count > ( handle->total_file_size - offset ) / 8 ) )
+        die( handle, "%s: cpu %d chunk count %u is past the end of the file.\n", __func__, cpu, count );
+
+    cpu_data->zchunks.resize( count );
+    for ( zchunk_t &chunk : cpu_data->zchunks )
+    {
+        unsigned int sizes[ 2 ];
+
+        if ( !read_at( handle->fd, sizes, sizeof( sizes ), offset ) )
+            die( handle, "%s: failed to read cpu %d chunk header.\n", __func__, cpu );
+
+        chunk.zoffset = offset + sizeof( sizes );
+        chunk.zsize = __data2host4( handle->pevent, sizes[ 0 ] );
+        chunk.offset = size;
+        chunk.size = __data2host4( handle->pevent, sizes[ 1 ] );
+
+        offset = chunk.zoffset + chunk.zsize;
+        size += chunk.size;
+
+        if ( offset > handle->total_file_size )
+        {
+            die( handle, "%s: File possibly truncated. "
+                    "Need at least %llu, but file size is %zu.\n",
+                    __func__, offset, handle->total_file_size );
+        }
+    }
+
+    cpu_data->file_offset = 0;
+    cpu_data->file_size = size;
+}
+
+static void set_cpu_data( tracecmd_input_t *handle, int cpu,
+                          unsigned long long offset, unsigned long long size )
+{
+    handle->cpu_data[ cpu ].file_offset = offset;
+    handle->cpu_data[ cpu ].file_size = size;
+
+    if ( size && ( offset + size > handle->total_file_size ) )
+    {
+        /* this happens if the file got truncated */
+        die( handle, "%s: File possibly truncated. "
+                "Need at least %llu, but file size is %zu.\n",
+                __func__, offset + size, handle->total_file_size );
+    }
+
+    if ( size && handle->compressed )
+        load_zchunks( handle, cpu, offset );
+
+    if ( init_cpu( handle, cpu ) < 0 )
+        die( handle, "%s: init_cpu failed.\n", __func__ );
+}
+
+/*
+ * v7 buffer cpu data locations come from the buffer option. The flyrecord
+ * section header says whether the data is compressed.
+ */
+static void read_buffer_cpu_data( tracecmd_input_t *handle, const input_buffer_instance_t &buffer )
+{
+    unsigned short flags = read_section_header( handle, buffer.offset, TRACECMD_OPTION_BUFFER );
+
+    handle->compressed = !!( flags & TRACECMD_SEC_FL_COMPRESS );
+    if ( handle->compressed && ( handle->compression == TRACECMD_COMPRESS_NONE ) )
+        die( handle, "%s: compressed cpu data without a compression algorithm.\n", __func__ );
+
+#ifndef WIN32
+    // Decompress chunks ahead of the cpu readers
+    if ( handle->compressed && !handle->zworkers )
+        handle->zworkers = get_zchunk_workers();
+#endif
+
+    alloc_cpu_data( handle );
+
+    for ( int cpu = 0; cpu < handle->cpus; cpu++ )
+    {
+        unsigned long long size = 0;
+        unsigned long long offset = 0;
+
+        for ( const buffer_cpu_t &cpu_data : buffer.cpu_data )
+        {
+            if ( cpu_data.cpu == cpu )
+            {
+                offset = cpu_data.offset;
+                size = cpu_data.size;
+                break;
+            }
+        }
+
+        set_cpu_data( handle, cpu, offset, size );
+    }
+}
+
+static void read_cpu_data( tracecmd_input_t *handle )
+{
+    char buf[ 10 ];
+
     do_read_check( handle, buf, 10 );
 
     // check if this handles options
@@ -1315,43 +2237,14 @@ static void read_cpu_data( tracecmd_input_t *handle )
     if ( strncmp( buf, "flyrecord", 9 ) != 0 )
         die( handle, "%s: flyrecord not found.\n", __func__ );
 
-    handle->cpu_data = new ( std::nothrow ) cpu_data_t [ handle->cpus ];
-    if ( !handle->cpu_data )
-        die( handle, "%s: new cpu_data_t failed.\n", __func__ );
-
-    long_size = ( handle->long_size == 8 ) ? KBUFFER_LSIZE_8 : KBUFFER_LSIZE_4;
-
-    endian = tep_is_file_bigendian( handle->pevent ) ?
-                KBUFFER_ENDIAN_BIG : KBUFFER_ENDIAN_LITTLE;
+    alloc_cpu_data( handle );
 
     for ( int cpu = 0; cpu < handle->cpus; cpu++ )
     {
-        unsigned long long size;
-        unsigned long long offset;
-
-        handle->cpu_data[ cpu ].kbuf = kbuffer_alloc( long_size, endian );
-        if ( !handle->cpu_data[ cpu ].kbuf )
-            die( handle, "%s: kbuffer_alloc failed.\n", __func__ );
-
-        if ( tep_is_old_format( handle->pevent ) )
-            kbuffer_set_old_format( handle->cpu_data[ cpu ].kbuf );
-
-        offset = read8( handle );
-        size = read8( handle );
-
-        handle->cpu_data[ cpu ].file_offset = offset;
-        handle->cpu_data[ cpu ].file_size = size;
-
-        if ( size && ( offset + size > handle->total_file_size ) )
-        {
-            /* this happens if the file got truncated */
-            die( handle, "%s: File possibly truncated. "
-                    "Need at least %llu, but file size is %zu.\n",
-                    __func__, offset + size, handle->total_file_size );
-        }
+        unsigned long long offset = read8( handle );
+        unsigned long long size = read8( handle );
 
-        if ( init_cpu( handle, cpu ) < 0 )
-            die( handle, "%s: init_cpu failed.\n", __func__ );
+        set_cpu_data( handle, cpu, offset, size );
     }
 }
 
@@ -1375,10 +2268,44 @@ static int read_and_parse_trace_clock( tracecmd_input_t *handle )
  * This prepares reading the data from trace.dat. This is called
  * after tracecmd_read_headers() and before tracecmd_read_data().
  */
+static void tracecmd_init_data_v7( tracecmd_input_t *handle )
+{
+    int cpus = handle->cpus;
+
+    if ( handle->flags & TRACECMD_FL_LATENCY )
+        return;
+
+    if ( handle->top_buffer.cpu_data.empty() && !handle->top_buffer.offset )
+        die( handle, "%s: flyrecord not found.\n", __func__ );
+
+    // Buffer instances get the same number of cpus as the top buffer
+    for ( const buffer_cpu_t &cpu_data : handle->top_buffer.cpu_data )
+        cpus = std::max( cpus, cpu_data.cpu + 1 );
+    for ( const input_buffer_instance_t &buffer : handle->buffers )
+    {
+        for ( const buffer_cpu_t &cpu_data : buffer.cpu_data )
+            cpus = std::max( cpus, cpu_data.cpu + 1 );
+    }
+
+    handle->cpus = cpus;
+    tep_set_cpus( handle->pevent, cpus );
+
+    if ( handle->trace_clock.empty() )
+        handle->trace_clock = handle->top_buffer.clock;
+
+    read_buffer_cpu_data( handle, handle->top_buffer );
+}
+
 void tracecmd_init_data( tracecmd_input_t *handle )
 {
     pevent_t *pevent = handle->pevent;
 
+    if ( has_sections( handle ) )
+    {
+        tracecmd_init_data_v7( handle );
+        return;
+    }
+
     handle->cpus = read4( handle );
 
     tep_set_cpus( pevent, handle->cpus );
@@ -1439,6 +2366,7 @@ static void tracecmd_alloc_fd( tracecmd_input_t *handle, const char *file, int f
     if ( !version )
         die( handle, "[Error] %s: failed to read version string.\n", __func__ );
 
+    handle->file_version = strtol( version, NULL, 10 );
     free( version );
 
     do_read_check( handle, buf, 1 );
@@ -1455,6 +2383,29 @@ static void tracecmd_alloc_fd( tracecmd_input_t *handle, const char *file, int f
 
     handle->page_size = read4( handle );
 
+    if ( has_sections( handle ) )
+    {
+        char *name = read_string( handle );
+        char *compression_version = read_string( handle );
+
+        if ( !name || !compression_version )
+            die( handle, "[Error] %s: failed to read compression strings.\n", __func__ );
+
+        if ( !strcmp( name, "zlib" ) )
+            handle->compression = TRACECMD_COMPRESS_ZLIB;
+#ifdef USE_ZSTD
+        else if ( !strcmp( name, "zstd" ) )
+            handle->compression = TRACECMD_COMPRESS_ZSTD;
+#endif
+        else if ( strcmp( name, "none" ) )
+            die( handle, "[Error] %s: unsupported compression \"%s\".\n", __func__, name );
+
+        free( name );
+        free( compression_version );
+
+        handle->options_start = read8( handle );
+    }
+
     handle->header_files_start = lseek64( handle->fd, 0, SEEK_CUR );
     handle->total_file_size = lseek64( handle->fd, 0, SEEK_END );
     handle->header_files_start = lseek64( handle->fd, handle->header_files_start, SEEK_SET );
@@ -1514,6 +2465,13 @@ static void tracecmd_close( tracecmd_input_t *handle )
         free_next( handle, cpu );
         free_page( handle, cpu );
 
+        /* Chunks still being read ahead use our fd */
+        if ( handle->cpu_data )
+        {
+            for ( const std::shared_ptr< zchunk_data_t > &chunk : handle->cpu_data[ cpu ].zcache )
+                chunk->ready.wait();
+        }
+
         if ( handle->cpu_data && handle->cpu_data[ cpu ].kbuf )
         {
             kbuffer_free( handle->cpu_data[ cpu ].kbuf );
@@ -1522,6 +2480,11 @@ static void tracecmd_close( tracecmd_input_t *handle )
             if ( !handle->cpu_data[ cpu ].pages.empty() )
                 die( handle, "%s: pages still allocated on cpu %d\n", __func__, cpu );
         }
+
+#ifdef USE_MMAP
+        if ( handle->cpu_data )
+            unmap_cpu_data( handle, cpu );
+#endif
     }
 
     if ( handle->fd >= 0 )
@@ -1548,13 +2511,15 @@ static void tracecmd_close( tracecmd_input_t *handle )
 static tracecmd_input_t *tracecmd_buffer_instance_handle( tracecmd_input_t *handle, int indx )
 {
     tracecmd_input_t *new_handle;
-    input_buffer_instance_t *buffer = &handle->buffers[ indx ];
+    input_buffer_instance_t *buffer;
     size_t offset;
     ssize_t ret;
 
-    if ( indx >= handle->nr_buffers )
+    if ( ( size_t )indx >= handle->buffers.size() )
         return NULL;
 
+    buffer = &handle->buffers[ indx ];
+
     /*
 	 * We make a copy of the current handle, but we substitute
 	 * the cpu data with the cpu data for this buffer.
@@ -1563,8 +2528,7 @@ static tracecmd_input_t *tracecmd_buffer_instance_handle( tracecmd_input_t *hand
 
     *new_handle = *handle;
     new_handle->cpu_data = NULL;
-    new_handle->nr_buffers = 0;
-    new_handle->buffers = NULL;
+    new_handle->buffers.clear();
     new_handle->ref = 1;
     new_handle->parent = handle;
 
@@ -1574,6 +2538,12 @@ static tracecmd_input_t *tracecmd_buffer_instance_handle( tracecmd_input_t *hand
 
     new_handle->flags |= TRACECMD_FL_BUFFER_INSTANCE;
 
+    if ( has_sections( handle ) )
+    {
+        read_buffer_cpu_data( new_handle, *buffer );
+        return new_handle;
+    }
+
     /* Save where we currently are */
     offset = lseek64( handle->fd, 0, SEEK_CUR );
 
@@ -1581,7 +2551,7 @@ static tracecmd_input_t *tracecmd_buffer_instance_handle( tracecmd_input_t *hand
     if ( ret < 0 )
     {
         die( handle, "%s: could not seek to buffer %s offset %lu.\n",
-                 __func__, buffer->name, buffer->offset );
+                 __func__, buffer->name.c_str(), buffer->offset );
     }
 
     read_cpu_data( new_handle );
@@ -1613,11 +2583,173 @@ static bool is_timestamp_in_us( const std::string& trace_clock, bool use_trace_c
 extern "C" void print_str_arg( struct trace_seq *s, void *data, int size,
                                struct tep_event *event, const char *format,
                                int len_arg, struct tep_print_arg *arg );
+extern "C" void tep_init_lazy_maps( struct tep_handle *tep );
 
-class trace_data_t
+// raw_event_format_t::int_flags
+enum field_int_flags_t
 {
-public:
-    trace_data_t( EventCallback &_cb, trace_info_t &_trace_info, StrPool &_strpool ) :
+    FIELD_INT = 0x1,            // Integer field we can read from the record data
+    FIELD_INT_SIGNED = 0x2,     // Sign extend value
+    FIELD_INT_DECIMAL = 0x4,    // Field renders as a plain decimal number
+};
+
+// Field formats for one tep_event, indexed the same as trace_event_t::fields
+struct raw_event_format_t
+{
+    raw_fields_t *raw_fields = nullptr;
+    const char *system = nullptr;
+    const char *name = nullptr;
+    bool is_ftrace_function = false;
+    std::vector< tep_format_field * > formats;
+    std::vector< uint8_t > int_flags;
+};
+
+// Figure out how tep_print_field() will render an integer field. Mirrors
+//  print_field(): use the print fmt conversion for the field if there is one,
+//  otherwise print_field_raw() which prints pointers and longs in hex.
+static uint8_t get_field_int_flags( tep_format_field *format, bool is_ftrace_function )
+{
+    if ( format->flags & ( TEP_FIELD_IS_ARRAY | TEP_FIELD_IS_STRING ) )
+        return 0;
+    if ( ( format->size != 1 ) && ( format->size != 2 ) &&
+         ( format->size != 4 ) && ( format->size != 8 ) )
+        return 0;
+
+    uint8_t flags = FIELD_INT;
+
+    if ( format->flags & TEP_FIELD_IS_SIGNED )
+        flags |= FIELD_INT_SIGNED;
+
+    // ftrace:function ip fields get the function name appended
+    if ( is_ftrace_function &&
+         ( !strcmp( format->name, "ip" ) || !strcmp( format->name, "parent_ip" ) ) )
+        return flags;
+
+    tep_event *event = format->event;
+    tep_print_parse *parse = event->print_fmt.print_cache;
+
+    if ( parse && !( event->flags & TEP_EVENT_FL_FAILED ) )
+    {
+        bool has_0x = false;
+
+        for ( ; parse; parse = parse->next )
+        {
+            if ( parse->type == PRINT_FMT_STRING )
+            {
+                size_t len = strlen( parse->format );
+
+                has_0x = ( len > 1 ) && !strcmp( parse->format + len - 2, "0x" );
+                continue;
+            }
+
+            if ( parse->arg &&
+                 ( parse->arg->type == TEP_PRINT_FIELD ) &&
+                 ( parse->arg->field.field == format ) )
+            {
+                size_t len = strlen( parse->format );
+                char conv = len ? parse->format[ len - 1 ] : 0;
+
+                if ( has_0x || ( parse->type != PRINT_FMT_ARG_DIGIT ) || !strchr( "diu", conv ) )
+                    return flags;
+
+                // Sign comes from the conversion, not the field type
+                if ( conv == 'u' )
+                    return FIELD_INT | FIELD_INT_DECIMAL;
+                return FIELD_INT | FIELD_INT_SIGNED | FIELD_INT_DECIMAL;
+            }
+
+            has_0x = false;
+        }
+    }
+
+    if ( format->flags & TEP_FIELD_IS_POINTER )
+        return flags;
+    if ( format->flags & TEP_FIELD_IS_LONG )
+    {
+        // Signed 4 byte and unsigned longs print as hex
+        if ( !( format->flags & TEP_FIELD_IS_SIGNED ) || ( format->size == 4 ) )
+            return flags;
+    }
+
+    return flags | FIELD_INT_DECIMAL;
+}
+
+// Everything lazy_fields events need to render their field values after the
+//  trace file has been closed: event formats, record data, and the strpool.
+struct raw_fields_t
+{
+    explicit raw_fields_t( StrPool &_strpool ) : strpool( _strpool ) {}
+
+    ~raw_fields_t()
+    {
+        for ( tep_handle *pevent : pevents )
+            tep_free( pevent );
+    }
+
+    void add_pevent( tep_handle *pevent )
+    {
+        tep_ref( pevent );
+        pevents.push_back( pevent );
+
+        // Fields get rendered from several threads, so build lazy tables now
+        tep_init_lazy_maps( pevent );
+
+        for ( int i = 0; i < pevent->nr_events; i++ )
+        {
+            tep_event *event = pevent->events[ i ];
+
+            event_formats.emplace_back();
+
+            raw_event_format_t &raw_format = event_formats.back();
+
+            raw_format.raw_fields = this;
+            raw_format.system = strpool.getstr( event->system );
+            raw_format.name = strpool.getstr( event->name );
+            raw_format.is_ftrace_function = !strcmp( "ftrace", event->system ) && !strcmp( "function", event->name );
+
+            for ( tep_format_field *format = event->format.fields; format; format = format->next )
+            {
+                raw_format.formats.push_back( format );
+                raw_format.int_flags.push_back( get_field_int_flags( format, raw_format.is_ftrace_function ) );
+            }
+
+            formats.set_val( event, &raw_format );
+        }
+    }
+
+    StrAlloc *new_alloc()
+    {
+        allocs.emplace_back();
+        return &allocs.back();
+    }
+
+    StrPool &strpool;
+
+    std::vector< tep_handle * > pevents;
+    std::deque< raw_event_format_t > event_formats;
+    util_umap< const tep_event *, raw_event_format_t * > formats;
+
+    // Copies of record data for lazy events
+    std::deque< StrAlloc > allocs;
+    // Record data for events read from the event cache
+    StrAlloc *cache_alloc = nullptr;
+};
+
+// Event type and flags for one tep_event, resolved before reading records
+struct event_format_info_t
+{
+    trace_event_type_t type = TRACE_EVENT_Unknown;
+    uint32_t type_flags = 0;
+
+    bool is_ftrace_function = false;
+    bool is_printk_function = false;
+    bool is_gpuvis_function = false;
+};
+
+class trace_data_t
+{
+public:
+    trace_data_t( EventCallback &_cb, trace_info_t &_trace_info, StrPool &_strpool ) :
         cb( _cb ), trace_info( _trace_info ), strpool( _strpool )
     {
         seqno_str = strpool.getstr( "seqno" );
@@ -1630,7 +2762,6 @@ public:
         gpuvis_system_str = strpool.getstr( "gpuvis" );
         ftrace_function_str = strpool.getstr( "ftrace-function" );
         drm_vblank_event_str = strpool.getstr( "drm_vblank_event" );
-        sched_switch_str = strpool.getstr( "sched_switch" );
         time_str = strpool.getstr( "time" );
         high_prec_str = strpool.getstr( "high_prec" );
     }
@@ -1640,6 +2771,13 @@ public:
     trace_info_t &trace_info;
     StrPool &strpool;
 
+    // Set when field values are rendered on demand (trace_info_t::lazy_fields)
+    raw_fields_t *raw_fields = nullptr;
+    StrAlloc *raw_alloc = nullptr;
+
+    // tep_event -> type and flags, filled before records are read
+    util_umap< const tep_event *, event_format_info_t > *format_infos = nullptr;
+
     const char *seqno_str;
     const char *crtc_str;
     const char *ip_str;
@@ -1650,12 +2788,114 @@ public:
     const char *gpuvis_system_str;
     const char *ftrace_function_str;
     const char *drm_vblank_event_str;
-    const char *sched_switch_str;
     const char *time_str;
     const char *high_prec_str;
 };
 
-static void init_event_flags( trace_data_t &trace_data, trace_event_t &event )
+trace_event_type_t get_trace_event_type( const char *system, const char *name )
+{
+    static const struct
+    {
+        const char *name;
+        trace_event_type_t type;
+    } s_types[] =
+    {
+        { "sched_switch", TRACE_EVENT_sched_switch },
+        { "sched_process_exec", TRACE_EVENT_sched_process_exec },
+        { "sched_process_exit", TRACE_EVENT_sched_process_exit },
+        { "sched_process_fork", TRACE_EVENT_sched_process_fork },
+        { "psci_domain_idle_enter", TRACE_EVENT_psci_domain_idle_enter },
+        { "psci_domain_idle_exit", TRACE_EVENT_psci_domain_idle_exit },
+        { "drm_vblank_event", TRACE_EVENT_drm_vblank_event },
+        { "drm_vblank_event_queued", TRACE_EVENT_drm_vblank_event_queued },
+        { "amdgpu_cs_ioctl", TRACE_EVENT_amdgpu_cs_ioctl },
+        { "amdgpu_sched_run_job", TRACE_EVENT_amdgpu_sched_run_job },
+        { "amdgpu_job_msg", TRACE_EVENT_amdgpu_job_msg },
+        { "drm_sched_job", TRACE_EVENT_drm_sched_job },
+        { "drm_run_job", TRACE_EVENT_drm_run_job },
+        { "drm_sched_process_job", TRACE_EVENT_drm_sched_process_job },
+        { "msm_gpu_submit", TRACE_EVENT_msm_gpu_submit },
+        { "msm_gpu_submit_flush", TRACE_EVENT_msm_gpu_submit_flush },
+        { "msm_gpu_submit_retired", TRACE_EVENT_msm_gpu_submit_retired },
+        { "msm_gpu_preemption_trigger", TRACE_EVENT_msm_gpu_preemption_trigger },
+        { "msm_gpu_preemption_irq", TRACE_EVENT_msm_gpu_preemption_irq },
+        { "msm_gpu_freq_change", TRACE_EVENT_msm_gpu_freq_change },
+        { "intel_engine_notify", TRACE_EVENT_intel_engine_notify },
+    };
+    static const struct
+    {
+        const char *suffix;
+        trace_event_type_t type;
+    } s_i915_types[] =
+    {
+        { "_request_queue", TRACE_EVENT_i915_request_queue },
+        { "_request_add", TRACE_EVENT_i915_request_add },
+        { "_request_submit", TRACE_EVENT_i915_request_submit },
+        { "_request_in", TRACE_EVENT_i915_request_in },
+        { "_request_out", TRACE_EVENT_i915_request_out },
+        { "_request_wait_begin", TRACE_EVENT_i915_request_wait_begin },
+        { "_request_wait_end", TRACE_EVENT_i915_request_wait_end },
+    };
+
+    // ftrace function events get renamed to the traced function
+    if ( !name || ( system && !strcmp( system, "ftrace" ) ) )
+        return TRACE_EVENT_Unknown;
+
+    for ( const auto &it : s_types )
+    {
+        if ( !strcmp( name, it.name ) )
+            return it.type;
+    }
+
+    // fence_signaled was renamed to dma_fence_signaled post v4.9
+    if ( strstr( name, "fence_signaled" ) )
+        return TRACE_EVENT_fence_signaled;
+
+    if ( !strncmp( name, "i915_", 5 ) )
+    {
+        for ( const auto &it : s_i915_types )
+        {
+            if ( strstr( name, it.suffix ) )
+                return it.type;
+        }
+    }
+
+    return TRACE_EVENT_Unknown;
+}
+
+uint32_t get_trace_event_type_flags( trace_event_type_t type )
+{
+    switch ( type )
+    {
+    case TRACE_EVENT_drm_vblank_event:
+        return TRACE_FLAG_VBLANK;
+    case TRACE_EVENT_sched_switch:
+        return TRACE_FLAG_SCHED_SWITCH;
+    case TRACE_EVENT_fence_signaled:
+        return TRACE_FLAG_FENCE_SIGNALED;
+    case TRACE_EVENT_amdgpu_cs_ioctl:
+        return TRACE_FLAG_SW_QUEUE;
+    case TRACE_EVENT_amdgpu_sched_run_job:
+        return TRACE_FLAG_HW_QUEUE;
+    default:
+        return 0;
+    }
+}
+
+static event_format_info_t get_event_format_info( const tep_event *event )
+{
+    event_format_info_t info;
+
+    info.type = get_trace_event_type( event->system, event->name );
+    info.type_flags = get_trace_event_type_flags( info.type );
+    info.is_ftrace_function = !strcmp( "ftrace", event->system ) && !strcmp( "function", event->name );
+    info.is_printk_function = !strcmp( "ftrace", event->system ) && !strcmp( "print", event->name );
+    info.is_gpuvis_function = !strcmp( "gpuvis", event->system );
+    return info;
+}
+
+static void init_event_flags( trace_data_t &trace_data, trace_event_t &event,
+                              const event_format_info_t &info )
 {
     // Make sure our event type bits are cleared
     event.flags &= ~( TRACE_FLAG_FENCE_SIGNALED |
@@ -1669,21 +2909,229 @@ static void init_event_flags( trace_data_t &trace_data, trace_event_t &event )
                       TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING |
                       TRACE_FLAG_AUTOGEN_COLOR );
 
-    // fence_signaled was renamed to dma_fence_signaled post v4.9
+    event.type = TRACE_EVENT_Unknown;
+
     if ( event.system == trace_data.ftrace_print_str )
         event.flags |= TRACE_FLAG_FTRACE_PRINT;
     if ( event.system == trace_data.gpuvis_system_str )
+    {
         event.flags |= TRACE_FLAG_GPUVIS_PRINT;
-    else if ( event.name == trace_data.drm_vblank_event_str )
-        event.flags |= TRACE_FLAG_VBLANK;
-    else if ( event.name == trace_data.sched_switch_str )
-        event.flags |= TRACE_FLAG_SCHED_SWITCH;
-    else if ( strstr( event.name, "fence_signaled" ) )
-        event.flags |= TRACE_FLAG_FENCE_SIGNALED;
-    else if ( strstr( event.name, "amdgpu_cs_ioctl" ) )
-        event.flags |= TRACE_FLAG_SW_QUEUE;
-    else if ( strstr( event.name, "amdgpu_sched_run_job" ) )
-        event.flags |= TRACE_FLAG_HW_QUEUE;
+    }
+    else
+    {
+        event.type = info.type;
+        event.flags |= info.type_flags;
+    }
+}
+
+// Trim trailing whitespace from seq and add it to strpool
+static const char *intern_seq( StrPool &strpool, struct trace_seq *seq )
+{
+    while ( ( seq->len > 0 ) &&
+            isspace( (unsigned char)seq->buffer[ seq->len - 1 ] ) )
+    {
+        seq->len--;
+    }
+
+    trace_seq_terminate( seq );
+
+    return strpool.getstr( seq->buffer, seq->len );
+}
+
+static const char *print_event_field( StrPool &strpool, struct trace_seq *seq, void *data,
+                                      tep_format_field *format, bool is_ftrace_function )
+{
+    trace_seq_reset( seq );
+    tep_print_field( seq, data, format );
+
+    if ( is_ftrace_function &&
+         ( !strcmp( format->name, "ip" ) || !strcmp( format->name, "parent_ip" ) ) )
+    {
+        tep_handle *pevent = format->event->tep;
+        unsigned long long val = tep_read_number( pevent,
+                ( char * )data + format->offset, format->size );
+        const char *func = tep_find_function( pevent, val );
+
+        if ( func )
+            trace_seq_printf( seq, " (%s)", func );
+    }
+
+    return intern_seq( strpool, seq );
+}
+
+// Copy record data with its size in front of it for get_event_raw_size()
+static const void *alloc_raw_record( StrAlloc &alloc, const void *data, uint32_t size )
+{
+    char *raw_data = alloc.allocmem( sizeof( size ) + size );
+
+    memcpy( raw_data, &size, sizeof( size ) );
+    memcpy( raw_data + sizeof( size ), data, size );
+    return raw_data + sizeof( size );
+}
+
+uint32_t get_event_raw_size( const trace_event_t &event )
+{
+    uint32_t size = 0;
+
+    if ( event.raw_data )
+        memcpy( &size, ( const char * )event.raw_data - sizeof( size ), sizeof( size ) );
+    return size;
+}
+
+void get_raw_event_format_name( const raw_event_format_t *raw_format, const char **system, const char **name )
+{
+    *system = raw_format->system;
+    *name = raw_format->name;
+}
+
+const raw_event_format_t *find_raw_event_format( const trace_info_t &trace_info, const char *system, const char *name )
+{
+    if ( trace_info.raw_fields )
+    {
+        for ( const raw_event_format_t &raw_format : trace_info.raw_fields->event_formats )
+        {
+            if ( !strcmp( raw_format.system, system ) && !strcmp( raw_format.name, name ) )
+                return &raw_format;
+        }
+    }
+
+    return NULL;
+}
+
+uint32_t get_raw_event_format_numfields( const raw_event_format_t *raw_format )
+{
+    return raw_format->formats.size();
+}
+
+void set_event_raw_record( trace_event_t &event, const raw_event_format_t *raw_format,
+                           const void *data, uint32_t size )
+{
+    raw_fields_t *raw_fields = raw_format->raw_fields;
+
+    if ( !raw_fields->cache_alloc )
+        raw_fields->cache_alloc = raw_fields->new_alloc();
+
+    event.raw_format = raw_format;
+    event.raw_data = alloc_raw_record( *raw_fields->cache_alloc, data, size );
+}
+
+// Scratch trace_seq for each thread rendering lazy fields
+struct render_seq_t
+{
+    render_seq_t()  { trace_seq_init( &seq ); }
+    ~render_seq_t() { trace_seq_destroy( &seq ); }
+
+    struct trace_seq seq;
+};
+
+const char *render_event_field( const trace_event_t &event, uint32_t index )
+{
+    const raw_event_format_t *raw_format = event.raw_format;
+    raw_fields_t *raw_fields = raw_format->raw_fields;
+    event_field_t &field = event.fields[ index ];
+    const char *value = field.value.load( std::memory_order_acquire );
+
+    if ( !value )
+    {
+        // Threads racing on one field intern the same string, so either store wins
+        static thread_local render_seq_t render_seq;
+
+        value = print_event_field( raw_fields->strpool, &render_seq.seq, ( void * )event.raw_data,
+                                   raw_format->formats[ index ], raw_format->is_ftrace_function );
+        field.value.store( value, std::memory_order_release );
+    }
+
+    return value;
+}
+
+event_field_slot_t::event_field_slot_t( const char *key ) : m_key( key )
+{
+    for ( size_t i = 0; i < NUM_HINTS; i++ )
+        m_hints[ i ].store( 0, std::memory_order_relaxed );
+}
+
+int event_field_slot_t::find( const trace_event_t &event ) const
+{
+    uint64_t name = ( uintptr_t )event.name;
+    std::atomic< uint64_t > &hint = m_hints[ ( name >> 4 ) % NUM_HINTS ];
+    uint64_t val = hint.load( std::memory_order_relaxed );
+
+    if ( ( val >> 8 ) == name )
+    {
+        uint32_t slot = val & 0xff;
+
+        if ( ( slot < event.numfields ) && !strcmp( event.fields[ slot ].key, m_key ) )
+            return slot;
+    }
+
+    for ( uint32_t i = 0; i < event.numfields; i++ )
+    {
+        if ( !strcmp( event.fields[ i ].key, m_key ) )
+        {
+            if ( i < 0xff )
+                hint.store( ( name << 8 ) | i, std::memory_order_relaxed );
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+const char *event_field_slot_t::get_val( const trace_event_t &event, const char *defval ) const
+{
+    int slot = find( event );
+
+    return ( slot >= 0 ) ? event.get_field_val( slot ) : defval;
+}
+
+int64_t event_field_slot_t::get_int( const trace_event_t &event, int64_t defval ) const
+{
+    int64_t val;
+    int slot = find( event );
+
+    if ( slot < 0 )
+        return defval;
+
+    if ( get_event_field_int( event, slot, val ) )
+        return val;
+
+    return strtoll( event.get_field_val( slot ), NULL, 0 );
+}
+
+bool get_event_field_int( const trace_event_t &event, uint32_t index, int64_t &val, bool decimal_only )
+{
+    const raw_event_format_t *raw_format = event.raw_format;
+
+    if ( !raw_format || ( index >= raw_format->int_flags.size() ) )
+        return false;
+
+    uint8_t flags = raw_format->int_flags[ index ];
+    uint8_t want = decimal_only ? ( FIELD_INT | FIELD_INT_DECIMAL ) : FIELD_INT;
+
+    if ( ( flags & want ) != want )
+        return false;
+
+    tep_format_field *format = raw_format->formats[ index ];
+    unsigned long long num = tep_read_number( format->event->tep,
+            ( const char * )event.raw_data + format->offset, format->size );
+
+    if ( flags & FIELD_INT_SIGNED )
+    {
+        switch ( format->size )
+        {
+        case 1: val = ( int8_t )num; return true;
+        case 2: val = ( int16_t )num; return true;
+        case 4: val = ( int32_t )num; return true;
+        }
+    }
+    else if ( decimal_only && ( num > INT64_MAX ) )
+    {
+        // Would render as a different number than "%lld"
+        return false;
+    }
+
+    val = ( int64_t )num;
+    return true;
 }
 
 static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle, pevent_record_t *record )
@@ -1693,7 +3141,8 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
     pevent_t *pevent = handle->pevent;
     StrPool &strpool = trace_data.strpool;
 
-    event = tep_find_event_by_record( pevent, record );
+    // Skip the tep last_event cache: cpu buffers can be decoded on several threads
+    event = tep_find_event_nocache( pevent, tep_data_type( pevent, record ) );
     if ( event )
     {
         struct trace_seq seq;
@@ -1701,9 +3150,12 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
         struct tep_format_field *format;
         int pid = tep_data_pid( pevent, record );
         const char *comm = tep_data_comm_from_pid( pevent, pid );
-        bool is_ftrace_function = !strcmp( "ftrace", event->system ) && !strcmp( "function", event->name );
-        bool is_printk_function = !strcmp( "ftrace", event->system ) && !strcmp( "print", event->name );
-        bool is_gpuvis_function = !strcmp( "gpuvis", event->system );
+        event_format_info_t *pinfo = trace_data.format_infos ?
+                    trace_data.format_infos->get_val( event ) : NULL;
+        const event_format_info_t info = pinfo ? *pinfo : get_event_format_info( event );
+        bool is_ftrace_function = info.is_ftrace_function;
+        bool is_printk_function = info.is_printk_function;
+        bool is_gpuvis_function = info.is_gpuvis_function;
 
         trace_seq_init( &seq );
 
@@ -1745,13 +3197,26 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
             }
         }
 
+        raw_event_format_t *raw_format = NULL;
+
+        if ( trace_data.raw_fields )
+        {
+            raw_event_format_t **praw_format = trace_data.raw_fields->formats.get_val( event );
+
+            if ( praw_format )
+            {
+                raw_format = *praw_format;
+                trace_event.raw_format = raw_format;
+                trace_event.raw_data = alloc_raw_record( *trace_data.raw_alloc, record->data, record->size );
+            }
+        }
+
         format = event->format.fields;
         for ( ; format; format = format->next )
         {
+            const char *value = NULL;
             const char *format_name = strpool.getstr( format->name );
 
-            trace_seq_reset( &seq );
-
             if ( is_printk_function && ( format_name == trace_data.buf_str ) )
             {
                 struct tep_print_arg *args = event->print_fmt.args;
@@ -1761,6 +3226,7 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
                 if ( args->type != TEP_PRINT_FIELD )
                     args = args->next;
 
+                trace_seq_reset( &seq );
                 print_str_arg( &seq, record->data, record->size,
                                event, "%s", -1, args );
 
@@ -1775,11 +3241,11 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
                     if ( seq.buffer[ i ] == '\n' )
                         seq.buffer[ i ] = ' ';
                 }
+
+                value = intern_seq( strpool, &seq );
             }
             else
             {
-                tep_print_field( &seq, record->data, format );
-
                 if ( format_name == trace_data.seqno_str )
                 {
                     unsigned long long val = tep_read_number( pevent,
@@ -1818,43 +3284,28 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
 
                     trace_event.vblank_ts_high_prec = val != 0;
                 }
-                else if ( is_ftrace_function )
+                else if ( is_ftrace_function && ( format_name == trace_data.ip_str ) )
                 {
-                    bool is_ip = ( format_name == trace_data.ip_str );
+                    unsigned long long val = tep_read_number( pevent,
+                            ( char * )record->data + format->offset, format->size );
+                    const char *func = tep_find_function( pevent, val );
 
-                    if ( is_ip || ( format_name == trace_data.parent_ip_str ) )
+                    if ( func )
                     {
-                        unsigned long long val = tep_read_number( pevent,
-                                ( char * )record->data + format->offset, format->size );
-                        const char *func = tep_find_function( pevent, val );
-
-                        if ( func )
-                        {
-                            trace_seq_printf( &seq, " (%s)", func );
-
-                            if ( is_ip )
-                            {
-                                // If this is a ftrace:function event, set the name
-                                //  to be the function name we just found.
-                                trace_event.system = trace_data.ftrace_function_str;
-                                trace_event.name = strpool.getstr( func );
-                            }
-                        }
+                        // If this is a ftrace:function event, set the name
+                        //  to be the function name we just found.
+                        trace_event.system = trace_data.ftrace_function_str;
+                        trace_event.name = strpool.getstr( func );
                     }
                 }
-            }
 
-            // Trim trailing whitespace
-            while ( ( seq.len > 0 ) &&
-                    isspace( (unsigned char)seq.buffer[ seq.len - 1 ] ) )
-            {
-                seq.len--;
+                // Lazy events get their field values rendered by render_event_field()
+                if ( !raw_format )
+                    value = print_event_field( strpool, &seq, record->data, format, is_ftrace_function );
             }
 
-            trace_seq_terminate( &seq );
-
             trace_event.fields[ trace_event.numfields ].key = format_name;
-            trace_event.fields[ trace_event.numfields ].value = strpool.getstr( seq.buffer, seq.len );
+            trace_event.fields[ trace_event.numfields ].value = value;
             trace_event.numfields++;
         }
 
@@ -1868,7 +3319,7 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
             trace_event.numfields++;
         }
 
-        init_event_flags( trace_data, trace_event );
+        init_event_flags( trace_data, trace_event, info );
 
         ret = trace_data.cb( trace_event );
 
@@ -1919,6 +3370,91 @@ void tgid_info_t::add_pid( int pid )
     }
 }
 
+void load_preview_t::init( const std::vector< std::string > &streams, uint32_t cpus, int64_t start_ts, bool ordered )
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    uint32_t numrows = streams.size() * cpus;
+
+    m_rows.reset( new row_t[ numrows ] );
+    m_numrows = numrows;
+    m_ordered = ordered;
+    m_start_ts = start_ts;
+    m_stop_ts = INT64_MAX;
+
+    for ( uint32_t i = 0; i < numrows; i++ )
+    {
+        row_t &row = m_rows[ i ];
+        char buf[ 32 ];
+
+        row.cpu = i % cpus;
+        snprintf_safe( buf, "cpu %d", row.cpu );
+        row.label = streams[ i / cpus ] + buf;
+        row.done = false;
+        row.last_ts = -1;
+        row.bucket_ts = NSECS_PER_SEC / 1000;
+
+        for ( uint32_t j = 0; j < NUM_BUCKETS; j++ )
+            row.counts[ j ].store( 0, std::memory_order_relaxed );
+    }
+}
+
+void load_preview_t::add_event( uint32_t row, int64_t ts )
+{
+    row_t &r = m_rows[ row ];
+    int64_t rel_ts = ts - m_start_ts;
+    int64_t bucket_ts = r.bucket_ts.load( std::memory_order_relaxed );
+
+    if ( rel_ts < 0 )
+        return;
+
+    // Widen buckets until this ts fits, combining neighbouring counts
+    while ( rel_ts >= bucket_ts * NUM_BUCKETS )
+    {
+        for ( uint32_t i = 0; i < NUM_BUCKETS / 2; i++ )
+        {
+            uint32_t count = r.counts[ i * 2 ].load( std::memory_order_relaxed ) +
+                    r.counts[ i * 2 + 1 ].load( std::memory_order_relaxed );
+
+            r.counts[ i ].store( count, std::memory_order_relaxed );
+        }
+        for ( uint32_t i = NUM_BUCKETS / 2; i < NUM_BUCKETS; i++ )
+            r.counts[ i ].store( 0, std::memory_order_relaxed );
+
+        bucket_ts *= 2;
+        r.bucket_ts.store( bucket_ts, std::memory_order_relaxed );
+    }
+
+    std::atomic< uint32_t > &count = r.counts[ rel_ts / bucket_ts ];
+
+    count.store( count.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    r.last_ts.store( rel_ts, std::memory_order_relaxed );
+}
+
+void load_preview_t::set_row_done( uint32_t row )
+{
+    m_rows[ row ].done = true;
+}
+
+void load_preview_t::stop()
+{
+    std::lock_guard< std::mutex > lock( m_mutex );
+    int64_t min_ts = INT64_MAX;
+    int64_t max_ts = 0;
+
+    for ( uint32_t i = 0; i < m_numrows; i++ )
+    {
+        int64_t last_ts = m_rows[ i ].last_ts;
+
+        max_ts = std::max< int64_t >( max_ts, last_ts );
+
+        // Rows which haven't started decoding yet just catch up
+        if ( ( last_ts >= 0 ) && !m_rows[ i ].done )
+            min_ts = std::min< int64_t >( min_ts, last_ts );
+    }
+
+    m_stop_ts = ( m_ordered || ( min_ts == INT64_MAX ) ) ? max_ts : min_ts;
+}
+
 static int64_t geti64( const char *str, const char *var )
 {
     const char *val = strstr( str, var );
@@ -1937,6 +3473,305 @@ static int64_t getf64( const char *str, const char *var )
     return 0;
 }
 
+static void read_records( trace_data_t &trace_data, std::vector< file_info_t * > &file_list,
+                          unsigned long long trim_ts )
+{
+    trace_info_t &trace_info = trace_data.trace_info;
+    load_preview_t *preview = trace_info.load_preview;
+    ts_cursor_heap_t heap;
+
+    for ( size_t i = 0; i < file_list.size(); i++ )
+    {
+        pevent_record_t *record = get_next_record( file_list[ i ] );
+
+        if ( record )
+            heap.push( { record->ts, i } );
+    }
+
+    while ( !heap.empty() )
+    {
+        int ret = 0;
+        bool done = false;
+        size_t index = heap.top().second;
+        file_info_t *file_info = file_list[ index ];
+        pevent_record_t *record = file_info->record;
+        cpu_info_t &cpu_info = trace_info.cpu_info[ record->cpu ];
+
+        heap.pop();
+
+        // Bump up total event count for this cpu
+        cpu_info.tot_events++;
+
+        // Store the max ts value we've seen for this cpu
+        cpu_info.max_ts = record->ts - trace_info.min_file_ts;
+
+        // If this ts is greater than our trim value, add it.
+        if ( record->ts >= trim_ts )
+        {
+            cpu_info.events++;
+            ret = trace_enum_events( trace_data, file_info->handle, record );
+
+            if ( preview )
+            {
+                preview->add_event( index * trace_info.cpus + record->cpu, record->ts );
+                done = preview->past_stop( record->ts );
+            }
+
+            // Bail if user specified read length and we hit it
+            if ( trace_info.m_tracelen && ( record->ts - trim_ts > trace_info.m_tracelen ) )
+                done = true;
+        }
+
+        free_record( file_info->handle, file_info->record );
+        file_info->record = NULL;
+
+        if ( done || ret )
+            break;
+
+        record = get_next_record( file_info );
+        if ( record )
+            heap.push( { record->ts, index } );
+    }
+}
+
+// Records from a single cpu buffer of a single file / buffer instance.
+struct cpu_stream_t
+{
+    tracecmd_input_t *handle = nullptr;
+    int cpu = 0;
+
+    // Index of this stream in read_records_parallel() and its load_preview_t row
+    uint32_t row = 0;
+
+    // Decoded events, strings are interned straight into the TraceEvents strpool
+    std::vector< trace_event_t > events;
+
+    // Record data for lazy_fields events
+    StrAlloc *raw_alloc = nullptr;
+
+    // Records read before trim_ts and ts of the last one
+    uint64_t trimmed_records = 0;
+    int64_t trimmed_ts = INT64_MAX;
+
+    // Records with no matching event format
+    uint64_t unknown_records = 0;
+
+    bool failed = false;
+};
+
+static bool use_parallel_load( tracecmd_input_t *handle, const trace_info_t &trace_info )
+{
+    if ( !trace_info.parallel_load || ( std::thread::hardware_concurrency() < 2 ) )
+        return false;
+
+#ifdef USE_MMAP
+    // The read_page path shares the file position between cpus
+    return !handle->read_page;
+#else
+    return false;
+#endif
+}
+
+static void decode_cpu_stream( cpu_stream_t &stream, trace_data_t &trace_data, unsigned long long trim_ts )
+{
+    tracecmd_input_t *handle = stream.handle;
+    uint64_t tracelen = trace_data.trace_info.m_tracelen;
+    load_preview_t *preview = trace_data.trace_info.load_preview;
+    EventCallback cb = [ &stream ]( const trace_event_t &event )
+    {
+        stream.events.push_back( event );
+        return 0;
+    };
+    trace_data_t stream_data( cb, trace_data.trace_info, trace_data.strpool );
+
+    stream_data.raw_fields = trace_data.raw_fields;
+    stream_data.raw_alloc = stream.raw_alloc;
+    stream_data.format_infos = trace_data.format_infos;
+
+    for ( size_t i = 0;; i++ )
+    {
+        bool done = false;
+
+        // Don't decode the rest of a big buffer after the user cancelled
+        if ( !( i % 4096 ) && trace_data.trace_info.cancelled && trace_data.trace_info.cancelled() )
+            break;
+
+        pevent_record_t *record = tracecmd_read_data( handle, stream.cpu );
+
+        if ( !record )
+            break;
+
+        if ( record->ts < trim_ts )
+        {
+            stream.trimmed_records++;
+            stream.trimmed_ts = record->ts;
+        }
+        else
+        {
+            size_t count = stream.events.size();
+
+            trace_enum_events( stream_data, handle, record );
+
+            if ( stream.events.size() == count )
+                stream.unknown_records++;
+
+            // Keep the first record past the requested read length so the merge
+            //  stops at the same place the single threaded loop does.
+            done = tracelen && ( record->ts - trim_ts > tracelen );
+
+            if ( preview )
+            {
+                preview->add_event( stream.row, record->ts );
+                done = done || preview->past_stop( record->ts );
+            }
+        }
+
+        free_record( handle, record );
+
+        if ( done )
+            break;
+    }
+}
+
+static void decode_cpu_stream_worker( cpu_stream_t &stream, trace_data_t &trace_data, unsigned long long trim_ts )
+{
+    std::jmp_buf jump_buffer;
+
+    s_worker_jump_buffer = &jump_buffer;
+
+    if ( setjmp( jump_buffer ) )
+        stream.failed = true;
+    else
+        decode_cpu_stream( stream, trace_data, trim_ts );
+
+    s_worker_jump_buffer = nullptr;
+
+    if ( trace_data.trace_info.load_preview )
+        trace_data.trace_info.load_preview->set_row_done( stream.row );
+}
+
+// Decode each cpu buffer of each file on worker threads, then merge the
+//  per-cpu event arrays by timestamp and hand them to the event callback.
+static void read_records_parallel( trace_data_t &trace_data, std::vector< file_info_t * > &file_list,
+                                   unsigned long long trim_ts )
+{
+    trace_info_t &trace_info = trace_data.trace_info;
+    tracecmd_input_t *handle = file_list[ 0 ]->handle;
+    std::vector< cpu_stream_t > streams( file_list.size() * handle->cpus );
+
+    // Ordering ties are broken by file then cpu, same as read_records()
+    for ( size_t i = 0; i < streams.size(); i++ )
+    {
+        streams[ i ].handle = file_list[ i / handle->cpus ]->handle;
+        streams[ i ].cpu = i % handle->cpus;
+        streams[ i ].row = i;
+
+        if ( trace_data.raw_fields )
+            streams[ i ].raw_alloc = trace_data.raw_fields->new_alloc();
+    }
+
+    // Create libtraceevent lookup tables before going wide
+    tep_init_lazy_maps( handle->pevent );
+
+    parallel_for( streams.size(), [ & ]( size_t i )
+    {
+        decode_cpu_stream_worker( streams[ i ], trace_data, trim_ts );
+    } );
+
+    for ( cpu_stream_t &stream : streams )
+    {
+        if ( stream.failed )
+            die( handle, "%s: failed to decode cpu %d.\n", __func__, stream.cpu );
+
+        cpu_info_t &cpu_info = trace_info.cpu_info[ stream.cpu ];
+
+        cpu_info.tot_events += stream.trimmed_records + stream.unknown_records;
+        cpu_info.events += stream.unknown_records;
+        if ( stream.trimmed_records )
+            cpu_info.max_ts = stream.trimmed_ts - trace_info.min_file_ts;
+    }
+
+    std::vector< size_t > pos( streams.size(), 0 );
+    ts_cursor_heap_t heap;
+
+    for ( size_t i = 0; i < streams.size(); i++ )
+    {
+        if ( !streams[ i ].events.empty() )
+            heap.push( { streams[ i ].events[ 0 ].ts, i } );
+    }
+
+    while ( !heap.empty() )
+    {
+        size_t next = heap.top().second;
+        const trace_event_t &event = streams[ next ].events[ pos[ next ]++ ];
+        cpu_info_t &cpu_info = trace_info.cpu_info[ event.cpu ];
+
+        heap.pop();
+        if ( pos[ next ] < streams[ next ].events.size() )
+            heap.push( { streams[ next ].events[ pos[ next ] ].ts, next } );
+
+        cpu_info.tot_events++;
+        cpu_info.events++;
+        cpu_info.max_ts = event.ts - trace_info.min_file_ts;
+
+        int ret = trace_data.cb( event );
+
+        // Bail if user cancelled or specified read length and we hit it
+        if ( ret || ( trace_info.m_tracelen && ( event.ts - trim_ts > trace_info.m_tracelen ) ) )
+            break;
+
+        // Or if loading was stopped early
+        if ( trace_info.load_preview && trace_info.load_preview->past_stop( event.ts ) )
+            break;
+
+        // Events were copied by the callback, so free drained streams as we go
+        if ( pos[ next ] == streams[ next ].events.size() )
+        {
+            std::vector< trace_event_t >().swap( streams[ next ].events );
+            pos[ next ] = 0;
+        }
+    }
+
+    // Free fields for events we didn't hand off
+    for ( size_t i = 0; i < streams.size(); i++ )
+    {
+        for ( size_t j = pos[ i ]; j < streams[ i ].events.size(); j++ )
+            delete [] streams[ i ].events[ j ].fields;
+    }
+}
+
+int read_trace_formats( const char *file, StrPool &strpool, trace_info_t &trace_info )
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    tracecmd_input_t *handle = new ( std::nothrow ) tracecmd_input_t;
+    if ( !handle )
+    {
+        logf( "[Error] %s: new tracecmd_input_t failed.\n", __func__ );
+        return -1;
+    }
+
+    if ( setjmp( handle->jump_buffer ) )
+    {
+        logf( "[Error] %s: setjmp error called for %s.\n", __func__, file );
+
+        tracecmd_close( handle );
+        return -1;
+    }
+
+    tracecmd_alloc( handle, file );
+
+    // Event formats and kallsyms are in the headers, no cpu data is read
+    tracecmd_read_headers( handle );
+
+    if ( !trace_info.raw_fields )
+        trace_info.raw_fields = std::make_shared< raw_fields_t >( strpool );
+    trace_info.raw_fields->add_pevent( handle->pevent );
+
+    tracecmd_close( handle );
+    return 0;
+}
+
 int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb )
 {
     GPUVIS_TRACE_BLOCK( __func__ );
@@ -1981,10 +3816,10 @@ int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_inf
     // event = pevent_find_event_by_name(pevent, "ftrace", "kernel_stack");
 
     /* If this file has buffer instances, get the file_info for them */
-    for ( int i = 0; i < handle->nr_buffers; i++ )
+    for ( size_t i = 0; i < handle->buffers.size(); i++ )
     {
         tracecmd_input_t *new_handle;
-        const char *name = handle->buffers[ i ].name;
+        const char *name = handle->buffers[ i ].name.c_str();
 
         new_handle = tracecmd_buffer_instance_handle( handle, i );
         if ( !new_handle )
@@ -2090,55 +3925,66 @@ int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_inf
     // Scoot to tracestart time if it was set
     trim_ts = std::max< unsigned long long >( trim_ts, trace_info.min_file_ts + trace_info.m_tracestart );
 
+    // Jump each cpu straight to the page holding tracestart instead of reading
+    //  every record before it. Skipped records aren't counted in cpu_info.
+    if ( trace_info.m_tracestart )
+    {
+        for ( file_info_t *file_info : file_list )
+        {
+            for ( int cpu = 0; cpu < file_info->handle->cpus; cpu++ )
+                tracecmd_seek_cpu_ts( file_info->handle, cpu, trim_ts );
+        }
+    }
+
     trace_data_t trace_data( cb, trace_info, strpool );
 
-    for ( ;; )
+    if ( trace_info.lazy_fields )
     {
-        int ret = 0;
-        file_info_t *last_file_info = NULL;
-        pevent_record_t *last_record = NULL;
+        if ( !trace_info.raw_fields )
+            trace_info.raw_fields = std::make_shared< raw_fields_t >( strpool );
 
-        for ( file_info_t *file_info : file_list )
-        {
-            pevent_record_t *record = get_next_record( file_info );
+        trace_data.raw_fields = trace_info.raw_fields.get();
+        trace_data.raw_fields->add_pevent( handle->pevent );
+        trace_data.raw_alloc = trace_data.raw_fields->new_alloc();
+    }
 
-            if ( !last_record ||
-                 ( record && record->ts < last_record->ts ) )
-            {
-                last_record = record;
-                last_file_info = file_info;
-            }
-        }
+    // Resolve event types once per event format instead of once per record
+    util_umap< const tep_event *, event_format_info_t > format_infos;
 
-        if ( last_record )
-        {
-            cpu_info_t &cpu_info = trace_info.cpu_info[ last_record->cpu ];
+    for ( file_info_t *file_info : file_list )
+    {
+        tep_handle *pevent = file_info->handle->pevent;
 
-            // Bump up total event count for this cpu
-            cpu_info.tot_events++;
+        for ( int i = 0; i < pevent->nr_events; i++ )
+            format_infos.m_map[ pevent->events[ i ] ] = get_event_format_info( pevent->events[ i ] );
+    }
+    trace_data.format_infos = &format_infos;
 
-            // Store the max ts value we've seen for this cpu
-            cpu_info.max_ts = last_record->ts - trace_info.min_file_ts;
+    bool parallel = use_parallel_load( handle, trace_info );
 
-            // If this ts is greater than our trim value, add it.
-            if ( last_record->ts >= trim_ts )
-            {
-                cpu_info.events++;
-                ret = trace_enum_events( trace_data, last_file_info->handle, last_record );
+    // One preview row per cpu buffer of each file
+    if ( trace_info.load_preview )
+    {
+        bool label_streams = ( file_list.size() > 1 ) || trace_info.load_preview->m_label_files;
+        std::vector< std::string > streams;
 
-                // Bail if user specified read length and we hit it
-                if ( trace_info.m_tracelen && ( last_record->ts - trim_ts > trace_info.m_tracelen ) )
-                    last_record = NULL;
-            }
+        for ( file_info_t *file_info : file_list )
+        {
+            // Top buffer has the file path, instances have their names
+            const char *name = file_info->handle->file.c_str();
+            const char *slash = strrchr( name, '/' );
 
-            free_record( last_file_info->handle, last_file_info->record );
-            last_file_info->record = NULL;
+            streams.push_back( label_streams ? std::string( slash ? slash + 1 : name ) + " " : "" );
         }
 
-        if ( !last_record || ret )
-            break;
+        trace_info.load_preview->init( streams, handle->cpus, trim_ts, !parallel );
     }
 
+    if ( parallel )
+        read_records_parallel( trace_data, file_list, trim_ts );
+    else
+        read_records( trace_data, file_list, trim_ts );
+
     if ( trim_ts )
         trace_info.trimmed_ts = trim_ts - trace_info.min_file_ts;
 
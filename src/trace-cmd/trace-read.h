@@ -117,6 +117,63 @@ struct cpu_info_t
     uint64_t tot_events = 0;
 };
 
+// Per-cpu event counts over time, filled in while a trace.dat is read so the
+//  loaded part of the trace can be drawn before loading finishes. Each row is
+//  written by the one thread decoding that cpu buffer, in timestamp order.
+class load_preview_t
+{
+public:
+    enum { NUM_BUCKETS = 1024 };
+
+    struct row_t
+    {
+        int cpu = 0;
+        // "cpu N", after the file or buffer instance name if there are several
+        std::string label;
+        std::atomic< bool > done;
+        // Last ts added relative to m_start_ts (or -1)
+        std::atomic< int64_t > last_ts;
+        // Bucket width. Doubles when an event doesn't fit in NUM_BUCKETS.
+        std::atomic< int64_t > bucket_ts;
+        std::atomic< uint32_t > counts[ NUM_BUCKETS ];
+    };
+
+public:
+    load_preview_t() : m_stop_ts( INT64_MAX ) {}
+    ~load_preview_t() {}
+
+    // Called by the loader thread before reading records. Streams has the
+    //  label prefix of each file or buffer instance, which get cpus rows each.
+    //  Ordered is set when all rows are read together in ts order (single
+    //  threaded load).
+    void init( const std::vector< std::string > &streams, uint32_t cpus, int64_t start_ts, bool ordered );
+
+    void add_event( uint32_t row, int64_t ts );
+    void set_row_done( uint32_t row );
+
+    // Stop reading once every busy row reaches the ts they have all reached now
+    void stop();
+    bool is_stopped() const { return m_stop_ts != INT64_MAX; }
+    bool past_stop( int64_t ts ) const { return ( ts - m_start_ts ) > m_stop_ts; }
+
+public:
+    // Held by init() and by readers of m_rows
+    std::mutex m_mutex;
+
+    // Rows are read in ts order, so stop() can stop right away
+    bool m_ordered = false;
+    // Several trace files are loaded one after another, so label rows with them
+    bool m_label_files = false;
+    int64_t m_start_ts = 0;
+    uint32_t m_numrows = 0;
+    std::unique_ptr< row_t[] > m_rows;
+
+    std::atomic< int64_t > m_stop_ts;
+};
+
+struct raw_fields_t;
+struct raw_event_format_t;
+
 struct trace_info_t
 {
     uint32_t cpus = 0;
@@ -138,6 +195,20 @@ struct trace_info_t
     uint64_t m_tracestart = 0;
     uint64_t m_tracelen = 0;
 
+    // Decode each cpu buffer on its own worker thread
+    bool parallel_load = false;
+
+    // Per-cpu counts of events read so far
+    load_preview_t *load_preview = nullptr;
+
+    // Returns true when the user cancelled loading. Polled by the parallel
+    //  decode workers, which don't go through the event callback.
+    std::function< bool() > cancelled;
+
+    // Keep raw record data and format field values on demand
+    bool lazy_fields = false;
+    std::shared_ptr< raw_fields_t > raw_fields;
+
     // Map tgid to vector of child pids and color
     util_umap< int, tgid_info_t > tgid_pids;
     // Map pid to tgid
@@ -151,9 +222,16 @@ struct trace_info_t
 struct event_field_t
 {
     const char *key;
-    const char *value;
+    // NULL until rendered for lazy_fields events. Published with release
+    // stores since filters can render fields from worker threads.
+    std::atomic< const char * > value = { nullptr };
 };
 
+struct trace_event_t;
+
+// Format field index of a lazy_fields event and store it in the field value
+const char *render_event_field( const trace_event_t &event, uint32_t index );
+
 enum trace_flag_type_t {
     // TRACE_FLAG_IRQS_OFF = 0x01, // interrupts were disabled
     // TRACE_FLAG_IRQS_NOSUPPORT = 0x02,
@@ -176,10 +254,61 @@ enum trace_flag_type_t {
     TRACE_FLAG_GPUVIS_PRINT                 = 0x100000, // Added for new `gpuvis_print` event type in kernel
 };
 
+// Events gpuvis handles specially. Resolved once per event format from the
+//  event system and name so init code can switch on trace_event_t::type.
+enum trace_event_type_t
+{
+    TRACE_EVENT_Unknown = 0,
+
+    TRACE_EVENT_sched_switch,
+    TRACE_EVENT_sched_process_exec,
+    TRACE_EVENT_sched_process_exit,
+    TRACE_EVENT_sched_process_fork,
+    TRACE_EVENT_psci_domain_idle_enter,
+    TRACE_EVENT_psci_domain_idle_exit,
+
+    TRACE_EVENT_drm_vblank_event,
+    TRACE_EVENT_drm_vblank_event_queued,
+
+    TRACE_EVENT_fence_signaled,             // *fence_signaled
+    TRACE_EVENT_amdgpu_cs_ioctl,
+    TRACE_EVENT_amdgpu_sched_run_job,
+    TRACE_EVENT_amdgpu_job_msg,
+
+    TRACE_EVENT_drm_sched_job,              // drm_sched timeline events
+    TRACE_EVENT_drm_run_job,
+    TRACE_EVENT_drm_sched_process_job,
+
+    TRACE_EVENT_msm_gpu_submit,             // msm timeline events
+    TRACE_EVENT_msm_gpu_submit_flush,
+    TRACE_EVENT_msm_gpu_submit_retired,
+    TRACE_EVENT_msm_gpu_preemption_trigger,
+    TRACE_EVENT_msm_gpu_preemption_irq,
+    TRACE_EVENT_msm_gpu_freq_change,
+
+    TRACE_EVENT_i915_request_queue,         // i915_*_request_queue, etc.
+    TRACE_EVENT_i915_request_add,
+    TRACE_EVENT_i915_request_submit,
+    TRACE_EVENT_i915_request_in,
+    TRACE_EVENT_i915_request_out,
+    TRACE_EVENT_i915_request_wait_begin,
+    TRACE_EVENT_i915_request_wait_end,
+    TRACE_EVENT_intel_engine_notify,
+
+    TRACE_EVENT_Max
+};
+
+// Get event type for an event system and name
+trace_event_type_t get_trace_event_type( const char *system, const char *name );
+// Get TRACE_FLAG_FENCE_SIGNALED, etc. flags for an event type
+uint32_t get_trace_event_type_flags( trace_event_type_t type );
+
 struct trace_event_t
 {
 public:
     bool is_filtered_out = false;
+    bool vblank_ts_high_prec = false; // denotes whether or not the hardware timestamp is high-precision
+    uint16_t type = TRACE_EVENT_Unknown; // trace_event_type_t
 
     int pid;                          // event process id
     uint32_t id;                      // event id
@@ -191,10 +320,9 @@ public:
     uint32_t id_start = INVALID_ID;   // start event if this is a graph sequence event (ie amdgpu_sched_run_job, fence_signaled)
     uint32_t graph_row_id = 0;
     int crtc = -1;                    // drm_vblank_event crtc (or -1)
-    int64_t vblank_ts = INT64_MAX;    // time-stamp that is passed with the drm_event_vblank event
-    bool vblank_ts_high_prec = false; // denotes whether or not the hardware timestamp is high-precision
     uint32_t i915_perf_timeline =
         INVALID_ID;                   // Pointer into the i915-perf timelines to this element.
+    int64_t vblank_ts = INT64_MAX;    // time-stamp that is passed with the drm_event_vblank event
 
     uint32_t color = 0;             // color of the event (or 0 for default)
 
@@ -211,8 +339,12 @@ public:
     const char *user_comm;          // User space comm (if we can figure this out)
 
     uint32_t numfields = 0;
+    uint32_t backtrace_id = INVALID_ID; // index into TraceEvents::m_backtraces
     event_field_t *fields = nullptr;
-    std::vector< const char * > backtrace;
+
+    // Record payload and format used to render fields (trace_info_t::lazy_fields)
+    const void *raw_data = nullptr;
+    const raw_event_format_t *raw_format = nullptr;
 
 public:
     bool is_fence_signaled() const             { return !!( flags & TRACE_FLAG_FENCE_SIGNALED ); }
@@ -224,6 +356,13 @@ public:
     bool is_i915_perf() const                  { return !!( flags & TRACE_FLAG_I915_PERF ); }
     bool is_linux_perf() const                 { return !!( flags & TRACE_FLAG_LINUX_PERF ); }
 
+    const char *get_field_val( uint32_t i ) const
+    {
+        const char *val = fields[ i ].value.load( std::memory_order_acquire );
+
+        return val ? val : render_event_field( *this, i );
+    }
+
     bool has_duration() const                  { return duration != INT64_MAX; }
     bool has_cpu() const                       { return cpu != UINT32_MAX; }
     int64_t get_vblank_ts(bool want_high_prec) const { return want_high_prec && (vblank_ts != INT64_MAX) && vblank_ts_high_prec ? vblank_ts : ts; }
@@ -244,5 +383,54 @@ public:
 const char *get_event_field_val( const trace_event_t &event, const char *name, const char *defval = "" );
 event_field_t *get_event_field( trace_event_t &event, const char *name );
 
+// Integer value of field index, read straight from the record data of
+//  lazy_fields events. Returns false for other events and non-integer fields.
+//  decimal_only also skips fields that render as hex, flags, etc. so the value
+//  compares the same as the field string would.
+bool get_event_field_int( const trace_event_t &event, uint32_t index, int64_t &val, bool decimal_only = false );
+
+// Field lookup for one field name. Events with the same name share a field
+//  layout, so the slot found for an event name is remembered and later events
+//  only need a single key compare. Hints are single atomic words that always
+//  get verified, so lookups can run on any thread. Ie:
+//    static event_field_slot_t s_prev_pid( "prev_pid" );
+//    int pid = s_prev_pid.get_int( event );
+class event_field_slot_t
+{
+public:
+    explicit event_field_slot_t( const char *key );
+    ~event_field_slot_t() {}
+
+    // Return index of field in event.fields, or -1
+    int find( const trace_event_t &event ) const;
+
+    const char *get_val( const trace_event_t &event, const char *defval = "" ) const;
+
+    // Integer value of field. lazy_fields events decode numbers straight from
+    //  the record data (get_event_field_int) instead of formatting and parsing them.
+    int64_t get_int( const trace_event_t &event, int64_t defval = 0 ) const;
+
+private:
+    const char *m_key;
+
+    // ( event name pointer << 8 ) | field slot, indexed by event name pointer
+    static const size_t NUM_HINTS = 16;
+    mutable std::atomic< uint64_t > m_hints[ NUM_HINTS ];
+};
+
 typedef std::function< int ( const trace_event_t &event ) > EventCallback;
 int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb );
+
+// Record data kept for lazy_fields events, so the event cache can store raw
+//  records instead of formatted field values.
+uint32_t get_event_raw_size( const trace_event_t &event );
+void get_raw_event_format_name( const raw_event_format_t *raw_format, const char **system, const char **name );
+uint32_t get_raw_event_format_numfields( const raw_event_format_t *raw_format );
+
+// Read the event formats from a trace file's headers into trace_info.raw_fields
+int read_trace_formats( const char *file, StrPool &strpool, trace_info_t &trace_info );
+const raw_event_format_t *find_raw_event_format( const trace_info_t &trace_info, const char *system, const char *name );
+
+// Copy record data for event and render its unset fields from raw_format
+void set_event_raw_record( trace_event_t &event, const raw_event_format_t *raw_format,
+                           const void *data, uint32_t size );